@@ -0,0 +1,130 @@
+//////////////////////////////////////////////////////////////////////////////////
+// File    : main.c  (for barrier)
+// Date    : October 2015
+// Author  : Alain Greiner <alain.greiner@lip6.fr>
+//
+// This multi-threaded application is a micro-benchmark comparing the barrier
+// algorithms available behind the giet_sqt_barrier_t API:
+// - the default Synchro-Quad-Tree (SQT_BARRIER_QUAD),
+// - a combining tree with a fan-in of 2, 4 and 8 (SQT_BARRIER_TREE),
+// - a dissemination barrier (SQT_BARRIER_DISSEMINATION).
+// There is one task per processor.
+// Task running on processor P(0,0,0) initialises the heaps and the barriers,
+// and displays, for each variant, the average number of cycles per barrier
+// for NB_ITERATIONS successive barriers (busy waiting).
+//
+// The processors must form a mesh[x_size][y_size] with nprocs per cluster.
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "stdio.h"
+#include "malloc.h"
+#include "user_barrier.h"
+
+#define NB_ITERATIONS   1000
+#define NB_VARIANTS     5
+
+#define PRINTF(...) ({ if ( proc_id==0) { giet_tty_printf(__VA_ARGS__); } })
+
+giet_sqt_barrier_t  barrier[NB_VARIANTS];
+
+unsigned int        type[NB_VARIANTS]  = { SQT_BARRIER_QUAD,
+                                           SQT_BARRIER_TREE,
+                                           SQT_BARRIER_TREE,
+                                           SQT_BARRIER_TREE,
+                                           SQT_BARRIER_DISSEMINATION };
+
+unsigned int        fanin[NB_VARIANTS] = { 4, 2, 4, 8, 0 };
+
+char*               name[NB_VARIANTS]  = { "QUAD         ",
+                                           "TREE / fanin 2",
+                                           "TREE / fanin 4",
+                                           "TREE / fanin 8",
+                                           "DISSEMINATION" };
+
+volatile unsigned int init_ok = 0;
+
+////////////////////////////////////////
+__attribute__((constructor)) void main()
+////////////////////////////////////////
+{
+    // get processor identifier
+    unsigned int x;
+    unsigned int y;
+    unsigned int p;
+    giet_proc_xyp( &x, &y, &p );
+
+    // get processors number
+    unsigned int x_size;
+    unsigned int y_size;
+    unsigned int nprocs;
+    giet_procs_number( &x_size, &y_size, &nprocs );
+
+    // compute continuous processor index
+    unsigned int proc_id = (((x * y_size) + y) * nprocs) + p;
+
+    unsigned int v;
+    unsigned int i;
+
+    // P[0,0,0] makes initialisation
+    if ( proc_id == 0 )
+    {
+        // get a private TTY for P[0,0,0]
+        giet_tty_alloc( 0 );
+
+        // initializes distributed heap
+        unsigned int cx;
+        unsigned int cy;
+        for ( cx = 0 ; cx < x_size ; cx++ )
+        {
+            for ( cy = 0 ; cy < y_size ; cy++ )
+            {
+                heap_init( cx , cy );
+            }
+        }
+
+        // initialises barriers
+        for ( v = 0 ; v < NB_VARIANTS ; v++ )
+        {
+            sqt_barrier_init_type( &barrier[v], x_size, y_size, nprocs,
+                                   type[v], fanin[v] );
+        }
+
+        PRINTF("\n[BARRIER] P[0,0,0] completes initialisation at cycle %d\n"
+               " x_size = %d / y_size = %d / nprocs = %d / iterations = %d\n",
+               giet_proctime() , x_size, y_size, nprocs, NB_ITERATIONS );
+
+        // activates all other processors
+        init_ok = 1;
+    }
+    else
+    {
+        while ( init_ok == 0 ) asm volatile("nop\n nop\n nop");
+    }
+
+    for ( v = 0 ; v < NB_VARIANTS ; v++ )
+    {
+        // warm-up : all nodes are loaded in the caches
+        sqt_barrier_wait( &barrier[v] );
+
+        unsigned int start = giet_proctime();
+
+        for ( i = 0 ; i < NB_ITERATIONS ; i++ ) sqt_barrier_wait( &barrier[v] );
+
+        unsigned int cycles = giet_proctime() - start;
+
+        PRINTF("\n[BARRIER] %s : %d cycles per barrier\n",
+               name[v], cycles / NB_ITERATIONS );
+    }
+
+    giet_exit("Completed");
+
+} // end main()
+
+// Local Variables:
+// tab-width: 4
+// c-basic-offset: 4
+// c-file-offsets:((innamespace . 0)(inline-open . 0))
+// indent-tabs-mode: nil
+// End:
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=4:softtabstop=4
+
@@ -0,0 +1,122 @@
+#!/usr/bin/env python
+
+from mapping import *
+
+##################################################################################
+#   file   : chanbench.py
+#   date   : october 2015
+#   author : Alain Greiner
+##################################################################################
+#  This file describes the mapping of the "chanbench" micro-benchmark
+#  on a multi-clusters, multi-processors architecture.
+#  This application contains 2 tasks communicating through one MWMR channel
+#  and one SPSC channel:
+#    - one "producer" task => on proc[0,0,0]
+#    - one "consumer" task => on proc[x_size-1,y_size-1,nprocs-1]
+#  The mapping of virtual segments is the following:
+#    - There is one shared data vseg in cluster[0][0]
+#    - The SPSC channel (descriptor and buffer) is the "chb_fifo" vseg,
+#      mapped in the consumer cluster.
+#    - The code vsegs are replicated in the producer and consumer clusters.
+#    - There is one stack vseg per task, mapped in the task cluster.
+#  This mapping uses 5 platform parameters, (obtained from the "mapping" argument)
+#    - x_size    : number of clusters in a row
+#    - y_size    : number of clusters in a column
+#    - x_width   : number of bits coding x coordinate
+#    - y_width   : number of bits coding y coordinate
+#    - nprocs    : number of processors per cluster
+##################################################################################
+
+######################
+def extend( mapping ):
+
+    x_size    = mapping.x_size
+    y_size    = mapping.y_size
+    nprocs    = mapping.nprocs
+    x_width   = mapping.x_width
+    y_width   = mapping.y_width
+
+    # define vsegs base & size
+    code_base  = 0x10000000
+    code_size  = 0x00010000     # 64 Kbytes (replicated in each cluster)
+
+    data_base  = 0x20000000
+    data_size  = 0x00010000     # 64 Kbytes (non replicated)
+
+    fifo_base  = 0x30000000
+    fifo_size  = 0x00001000     # 4 Kbytes (SPSC descriptor and buffer)
+
+    stack_base = 0x40000000
+    stack_size = 0x00010000     # 64 Kbytes (per task)
+
+    # producer and consumer clusters
+    px = 0
+    py = 0
+    cx = x_size - 1
+    cy = y_size - 1
+
+    # create vspace
+    vspace = mapping.addVspace( name = 'chanbench', startname = 'chb_data', active = False )
+
+    # data vseg : shared (only in cluster[0,0])
+    mapping.addVseg( vspace, 'chb_data', data_base , data_size,
+                     'C_WU', vtype = 'ELF', x = 0, y = 0, pseg = 'RAM',
+                     binpath = 'bin/chanbench/appli.elf',
+                     local = False )
+
+    # fifo vseg : shared (in consumer cluster)
+    mapping.addVseg( vspace, 'chb_fifo', fifo_base , fifo_size,
+                     'C_WU', vtype = 'BUFFER', x = cx, y = cy, pseg = 'RAM',
+                     local = False )
+
+    # code vsegs : local (one copy in producer and consumer clusters)
+    clusters = [ (px,py) ]
+    if ( (cx,cy) != (px,py) ): clusters.append( (cx,cy) )
+
+    for (x,y) in clusters:
+        mapping.addVseg( vspace, 'chb_code_%d_%d' %(x,y),
+                         code_base , code_size,
+                         'CXWU', vtype = 'ELF', x = x, y = y, pseg = 'RAM',
+                         binpath = 'bin/chanbench/appli.elf',
+                         local = True )
+
+    # stack vsegs : local (one stack per task)
+    mapping.addVseg( vspace, 'chb_stack_producer',
+                     stack_base, stack_size, 'C_WU', vtype = 'BUFFER',
+                     x = px , y = py , pseg = 'RAM',
+                     local = True )
+
+    mapping.addVseg( vspace, 'chb_stack_consumer',
+                     stack_base + stack_size, stack_size, 'C_WU', vtype = 'BUFFER',
+                     x = cx , y = cy , pseg = 'RAM',
+                     local = True )
+
+    # tasks (the start index is the reverse order of the constructors in main.c)
+    mapping.addTask( vspace, 'producer', 0, px, py, 0,
+                     'chb_stack_producer', '', 1 )
+
+    mapping.addTask( vspace, 'consumer', 1, cx, cy, nprocs - 1,
+                     'chb_stack_consumer', '', 0 )
+
+    # extend mapping name
+    mapping.name += '_chb'
+
+    return vspace  # useful for test
+
+################################ test ##################################################
+
+if __name__ == '__main__':
+
+    vspace = extend( Mapping( 'test', 2, 2, 4 ) )
+    print vspace.xml()
+
+
+# Local Variables:
+# tab-width: 4;
+# c-basic-offset: 4;
+# c-file-offsets:((innamespace . 0)(inline-open . 0));
+# indent-tabs-mode: nil;
+# End:
+#
+# vim: filetype=python:expandtab:shiftwidth=4:tabstop=4:softtabstop=4
+
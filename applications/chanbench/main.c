@@ -0,0 +1,159 @@
+//////////////////////////////////////////////////////////////////////////////////
+// File    : main.c  (for chanbench)
+// Date    : October 2015
+// Author  : Alain Greiner <alain.greiner@lip6.fr>
+//
+// This multi-threaded application is a micro-benchmark comparing the token
+// throughput of the two user level communication channels:
+// - the MWMR channel (mwmr_channel_t), protected by a queuing lock,
+// - the same MWMR channel, with the zero-copy reserve/commit and
+//   acquire/release functions,
+// - the SPSC channel (spsc_channel_t), that does not use any lock.
+// It contains two tasks : one "producer" and one "consumer".
+// The producer writes NB_TOKENS words in each channel, by bursts of BURST
+// words, and the consumer reads them, checks the token values, and displays
+// for each test the number of cycles and the throughput (words per 1000
+// cycles).
+// The MWMR channel and its buffer are defined in the data vseg, and are
+// initialised with mwmr_init(). The SPSC channel is defined in the mapping,
+// as the "chb_fifo" vseg, and is initialised with spsc_vseg_init().
+// Both channels have the same depth.
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "stdio.h"
+#include "mwmr_channel.h"
+#include "spsc_channel.h"
+
+#define NB_TOKENS   0x10000      // number of words transfered per channel
+#define BURST       16           // number of words per transaction
+#define DEPTH       976          // channels depth (4 Kbytes SPSC vseg)
+
+mwmr_channel_t         mwmr;
+
+unsigned int           mwmr_buf[DEPTH];
+
+volatile unsigned int  init_ok = 0;
+
+/////////////////////////////////////////////
+__attribute__ ((constructor)) void producer()
+{
+    spsc_channel_t*  spsc;
+    mwmr_span_t      span;
+    unsigned int     buf[BURST];
+    unsigned int     n;
+    unsigned int     i;
+
+    // initialises channels
+    mwmr_init( &mwmr, mwmr_buf, 1, DEPTH );
+    spsc = spsc_vseg_init( "chanbench", "chb_fifo", 1 );
+
+    if ( spsc->depth != DEPTH ) giet_exit("Producer : bad SPSC channel depth");
+
+    init_ok = 1;
+
+    // MWMR channel
+    for ( n = 0 ; n < NB_TOKENS ; n = n + BURST )
+    {
+        for ( i = 0 ; i < BURST ; i++ ) buf[i] = n + i;
+        mwmr_write( &mwmr, buf, BURST );
+    }
+
+    // MWMR channel / zero-copy
+    for ( n = 0 ; n < NB_TOKENS ; n = n + BURST )
+    {
+        mwmr_write_reserve( &mwmr, &span, BURST );
+        for ( i = 0 ; i < BURST ; i++ ) *mwmr_span_item( &span, i ) = n + i;
+        mwmr_write_commit( &mwmr, &span );
+    }
+
+    // SPSC channel
+    for ( n = 0 ; n < NB_TOKENS ; n = n + BURST )
+    {
+        for ( i = 0 ; i < BURST ; i++ ) buf[i] = n + i;
+        spsc_write( spsc, buf, BURST );
+    }
+
+    giet_exit( "Producer completed" );
+
+} // end producer()
+
+/////////////////////////////////////////////
+__attribute__ ((constructor)) void consumer()
+{
+    spsc_channel_t*  spsc;
+    mwmr_span_t      span;
+    unsigned int     buf[BURST];
+    unsigned int     n;
+    unsigned int     i;
+    unsigned int     start;
+    unsigned int     mwmr_cycles;
+    unsigned int     zero_cycles;
+    unsigned int     spsc_cycles;
+    unsigned int     errors = 0;
+
+    // get processor identifiers
+    unsigned int     x;
+    unsigned int     y;
+    unsigned int     p;
+    giet_proc_xyp( &x, &y, &p );
+
+    // allocates a private TTY
+    giet_tty_alloc( 0 );
+
+    while ( init_ok == 0 ) asm volatile( "nop" );
+
+    spsc = spsc_vseg_get( "chanbench", "chb_fifo" );
+
+    giet_tty_printf("\n[CHANBENCH] consumer starts on P[%d,%d,%d] at cycle %d\n"
+                    " tokens = %d / burst = %d / depth = %d\n",
+                    x, y, p, giet_proctime(), NB_TOKENS, BURST, DEPTH );
+
+    // MWMR channel
+    start = giet_proctime();
+    for ( n = 0 ; n < NB_TOKENS ; n = n + BURST )
+    {
+        mwmr_read( &mwmr, buf, BURST );
+        for ( i = 0 ; i < BURST ; i++ ) if ( buf[i] != n + i ) errors++;
+    }
+    mwmr_cycles = giet_proctime() - start;
+
+    // MWMR channel / zero-copy
+    start = giet_proctime();
+    for ( n = 0 ; n < NB_TOKENS ; n = n + BURST )
+    {
+        mwmr_read_acquire( &mwmr, &span, BURST );
+        for ( i = 0 ; i < BURST ; i++ ) if ( *mwmr_span_item( &span, i ) != n + i ) errors++;
+        mwmr_read_release( &mwmr, &span );
+    }
+    zero_cycles = giet_proctime() - start;
+
+    // SPSC channel
+    start = giet_proctime();
+    for ( n = 0 ; n < NB_TOKENS ; n = n + BURST )
+    {
+        spsc_read( spsc, buf, BURST );
+        for ( i = 0 ; i < BURST ; i++ ) if ( buf[i] != n + i ) errors++;
+    }
+    spsc_cycles = giet_proctime() - start;
+
+    if ( errors ) giet_tty_printf("\n[CHANBENCH ERROR] %d bad tokens\n", errors );
+
+    giet_tty_printf("\n[CHANBENCH] MWMR channel : %d cycles / %d words per 1000 cycles\n"
+                    "[CHANBENCH] MWMR / zero : %d cycles / %d words per 1000 cycles\n"
+                    "[CHANBENCH] SPSC channel : %d cycles / %d words per 1000 cycles\n",
+                    mwmr_cycles, (NB_TOKENS * 1000) / mwmr_cycles,
+                    zero_cycles, (NB_TOKENS * 1000) / zero_cycles,
+                    spsc_cycles, (NB_TOKENS * 1000) / spsc_cycles );
+
+    giet_exit( "Consumer completed" );
+
+} // end consumer()
+
+// Local Variables:
+// tab-width: 4
+// c-basic-offset: 4
+// c-file-offsets:((innamespace . 0)(inline-open . 0))
+// indent-tabs-mode: nil
+// End:
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=4:softtabstop=4
+
@@ -0,0 +1,95 @@
+#!/usr/bin/env python
+
+from mapping import *
+
+##################################################################################
+#   file   : heapbench.py
+#   date   : october 2015
+#   author : Alain Greiner
+##################################################################################
+#  This file describes the mapping of the "heapbench" micro-benchmark
+#  on a multi-clusters, multi-processors architecture.
+#  This application contains one single task, running on proc[0,0,0].
+#  The mapping of virtual segments is the following:
+#    - There is one data vseg, one code vseg, one stack vseg and
+#      one heap vseg, all mapped in cluster[0][0].
+#  This mapping uses 5 platform parameters, (obtained from the "mapping" argument)
+#    - x_size    : number of clusters in a row
+#    - y_size    : number of clusters in a column
+#    - x_width   : number of bits coding x coordinate
+#    - y_width   : number of bits coding y coordinate
+#    - nprocs    : number of processors per cluster
+##################################################################################
+
+######################
+def extend( mapping ):
+
+    x_size    = mapping.x_size
+    y_size    = mapping.y_size
+    nprocs    = mapping.nprocs
+    x_width   = mapping.x_width
+    y_width   = mapping.y_width
+
+    # define vsegs base & size
+    code_base  = 0x10000000
+    code_size  = 0x00010000     # 64 Kbytes
+
+    data_base  = 0x20000000
+    data_size  = 0x00010000     # 64 Kbytes
+
+    stack_base = 0x40000000
+    stack_size = 0x00010000     # 64 Kbytes
+
+    heap_base  = 0x60000000
+    heap_size  = 0x00200000     # 2 Mbytes
+
+    # create vspace
+    vspace = mapping.addVspace( name = 'heapbench', startname = 'hpb_data', active = False )
+
+    # data vseg
+    mapping.addVseg( vspace, 'hpb_data', data_base , data_size,
+                     'C_WU', vtype = 'ELF', x = 0, y = 0, pseg = 'RAM',
+                     binpath = 'bin/heapbench/appli.elf',
+                     local = False )
+
+    # code vseg
+    mapping.addVseg( vspace, 'hpb_code', code_base , code_size,
+                     'CXWU', vtype = 'ELF', x = 0, y = 0, pseg = 'RAM',
+                     binpath = 'bin/heapbench/appli.elf',
+                     local = False )
+
+    # stack vseg
+    mapping.addVseg( vspace, 'hpb_stack', stack_base, stack_size,
+                     'C_WU', vtype = 'BUFFER', x = 0 , y = 0 , pseg = 'RAM',
+                     local = False )
+
+    # heap vseg
+    mapping.addVseg( vspace, 'hpb_heap', heap_base, heap_size,
+                     'C_WU', vtype = 'HEAP', x = 0, y = 0, pseg = 'RAM',
+                     local = False, big = True )
+
+    # task
+    mapping.addTask( vspace, 'main', 0, 0, 0, 0, 'hpb_stack', 'hpb_heap', 0 )
+
+    # extend mapping name
+    mapping.name += '_hpb'
+
+    return vspace  # useful for test
+
+################################ test ##################################################
+
+if __name__ == '__main__':
+
+    vspace = extend( Mapping( 'test', 2, 2, 4 ) )
+    print vspace.xml()
+
+
+# Local Variables:
+# tab-width: 4;
+# c-basic-offset: 4;
+# c-file-offsets:((innamespace . 0)(inline-open . 0));
+# indent-tabs-mode: nil;
+# End:
+#
+# vim: filetype=python:expandtab:shiftwidth=4:tabstop=4:softtabstop=4
+
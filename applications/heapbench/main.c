@@ -0,0 +1,102 @@
+//////////////////////////////////////////////////////////////////////////////////
+// File    : main.c  (for heapbench)
+// Date    : October 2015
+// Author  : Alain Greiner <alain.greiner@lip6.fr>
+//
+// This single thread application is a stress micro-benchmark for the free()
+// function of the user heap allocator (malloc.c).
+// It allocates MAX_BLOCKS blocks of BLOCK_SIZE bytes (1 Mbytes, that must fit
+// in the heap, as malloc() exits on failure), and releases them in two phases:
+// - phase 1 : the even blocks are released. The companion blocks are still
+//   allocated, and the free list for this block size grows at each free().
+// - phase 2 : the odd blocks are released. Each free() merges the released
+//   block with its companion, and the free list shrinks at each free().
+// For each batch of BATCH free() calls, it displays the average number of
+// cycles per free(), that must not depend on the free list length.
+// The BLOCK_SIZE is larger than the per-thread cache blocks, and all free()
+// calls go to the heap.
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "stdio.h"
+#include "malloc.h"
+
+#define BLOCK_SIZE  2048         // bytes per allocated block
+#define MAX_BLOCKS  512          // number of allocated blocks
+#define BATCH       64           // number of free() per measure
+
+void*   blocks[MAX_BLOCKS];
+
+///////////////////////////////////////////////////////////////////////////////
+// This function releases the blocks[first], blocks[first+2], ... blocks,
+// and displays the average cost of free() for each batch of BATCH blocks.
+///////////////////////////////////////////////////////////////////////////////
+void release( unsigned int first,
+              unsigned int nblocks,
+              unsigned int phase )
+{
+    unsigned int n;
+    unsigned int count = 0;
+    unsigned int cycles = 0;
+    unsigned int start;
+
+    for ( n = first ; n < nblocks ; n = n + 2 )
+    {
+        start  = giet_proctime();
+        free( blocks[n] );
+        cycles = cycles + giet_proctime() - start;
+        count++;
+
+        if ( (count == BATCH) || (n + 2 >= nblocks) )
+        {
+            giet_tty_printf(" phase %d / block %d : %d cycles per free\n",
+                            phase, n, cycles / count );
+            count  = 0;
+            cycles = 0;
+        }
+    }
+} // end release()
+
+/////////////////////////////////////////
+__attribute__ ((constructor)) void main()
+{
+    unsigned int nblocks;
+
+    // get processor identifiers
+    unsigned int x;
+    unsigned int y;
+    unsigned int p;
+    giet_proc_xyp( &x, &y, &p );
+
+    // allocates a private TTY
+    giet_tty_alloc( 0 );
+
+    heap_init( x, y );
+
+    giet_tty_printf("\n[HEAPBENCH] starts on P[%d,%d,%d] at cycle %d\n"
+                    " block size = %d / batch = %d\n",
+                    x, y, p, giet_proctime(), BLOCK_SIZE, BATCH );
+
+    // allocate the blocks
+    for ( nblocks = 0 ; nblocks < MAX_BLOCKS ; nblocks++ )
+    {
+        blocks[nblocks] = malloc( BLOCK_SIZE );
+    }
+
+    giet_tty_printf("\n[HEAPBENCH] %d blocks allocated\n", nblocks );
+
+    // release even blocks (no merge) then odd blocks (merge)
+    release( 0, nblocks, 1 );
+    release( 1, nblocks, 2 );
+
+    giet_exit( "completed" );
+
+} // end main()
+
+// Local Variables:
+// tab-width: 4
+// c-basic-offset: 4
+// c-file-offsets:((innamespace . 0)(inline-open . 0))
+// indent-tabs-mode: nil
+// End:
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=4:softtabstop=4
+
@@ -0,0 +1,200 @@
+//////////////////////////////////////////////////////////////////////////////////
+// File    : main.c  (for lockbench)
+// Date    : October 2015
+// Author  : Alain Greiner <alain.greiner@lip6.fr>
+//
+// This multi-threaded application is a micro-benchmark measuring the
+// throughput of the user locks under high contention:
+// - the ticket lock (user_lock_t), that uses a proportional backoff
+//   when the GIET_LOCK_BACKOFF parameter is non zero,
+// - the MCS queue lock (mcs_lock_t), that is used as reference,
+// - the kernel spin lock (spin_lock_t) protecting the futexes of a vspace,
+//   that uses a proportional backoff when GIET_LOCK_BACKOFF is non zero:
+//   each critical section is a giet_futex_wake() system call on a futex
+//   without waiting task, that only takes and releases this lock.
+// There is one task per processor. Each task takes NB_ITERATIONS times the
+// lock, executes a short critical section (shared counter increment), and
+// a short private computation (DELAY iterations) before the next request.
+// Task running on processor P(0,0,0) initialises the heaps, the locks and
+// the barrier, checks the shared counter, and displays for each lock the
+// throughput (number of critical sections per 1000 cycles).
+// The gain of the proportional backoff (for both the user ticket lock and
+// the kernel spin lock) is obtained by comparing the results of two builds
+// of the GIET and the application, with GIET_LOCK_BACKOFF set to 0 and 1.
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "stdio.h"
+#include "malloc.h"
+#include "user_lock.h"
+#include "user_barrier.h"
+
+#define NB_ITERATIONS   200
+#define DELAY           100
+
+#define PRINTF(...) ({ if ( proc_id==0) { giet_tty_printf(__VA_ARGS__); } })
+
+user_lock_t           ticket_lock;
+
+mcs_lock_t            mcs_lock;
+
+giet_sqt_barrier_t    barrier;
+
+volatile unsigned int counter;
+
+unsigned int          futex;
+
+volatile unsigned int init_ok = 0;
+
+////////////////////////////////////////////
+static void private_work( unsigned int n )
+{
+    volatile unsigned int i;
+
+    for ( i = 0 ; i < n ; i++ ) asm volatile ("nop");
+}
+
+////////////////////////////////////////
+__attribute__((constructor)) void main()
+////////////////////////////////////////
+{
+    // get processor identifier
+    unsigned int x;
+    unsigned int y;
+    unsigned int p;
+    giet_proc_xyp( &x, &y, &p );
+
+    // get processors number
+    unsigned int x_size;
+    unsigned int y_size;
+    unsigned int nprocs;
+    giet_procs_number( &x_size, &y_size, &nprocs );
+
+    // compute continuous processor index & number of procs
+    unsigned int proc_id   = (((x * y_size) + y) * nprocs) + p;
+    unsigned int n_procs   = x_size * y_size * nprocs;
+    unsigned int expected  = n_procs * NB_ITERATIONS;
+
+    unsigned int start;
+    unsigned int cycles;
+    unsigned int i;
+
+    // P[0,0,0] makes initialisation
+    if ( proc_id == 0 )
+    {
+        // get a private TTY for P[0,0,0]
+        giet_tty_alloc( 0 );
+
+        // initializes distributed heap
+        unsigned int cx;
+        unsigned int cy;
+        for ( cx = 0 ; cx < x_size ; cx++ )
+        {
+            for ( cy = 0 ; cy < y_size ; cy++ )
+            {
+                heap_init( cx , cy );
+            }
+        }
+
+        // initialises locks and barrier
+        lock_init( &ticket_lock );
+        mcs_lock_init( &mcs_lock );
+        sqt_barrier_init( &barrier, x_size, y_size, nprocs );
+
+        PRINTF("\n[LOCKBENCH] P[0,0,0] completes initialisation at cycle %d\n"
+               " nprocs = %d / iterations = %d / backoff = %d\n",
+               giet_proctime() , n_procs, NB_ITERATIONS, GIET_LOCK_BACKOFF );
+
+        // activates all other processors
+        init_ok = 1;
+    }
+    else
+    {
+        while ( init_ok == 0 ) asm volatile("nop\n nop\n nop");
+    }
+
+    ///////////// ticket lock
+
+    sqt_barrier_wait( &barrier );
+
+    start = giet_proctime();
+
+    for ( i = 0 ; i < NB_ITERATIONS ; i++ )
+    {
+        lock_acquire( &ticket_lock );
+        counter = counter + 1;
+        lock_release( &ticket_lock );
+
+        private_work( DELAY );
+    }
+
+    sqt_barrier_wait( &barrier );
+
+    cycles = giet_proctime() - start;
+
+    if ( counter != expected )
+        PRINTF("\n[LOCKBENCH ERROR] ticket lock : counter = %d / expected = %d\n",
+               counter, expected );
+
+    PRINTF("\n[LOCKBENCH] ticket lock : %d cycles / %d sections per 1000 cycles\n",
+           cycles, (expected * 1000) / cycles );
+
+    ///////////// MCS lock
+
+    sqt_barrier_wait( &barrier );
+    if ( proc_id == 0 ) counter = 0;
+    sqt_barrier_wait( &barrier );
+
+    start = giet_proctime();
+
+    for ( i = 0 ; i < NB_ITERATIONS ; i++ )
+    {
+        mcs_lock_acquire( &mcs_lock );
+        counter = counter + 1;
+        mcs_lock_release( &mcs_lock );
+
+        private_work( DELAY );
+    }
+
+    sqt_barrier_wait( &barrier );
+
+    cycles = giet_proctime() - start;
+
+    if ( counter != expected )
+        PRINTF("\n[LOCKBENCH ERROR] MCS lock : counter = %d / expected = %d\n",
+               counter, expected );
+
+    PRINTF("\n[LOCKBENCH] MCS lock    : %d cycles / %d sections per 1000 cycles\n",
+           cycles, (expected * 1000) / cycles );
+
+    ///////////// kernel spin lock (futex lock)
+
+    sqt_barrier_wait( &barrier );
+
+    start = giet_proctime();
+
+    for ( i = 0 ; i < NB_ITERATIONS ; i++ )
+    {
+        giet_futex_wake( &futex, 1 );
+
+        private_work( DELAY );
+    }
+
+    sqt_barrier_wait( &barrier );
+
+    cycles = giet_proctime() - start;
+
+    PRINTF("\n[LOCKBENCH] kernel lock : %d cycles / %d sections per 1000 cycles"
+           " / backoff = %d\n", cycles, (expected * 1000) / cycles, GIET_LOCK_BACKOFF );
+
+    giet_exit("Completed");
+
+} // end main()
+
+// Local Variables:
+// tab-width: 4
+// c-basic-offset: 4
+// c-file-offsets:((innamespace . 0)(inline-open . 0))
+// indent-tabs-mode: nil
+// End:
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=4:softtabstop=4
+
@@ -5,21 +5,31 @@
 #include <malloc.h>
 #include <math.h>
 #include <hard_config.h>
-#include <user_sqt_lock.h>
+#include <work_stealing.h>
 
 #define FIELD_OF_VIEW   (70.f * M_PI / 180.f)   // Camera field of view
 #define TEX_SIZE        (32)                    // Texture size in pixels
 #define CEILING_COLOR   (0xBB)                  // lite gray
 #define FLOOR_COLOR     (0x33)                  // dark gray
+#define SLICE_GRAIN     (8)                     // Slices per job (at most)
+#define WS_DEPTH        (32)                    // Jobs per worker deque (at most)
+
+// Range of slices rendered by a job
+
+typedef struct
+{
+    Game *game;
+    unsigned int x0;                            // first slice index
+    unsigned int x1;                            // last slice index + 1
+} SliceRange;
 
 // Globals
 
 static unsigned char*           buf[2];         // framebuffer
 static void *                   sts[2];         // for fbf_cma
 static unsigned int             cur_buf;        // current framebuffer
-static volatile unsigned int    slice_x;        // slice index (shared)
-static sqt_lock_t               slice_x_lock;   // slice index lock
-static volatile unsigned int    slice_cnt;      // slice count (shared)
+static ws_runtime_t             ws;             // work-stealing runtime
+static ws_deque_t *             ws_main;        // worker of the main task
 
 // Textures indexed by block number
 static unsigned char *g_tex[] =
@@ -200,15 +210,57 @@ static unsigned char *dispLoadTexture(char *path)
     return tex;
 }
 
+static void dispRenderSlice(Game *game, unsigned int x)
+{
+    int type;
+    float angle, dist, tx;
+
+    angle = game->player.dir - FIELD_OF_VIEW / 2.f +
+            x * FIELD_OF_VIEW / FBUF_X_SIZE;
+
+    // Cast a ray to get wall distance
+    dist = dispRaycast(game, &type, &tx, angle);
+
+    // Perspective correction
+    dist *= cos(game->player.dir - angle);
+
+    // Draw ceiling, wall and floor
+    dispDrawSlice(game, x, FBUF_Y_SIZE / dist, type, tx * TEX_SIZE);
+}
+
+static void dispRenderRange(ws_deque_t *self, void *arg)
+{
+    SliceRange *range = arg;
+    unsigned int x;
+
+    if (range->x1 - range->x0 > SLICE_GRAIN) {
+        // Split the range: the left half can be stolen by another worker
+        unsigned int mid = (range->x0 + range->x1) / 2;
+        SliceRange left = { range->game, range->x0, mid };
+        SliceRange right = { range->game, mid, range->x1 };
+        ws_group_t group;
+
+        ws_group_init(&group);
+        ws_spawn(self, &group, dispRenderRange, &left);
+        dispRenderRange(self, &right);
+        ws_sync(self, &group);
+    }
+    else {
+        for (x = range->x0; x < range->x1; x++)
+            dispRenderSlice(range->game, x);
+    }
+}
+
 // Exported functions
 
 void dispInit()
 {
     unsigned int w, h, p;
 
-    // Initialize lock
+    // Initialize work-stealing runtime
     giet_procs_number(&w, &h, &p);
-    sqt_lock_init(&slice_x_lock, w, h, p);
+    ws_init(&ws, w, h, p, WS_DEPTH);
+    ws_main = ws_self(&ws);
 
     // Allocate framebuffer
     buf[0] = malloc(FBUF_X_SIZE * FBUF_Y_SIZE);
@@ -228,61 +280,21 @@ void dispInit()
     g_tex[4] = dispLoadTexture("misc/wood_32.raw");
 
     cur_buf = 0;
-    slice_cnt = 0;
-    slice_x = FBUF_X_SIZE;
 }
 
-int dispRenderSlice(Game *game)
+void dispWorker()
 {
-    unsigned int x;
-    int type;
-    float angle, dist, tx;
-
-    sqt_lock_acquire(&slice_x_lock);
-
-    if (slice_x == FBUF_X_SIZE) {
-        // No more work to do for this frame
-        sqt_lock_release(&slice_x_lock);
-        return 0;
-    }
-    else {
-        // Keep slice coordinate
-        x = slice_x++;
-    }
-
-    sqt_lock_release(&slice_x_lock);
-
-    angle = game->player.dir - FIELD_OF_VIEW / 2.f +
-            x * FIELD_OF_VIEW / FBUF_X_SIZE;
-
-    // Cast a ray to get wall distance
-    dist = dispRaycast(game, &type, &tx, angle);
-
-    // Perspective correction
-    dist *= cos(game->player.dir - angle);
-
-    // Draw ceiling, wall and floor
-    dispDrawSlice(game, x, FBUF_Y_SIZE / dist, type, tx * TEX_SIZE);
-
-    // Signal this slice is done
-    atomic_increment((unsigned int*)&slice_cnt, 1);
-
-    return 1;
+    // Execute jobs stolen from other workers
+    ws_run(&ws);
 }
 
 void dispRender(Game *game)
 {
     int start = giet_proctime();
+    SliceRange all = { game, 0, FBUF_X_SIZE };
 
-    // Start rendering
-    slice_cnt = 0;
-    slice_x = 0;
-
-    // Render slices
-    while (dispRenderSlice(game));
-
-    // Wait for completion
-    while (slice_cnt != FBUF_X_SIZE);
+    // Render all slices, and wait for completion
+    dispRenderRange(ws_main, &all);
 
     // Flip framebuffer
     giet_fbf_cma_display(cur_buf);
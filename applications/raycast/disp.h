@@ -4,7 +4,7 @@
 #include "game.h"
 
 void dispInit();
-int dispRenderSlice(Game *game);
+void dispWorker();
 void dispRender(Game *game);
 
 #endif // __DISP_H
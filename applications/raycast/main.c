@@ -12,12 +12,8 @@ __attribute__((constructor)) void render()
     // Wait for main initialization
     while (!init_sync);
 
-    Game *game = gameInstance();
-
-    // Render slices as soon as it's available
-    while (1) {
-        dispRenderSlice(game);
-    }
+    // Render slices as soon as they are available
+    dispWorker();
 }
 
 __attribute__((constructor)) void main()
@@ -249,7 +249,71 @@ static void cmd_kill(int argc, char **argv)
 ///////////////////////////////////////////////
 static void cmd_ps(int argc, char** argv)
 {
-    giet_tasks_status();
+    giet_task_stats_t stats[8];
+    unsigned int      first = 0;
+    int               n;
+    int               i;
+
+    // get the tasks accounting informations, 8 tasks at a time
+    do
+    {
+        n = giet_tasks_stats( stats, first, 8 );
+
+        for ( i = 0 ; i < n ; i++ )
+        {
+            char* state;
+            if      ( stats[i].running )     state = "running";
+            else if ( stats[i].norun == 0 )  state = "runable";
+            else                             state = "blocked";
+
+            giet_tty_printf(" - %s/%s on P[%d,%d,%d] : %s\n"
+                            "     run = %d / switch = %d / preempt = %d"
+                            " / ioc_wait = %d / coproc_wait = %d\n",
+                            stats[i].vspace, stats[i].name,
+                            stats[i].x, stats[i].y, stats[i].p, state,
+                            stats[i].run, stats[i].switches, stats[i].preempts,
+                            stats[i].ioc_wait, stats[i].cop_wait );
+        }
+        first = first + n;
+    }
+    while ( n == 8 );
+}
+
+///////////////////////////////////////////////
+static void cmd_locks(int argc, char** argv)
+{
+    giet_lock_stats_t stats[16];
+    unsigned int      count = 8;
+    int               n;
+    int               i;
+
+    // optional argument : number of displayed locks
+    if ( argc > 1 )
+    {
+        count = 0;
+        for ( i = 0 ; (argv[1][i] >= '0') && (argv[1][i] <= '9') ; i++ )
+            count = (count * 10) + (argv[1][i] - '0');
+    }
+    if ( count > 16 ) count = 16;
+
+    // get the kernel locks with the largest waiting time
+    n = giet_locks_stats( stats, count );
+
+    if ( n < 0 )
+    {
+        giet_tty_printf("\n  error : locks profiling not enabled\n");
+        return;
+    }
+
+    for ( i = 0 ; i < n ; i++ )
+    {
+        giet_tty_printf(" - %s (%x)\n"
+                        "     acquires = %d / contended = %d"
+                        " / wait = %d / max_hold = %d\n",
+                        stats[i].name, stats[i].vaddr,
+                        stats[i].acquires, stats[i].contended,
+                        stats[i].wait, stats[i].max_hold );
+    }
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -266,6 +330,7 @@ struct command_t cmd[] =
     { "exec",       cmd_exec },
     { "kill",       cmd_kill },
     { "ps",         cmd_ps },
+    { "locks",      cmd_locks },
     { NULL,         NULL }
 };
 
@@ -3,41 +3,55 @@
 // Date   :  November 2013
 // Author :  Cesar Fuguet Tortolero <cesar.fuguet-tortolero@lip6.fr>
 ///////////////////////////////////////////////////////////////////////////////
-// This multi-threaded application implement a multi-stage sort application.
-// The various stages are separated by synchronisation barriers.
-// There is one thread per physical processors. Computation is organised as
-// a binary tree: All threads contribute to the first stage of parallel sort
-// but, the number of participating threads is divided by 2 at each next stage.
-//       Number_of_stages = number of barriers = log2(Number_of_threads)
+// This multi-threaded application implement a parallel merge sort,
+// on top of the work-stealing runtime (work_stealing.h).
+// There is one thread per physical processor. The thread 0 initialises
+// the array, and recursively splits the sort in two halves: the first half
+// is spawned as a job that can be stolen by any other thread, and the two
+// sorted halves are merged when both are completed. The other threads
+// only execute the stolen jobs. The array parts smaller than SORT_GRAIN
+// are sorted by a bubble sort.
 //
 // Constraints :
-// - It supports up to 1024 processors and the number of processors
-//   must be a power of 2.
-// _ The array of values to be sorted (ARRAY_LENGTH) must be power of 2 
-//   larger than the number of processors.
+// - The array of values to be sorted (ARRAY_LENGTH) must be a power of 2 
+//   larger than SORT_GRAIN.
 // - This application uses a private TTY terminal, shared by all threads,
-//   that is protectted by an user-level SQT lock.
+//   that is protectted by an user-level lock.
+// - The heap must be defined in all clusters (work-stealing deques).
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "stdio.h"
 #include "mapping_info.h"
-#include "user_barrier.h"
+#include "malloc.h"
 #include "user_lock.h"
+#include "work_stealing.h"
 
 #define ARRAY_LENGTH    0x400
-#define IPT             (ARRAY_LENGTH / threads) // ITEMS PER THREAD
+#define SORT_GRAIN      0x20       // max number of items sorted by one job
+#define WS_DEPTH        32         // max number of jobs per worker deque
 
 // macro to use a shared TTY
-#define printf(...)     lock_acquire( &tty_lock ); \
+#define printf(...)     cfg_lock_acquire( &tty_lock ); \
                         giet_tty_printf(__VA_ARGS__);  \
-                        lock_release( &tty_lock )
+                        cfg_lock_release( &tty_lock )
 
 int              array0[ARRAY_LENGTH];
 int              array1[ARRAY_LENGTH];
 
 volatile int     init_ok = 0;
-giet_barrier_t   barrier[10];
-user_lock_t      tty_lock;   
+ws_runtime_t     ws;
+cfg_lock_t       tty_lock;   
+
+// arguments of a sort job : the items [pos, pos+length[ of the src array
+// are sorted in the src array if to_dst is zero, in the dst array otherwise.
+typedef struct sort_args_s
+{
+    int*          src;
+    int*          dst;
+    unsigned int  pos;
+    unsigned int  length;
+    unsigned int  to_dst;
+} sort_args_t;
 
 void bubbleSort(
         int * array,
@@ -52,13 +66,18 @@ void merge(
         int init_pos_b,
         int init_pos_result);
 
+void sortJob(
+        ws_deque_t * self,
+        void * arg);
+
 //////////////////////////////////////////
 __attribute__ ((constructor)) void main()
 //////////////////////////////////////////
 {
-    int * src_array = NULL;
-    int * dst_array = NULL;
+    int * dst_array = array1;
     int i;
+    unsigned int x;
+    unsigned int y;
     unsigned int x_size;
     unsigned int y_size;
     unsigned int nprocs;
@@ -74,98 +93,57 @@ __attribute__ ((constructor)) void main()
     giet_procs_number( &x_size , &y_size , &nprocs );
     threads = x_size * y_size * nprocs;
 
-    // thread 0 makes TTY and barrier initialisations
-    // other threads wait initialisation completion.
-    if ( thread_id == 0 )
-    {
-        // request a shared TTY used by all threads
-        giet_tty_alloc(1);
-        
-        // TTY lock initialisation
-        lock_init( &tty_lock );
-
-        printf("\n[ SORT T0 ] Starting sort application with %d threads "
-                 "at cycle %d\n", threads, time_start);
-
-        // Barriers Initialization
-        for (i = 0; i < __builtin_ctz( threads ); i++)
-        {
-            barrier_init( &barrier[i], threads >> i );
-        }
-
-        init_ok = 1;
-    }
-    else
+    // thread 0 makes TTY, heaps and runtime initialisations
+    // other threads wait initialisation completion, and execute jobs.
+    if ( thread_id != 0 )
     {
         while( !init_ok );
-    }
-
-    // each thread checks number of tasks
-    if ( (threads != 1)   && (threads != 2)   && (threads != 4)   && 
-         (threads != 8)   && (threads != 16 ) && (threads != 32)  && 
-         (threads != 64)  && (threads != 128) && (threads != 256) && 
-         (threads != 512) && (threads != 1024) )
-    {
-        giet_exit("error : number of processors must be power of 2");
-    }
 
+        ws_run( &ws );
 
-    // Each thread contribute to Array Initialization
-    for (i = IPT * thread_id; i < IPT * (thread_id + 1); i++)
-    {
-        array0[i] = giet_rand();
+        giet_exit("Completed");
     }
 
-    // all threads contribute to the first stage of parallel sort
-    printf("[ SORT T%d ] Stage 0: Sorting...\n\r", thread_id);
-
-    bubbleSort(array0, IPT, IPT * thread_id);
+    // request a shared TTY used by all threads
+    giet_tty_alloc(1);
+        
+    // TTY lock initialisation
+    cfg_lock_init( &tty_lock );
 
-    printf("[ SORT T%d ] Finishing Stage 0\n\r", thread_id);
+    printf("\n[ SORT T0 ] Starting sort application with %d threads "
+             "at cycle %d\n", threads, time_start);
 
-    // the number of threads is divided by 2 at each next stage
-    for (i = 0; i < __builtin_ctz( threads ); i++)
+    // heaps and work-stealing runtime initialisation
+    for ( x = 0 ; x < x_size ; x++ )
     {
-        barrier_wait( &barrier[i] );
-
-        if((thread_id % (2 << i)) != 0)
+        for ( y = 0 ; y < y_size ; y++ )
         {
-            printf("[ SORT T%d ] Quit\n\r", thread_id );
-            giet_exit("Completed");
+            heap_init( x , y );
         }
+    }
+    ws_init( &ws, x_size, y_size, nprocs, WS_DEPTH );
 
-        printf("[ SORT T%d ] Stage %d: Sorting...\n\r", thread_id, i+1);
+    init_ok = 1;
 
-        if((i % 2) == 0)
-        {
-            src_array = &array0[0];
-            dst_array = &array1[0];
-        }
-        else
-        {
-            src_array = &array1[0];
-            dst_array = &array0[0];
-        }
+    // Array Initialization
+    for (i = 0; i < ARRAY_LENGTH; i++)
+    {
+        array0[i] = giet_rand();
+    }
 
-        merge(src_array, dst_array
-                , IPT << i
-                , IPT * thread_id
-                , IPT * (thread_id + (1 << i))
-                , IPT * thread_id
-                );
+    printf("[ SORT T0 ] Sorting...\n\r");
 
-        printf("[ SORT T%d ] Finishing Stage %d\n\r", thread_id, i + 1);
-    }
+    // recursive parallel sort from array0 to array1
+    sort_args_t args = { array0, array1, 0, ARRAY_LENGTH, 1 };
+    sortJob( ws_self( &ws ), &args );
+
+    // release the other threads
+    ws_stop( &ws );
 
     int success;
     int failure_index;
 
     // Verify the resulting array
-    if(thread_id != 0)
-    {
-        giet_exit("error: only thread 0 should get here");
-    }
-
     success = 1;
     for(i=0; i<(ARRAY_LENGTH-1); i++)
     {
@@ -201,6 +179,42 @@ __attribute__ ((constructor)) void main()
     giet_exit("Completed");
 }
 
+//////////////////////////////
+void sortJob( ws_deque_t * self,
+              void *       arg )
+{
+    sort_args_t * a = arg;
+    unsigned int  i;
+
+    if ( a->length <= SORT_GRAIN )   // sort in src, copy to dst if required
+    {
+        bubbleSort( a->src, a->length, a->pos );
+
+        if ( a->to_dst )
+        {
+            for ( i = a->pos ; i < (a->pos + a->length) ; i++ )
+            {
+                a->dst[i] = a->src[i];
+            }
+        }
+    }
+    else                             // sort both halves, and merge
+    {
+        unsigned int half  = a->length >> 1;
+        sort_args_t  left  = { a->src, a->dst, a->pos, half, !a->to_dst };
+        sort_args_t  right = { a->src, a->dst, a->pos + half, half, !a->to_dst };
+        ws_group_t   group;
+
+        ws_group_init( &group );
+        ws_spawn( self, &group, sortJob, &left );
+        sortJob( self, &right );
+        ws_sync( self, &group );
+
+        if ( a->to_dst ) merge( a->src, a->dst, half, a->pos, a->pos + half, a->pos );
+        else             merge( a->dst, a->src, half, a->pos, a->pos + half, a->pos );
+    }
+}
+
 ////////////////////////////////////
 void bubbleSort( int *        array,
                  unsigned int length,
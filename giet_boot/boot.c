@@ -51,9 +51,10 @@
 // 3) The Giet-VM implement one private scheduler per processor.
 //    For each application, the tasks are statically allocated to processors
 //    and there is no task migration during execution.
-//    Each sheduler occupies 8K bytes, and contains up to 14 task contexts 
-//    The task context [13] is reserved for the "idle" task that does nothing, and
-//    is launched by the scheduler when there is no other runable task.
+//    Each sheduler has a variable size, depending on the number of tasks placed
+//    on the processor: it contains one task context per task, and one last
+//    task context reserved for the "idle" task that does nothing, and is 
+//    launched by the scheduler when there is no other runable task.
 ///////////////////////////////////////////////////////////////////////////////////
 // Implementation Notes:
 //
@@ -911,6 +912,92 @@ void boot_get_sched_vaddr( unsigned int  cluster_id,
     }
 } // end boot_get_sched_vaddr()
 
+///////////////////////////////////////////////////////////////////////////////
+// This function computes, for each processor in the cluster defined by the
+// cluster_id argument, the number of tasks placed on this processor by the
+// mapping, and registers it in the ntasks[lpid] array.
+// It returns the total length (bytes) required by the schedulers of all
+// processors in the cluster.
+///////////////////////////////////////////////////////////////////////////////
+unsigned int boot_get_sched_tasks( unsigned int  cluster_id,
+                                   unsigned int* ntasks )
+{
+    mapping_header_t*  header  = (mapping_header_t *)SEG_BOOT_MAPPING_BASE;
+    mapping_cluster_t* cluster = _get_cluster_base(header);
+    mapping_task_t*    task    = _get_task_base(header);
+
+    unsigned int nprocs = cluster[cluster_id].procs;
+    unsigned int length = 0;
+    unsigned int task_id;
+    unsigned int lpid;
+
+    for ( lpid = 0 ; lpid < nprocs ; lpid++ ) ntasks[lpid] = 0;
+
+    for ( task_id = 0 ; task_id < header->tasks ; task_id++ )
+    {
+        if ( task[task_id].clusterid == cluster_id ) 
+        {
+            ntasks[task[task_id].proclocid]++;
+        }
+    }
+
+    for ( lpid = 0 ; lpid < nprocs ; lpid++ ) 
+    {
+        if ( ntasks[lpid] > GIET_NB_TASKS_PROC_MAX )
+        {
+            _printf("\n[BOOT ERROR] in boot_get_sched_tasks() : %d tasks"
+                    " on P[%d,%d,%d] / max is %d\n", ntasks[lpid],
+                    cluster[cluster_id].x, cluster[cluster_id].y, lpid,
+                    GIET_NB_TASKS_PROC_MAX );
+            _exit();
+        }
+
+        length = length + SCHED_SIZE( ntasks[lpid] );
+    }
+
+    return length;
+} // end boot_get_sched_tasks()
+
+///////////////////////////////////////////////////////////////////////////////
+// This function is executed in parallel by all processors P[x][y][0], 
+// before the page tables initialisation. It adjusts the length of the 
+// vseg containing the schedulers in cluster[x][y] to the length actually
+// required by the tasks placed on the local processors, in order to
+// allocate only the required physical memory. The length defined in the
+// mapping is an upper bound (virtual space reserved for the schedulers).
+///////////////////////////////////////////////////////////////////////////////
+void boot_sched_vseg_init( unsigned int x,
+                           unsigned int y )
+{
+    mapping_header_t* header = (mapping_header_t *)SEG_BOOT_MAPPING_BASE;
+    mapping_vseg_t*   vseg   = _get_vseg_base(header);
+    mapping_pseg_t*   pseg   = _get_pseg_base(header);
+
+    unsigned int cluster_id = (x * Y_SIZE) + y;
+    unsigned int ntasks[NB_PROCS_MAX];
+    unsigned int vseg_id;
+
+    // compute required length
+    unsigned int length = boot_get_sched_tasks( cluster_id , ntasks );
+
+    for ( vseg_id = 0 ; vseg_id < header->vsegs ; vseg_id++ )
+    {
+        if ( (vseg[vseg_id].type == VSEG_TYPE_SCHED) && 
+             (pseg[vseg[vseg_id].psegid].clusterid == cluster_id ) )
+        {
+            if ( vseg[vseg_id].length < length ) 
+            {
+                _printf("\n[BOOT ERROR] Sched segment too small in cluster[%d,%d]"
+                        " : length = %x / required = %x\n",
+                        x, y, vseg[vseg_id].length, length );
+                _exit();
+            }
+
+            vseg[vseg_id].length = length;
+        }
+    }
+} // end boot_sched_vseg_init()
+
 #if BOOT_DEBUG_SCHED
 /////////////////////////////////////////////////////////////////////////////
 // This debug function should be executed by only one procesor.
@@ -1011,6 +1098,8 @@ void boot_scheduler_init( unsigned int x,
     unsigned int         sched_vbase;          // schedulers array vbase address 
     unsigned int         sched_length;         // schedulers array length
     static_scheduler_t*  psched;               // pointer on processor scheduler
+    unsigned int         ntasks[NB_PROCS_MAX]; // number of tasks per processor
+    unsigned int         placed[NB_PROCS_MAX]; // number of placed tasks per proc
 
     unsigned int cluster_id = (x * Y_SIZE) + y;
     unsigned int cluster_xy = (x << Y_WIDTH) + y;  
@@ -1041,23 +1130,46 @@ void boot_scheduler_init( unsigned int x,
     // get scheduler array virtual base address in cluster[x,y]
     boot_get_sched_vaddr( cluster_id, &sched_vbase, &sched_length );
 
-    if ( sched_length < (nprocs<<13) ) // 8 Kbytes per scheduler
-    {
-        _printf("\n[BOOT ERROR] Sched segment too small in cluster[%d,%d]\n",
-                x, y );
-        _exit();
-    }
+    // get number of tasks per processor (the schedulers vseg length
+    // has been checked and adjusted by boot_sched_vseg_init())
+    boot_get_sched_tasks( cluster_id , ntasks );
 
     // loop on local processors
     for ( lpid = 0 ; lpid < nprocs ; lpid++ )
     {
         // get scheduler pointer and initialise the schedulers pointers array
-        psched = (static_scheduler_t*)(sched_vbase + (lpid<<13));
+        psched = (static_scheduler_t*)sched_vbase;
         _schedulers[x][y][lpid] = psched;
-
-        // initialise the "tasks" and "current" variables default values
-        psched->tasks   = 0;
-        psched->current = IDLE_TASK_INDEX;
+        sched_vbase = sched_vbase + SCHED_SIZE( ntasks[lpid] );
+
+        // initialise the "tasks" and "current" variables: 
+        // the idle task context is the last one
+        unsigned int idle = ntasks[lpid];
+        psched->tasks     = idle;
+        psched->current   = idle;
+        placed[lpid]      = 0;
+
+        // initialise the "runnable", "sigpend", "prio_mask" and "vspace_mask"
+        // bit-vectors, and the "ticking" flag
+        unsigned int word;
+        unsigned int level;
+        for (word = 0; word < SCHED_WORDS; word++)
+        {
+            psched->runnable[word] = 0;
+            psched->sigpend[word]  = 0;
+            for (level = 0; level < PRIORITY_LEVELS; level++)
+            {
+                psched->prio_mask[level][word] = 0;
+            }
+#if GIET_GANG_SCHEDULING
+            unsigned int vsid;
+            for (vsid = 0; vsid < GIET_NB_VSPACE_MAX; vsid++)
+            {
+                psched->vspace_mask[vsid][word] = 0;
+            }
+#endif
+        }
+        psched->ticking   = 0;
 
         // set default values for HWI / PTI / SWI vectors (valid bit = 0)
         unsigned int slot;
@@ -1074,15 +1186,22 @@ void boot_scheduler_init( unsigned int x,
         // - it uses the kernel TTY terminal
         // - slots containing addresses (SP,RA,EPC) are initialised by kernel_init()
 
-        psched->context[IDLE_TASK_INDEX][CTX_CR_ID]    = 0;
-        psched->context[IDLE_TASK_INDEX][CTX_SR_ID]    = 0xFF03;
-        psched->context[IDLE_TASK_INDEX][CTX_PTPR_ID]  = _ptabs_paddr[0][x][y]>>13;
-        psched->context[IDLE_TASK_INDEX][CTX_PTAB_ID]  = _ptabs_vaddr[0][x][y];
-        psched->context[IDLE_TASK_INDEX][CTX_TTY_ID]   = 0;
-        psched->context[IDLE_TASK_INDEX][CTX_LTID_ID]  = IDLE_TASK_INDEX;
-        psched->context[IDLE_TASK_INDEX][CTX_VSID_ID]  = 0;
-        psched->context[IDLE_TASK_INDEX][CTX_NORUN_ID] = 0;
-        psched->context[IDLE_TASK_INDEX][CTX_SIG_ID]   = 0;
+        psched->context[idle][CTX_CR_ID]    = 0;
+        psched->context[idle][CTX_SR_ID]    = 0xFF03;
+        psched->context[idle][CTX_PTPR_ID]  = _ptabs_paddr[0][x][y]>>13;
+        psched->context[idle][CTX_PTAB_ID]  = _ptabs_vaddr[0][x][y];
+        psched->context[idle][CTX_TTY_ID]   = 0;
+        psched->context[idle][CTX_LTID_ID]  = idle;
+        psched->context[idle][CTX_VSID_ID]  = 0;
+        psched->context[idle][CTX_NORUN_ID] = 0;
+        psched->context[idle][CTX_SIG_ID]   = 0;
+
+        psched->context[idle][CTX_RUN_ID]      = 0;
+        psched->context[idle][CTX_NSWITCH_ID]  = 0;
+        psched->context[idle][CTX_NPREEMPT_ID] = 0;
+        psched->context[idle][CTX_IOC_WAIT_ID] = 0;
+        psched->context[idle][CTX_COP_WAIT_ID] = 0;
+        psched->context[idle][CTX_DATE_ID]     = 0;
     }
 
     // HWI / PTI / WTI masks (up to 8 local processors)
@@ -1225,8 +1344,8 @@ _simple_barrier_wait( &_barrier_all_clusters );
         // and the stack address are defined in virtual space.
         _set_mmu_ptpr( (unsigned int)(_ptabs_paddr[vspace_id][x][y] >> 13) );
 
-        // ctx_norun depends on the vspace active field
-        unsigned int ctx_norun = (vspace[vspace_id].active == 0);
+        // vspace_norun depends on the vspace active field
+        unsigned int vspace_norun = (vspace[vspace_id].active == 0);
 
         // loop on the tasks in vspace (task_id is the global index in mapping)
         for (task_id = vspace[vspace_id].task_offset;
@@ -1258,6 +1377,32 @@ _simple_barrier_wait( &_barrier_all_clusters );
             // get vspace thread index
             unsigned int thread_id = task[task_id].trdid;
 
+            // ctx_norun and ctx_pthread depend on the task dynamic field :
+            // a slot reserved for giet_pthread_create() is not active.
+            unsigned int ctx_norun;
+            unsigned int ctx_pthread;
+            if ( task[task_id].dynamic )
+            {
+                ctx_norun   = NORUN_MASK_TASK;
+                ctx_pthread = PTHREAD_FREE;
+            }
+            else
+            {
+                ctx_norun   = vspace_norun;
+                ctx_pthread = PTHREAD_NONE;
+            }
+
+            // get task priority level
+            unsigned int ctx_prio = task[task_id].priority;
+
+            if ( ctx_prio >= PRIORITY_LEVELS )
+            {
+                _printf("\n[BOOT ERROR] in boot_scheduler_init() : task %s"
+                        " in vspace %s has illegal priority %d\n",
+                        task[task_id].name, vspace[vspace_id].name, ctx_prio );
+                _exit();
+            }
+
             // loop on the local processors
             for ( lpid = 0 ; lpid < nprocs ; lpid++ )
             {
@@ -1267,10 +1412,10 @@ _simple_barrier_wait( &_barrier_all_clusters );
                     psched = _schedulers[x][y][lpid];
 
                     // get local task index in scheduler
-                    unsigned int ltid = psched->tasks;
+                    unsigned int ltid = placed[lpid];
 
-                    // update the "tasks" field in scheduler:
-                    psched->tasks   = ltid + 1;
+                    // update the number of placed tasks
+                    placed[lpid] = ltid + 1;
 
                     // initializes the task context 
                     psched->context[ltid][CTX_CR_ID]     = 0;
@@ -1286,6 +1431,10 @@ _simple_barrier_wait( &_barrier_all_clusters );
                     psched->context[ltid][CTX_VSID_ID]   = vspace_id;
                     psched->context[ltid][CTX_NORUN_ID]  = ctx_norun;
                     psched->context[ltid][CTX_SIG_ID]    = 0;
+                    psched->context[ltid][CTX_PRIO_ID]   = ctx_prio;
+                    psched->context[ltid][CTX_WAIT_ID]   = 0;
+                    psched->context[ltid][CTX_PTHREAD_ID] = ctx_pthread;
+                    psched->context[ltid][CTX_RETVAL_ID] = 0;
 
                     psched->context[ltid][CTX_TTY_ID]    = 0xFFFFFFFF;
                     psched->context[ltid][CTX_CMA_FB_ID] = 0xFFFFFFFF;
@@ -1296,6 +1445,23 @@ _simple_barrier_wait( &_barrier_all_clusters );
                     psched->context[ltid][CTX_TIM_ID]    = 0xFFFFFFFF;
                     psched->context[ltid][CTX_HBA_ID]    = 0xFFFFFFFF;
 
+                    psched->context[ltid][CTX_RUN_ID]      = 0;
+                    psched->context[ltid][CTX_NSWITCH_ID]  = 0;
+                    psched->context[ltid][CTX_NPREEMPT_ID] = 0;
+                    psched->context[ltid][CTX_IOC_WAIT_ID] = 0;
+                    psched->context[ltid][CTX_COP_WAIT_ID] = 0;
+                    psched->context[ltid][CTX_DATE_ID]     = 0;
+
+                    // update the "runnable", "prio_mask" and "vspace_mask"
+                    // bit-vectors in scheduler
+                    unsigned int word = ltid >> 5;
+                    unsigned int bit  = 1 << (ltid & 0x1F);
+                    if ( ctx_norun == 0 ) psched->runnable[word] |= bit;
+                    psched->prio_mask[ctx_prio][word] |= bit;
+#if GIET_GANG_SCHEDULING
+                    psched->vspace_mask[vspace_id][word] |= bit;
+#endif
+
                     // update task ltid field in the mapping
                     task[task_id].ltid = ltid;
 
@@ -1310,7 +1476,8 @@ _printf("\nTask %s in vspace %s allocated to P[%d,%d,%d]\n"
         " - ctx[VSID]  = %d\n"
         " - ctx[TRDID] = %d\n"
         " - ctx[NORUN] = %x\n"
-        " - ctx[SIG]   = %x\n",
+        " - ctx[SIG]   = %x\n"
+        " - ctx[PRIO]  = %d\n",
         task[task_id].name,
         vspace[vspace_id].name,
         x, y, lpid,
@@ -1323,7 +1490,8 @@ _printf("\nTask %s in vspace %s allocated to P[%d,%d,%d]\n"
         psched->context[ltid][CTX_VSID_ID],
         psched->context[ltid][CTX_TRDID_ID],
         psched->context[ltid][CTX_NORUN_ID],
-        psched->context[ltid][CTX_SIG_ID] );
+        psched->context[ltid][CTX_SIG_ID],
+        psched->context[ltid][CTX_PRIO_ID] );
 #endif
                 } // end if FIT
             } // end for loop on local procs
@@ -1864,6 +2032,9 @@ void boot_init()
         // Initializes physical memory allocator in cluster[cx][cy]
         boot_pmem_init( cx , cy );
 
+        // Adjust the schedulers vseg length in cluster[cx][cy]
+        boot_sched_vseg_init( cx , cy );
+
         // Build page table in cluster[cx][cy]
         boot_ptab_init( cx , cy );
 
@@ -13,6 +13,20 @@
 #include "kernel_malloc.h"
 #include "io.h"
 
+#if GIET_LOCK_PROFILING
+
+///////////////////////////////////////////////////////////////////////////////////
+//      Global variables for locks profiling
+///////////////////////////////////////////////////////////////////////////////////
+
+__attribute__((section(".kdata")))
+unsigned int   _lock_stats_count = 0;
+
+__attribute__((section(".kdata")))
+lock_stats_t*  _lock_stats_table[GIET_LOCK_STATS_MAX];
+
+#endif
+
 ///////////////////////////////////////////////////
 unsigned int _atomic_increment( unsigned int* ptr,
                                 int           increment )
@@ -72,6 +86,115 @@ void _atomic_and( unsigned int* ptr,
 }
 
 
+///////////////////////////////////////////////////////////////////////////////////
+//      Lock statistics access functions
+///////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////
+// This function resets the statistics of a lock, and registers it in the
+// _lock_stats_table[] array, to be displayed by the giet_locks_stats() syscall.
+// It must be called after the lock initialisation, and does nothing when
+// GIET_LOCK_PROFILING is zero, or when the table is full.
+///////////////////////////////////////////////////////////////////////////////////
+void _lock_stats_register( lock_stats_t* stats,
+                           char*         name )
+{
+
+#if GIET_LOCK_PROFILING
+    stats->acquires  = 0;
+    stats->contended = 0;
+    stats->wait      = 0;
+    stats->max_hold  = 0;
+    stats->date      = 0;
+    stats->name      = name;
+
+    // claim a slot : the registration is dropped when the table is full
+    // (_lock_stats_count can be larger than GIET_LOCK_STATS_MAX)
+    unsigned int index = _atomic_increment( &_lock_stats_count, 1 );
+
+    if ( index < GIET_LOCK_STATS_MAX ) _lock_stats_table[index] = stats;
+#endif
+
+}
+
+#if GIET_LOCK_PROFILING
+
+///////////////////////////////////////////////////////////////////////////////////
+// This function is called by the lock owner just after the acquisition.
+// <start> is the date of the acquisition request.
+///////////////////////////////////////////////////////////////////////////////////
+static inline void _lock_stats_acquired( lock_stats_t* stats,
+                                         unsigned int  start,
+                                         unsigned int  contended )
+{
+    unsigned int date = _get_proctime();
+
+    stats->acquires++;
+    if ( contended ) stats->contended++;
+    stats->wait = stats->wait + (date - start);
+    stats->date = date;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// This function is called by the lock owner just before the release.
+///////////////////////////////////////////////////////////////////////////////////
+static inline void _lock_stats_released( lock_stats_t* stats )
+{
+    unsigned int hold = _get_proctime() - stats->date;
+
+    if ( hold > stats->max_hold ) stats->max_hold = hold;
+}
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////
+//      Ticket polling function
+///////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////
+// This function returns when the <current> ticket index is equal to <ticket>.
+// With GIET_LOCK_BACKOFF, the delay between two polls is proportional to the
+// number of tickets before <ticket>, and to the number of hops between the
+// calling processor cluster and the lock cluster (lx,ly).
+///////////////////////////////////////////////////////////////////////////////////
+static inline void _lock_ticket_wait( unsigned int* current,
+                                      unsigned int  ticket,
+                                      unsigned int  lx,
+                                      unsigned int  ly )
+{
+
+#if GIET_LOCK_BACKOFF
+
+    unsigned int value;
+    unsigned int hops = 0xFFFFFFFF;     // not yet computed
+    unsigned int delay;
+
+    while ( (value = ioread32( current )) != ticket )
+    {
+        if ( hops == 0xFFFFFFFF )
+        {
+            unsigned int gpid = _get_procid();
+            unsigned int x    = (gpid >> (Y_WIDTH + P_WIDTH)) & ((1<<X_WIDTH)-1);
+            unsigned int y    = (gpid >> P_WIDTH) & ((1<<Y_WIDTH)-1);
+
+            hops = ((x > lx) ? (x - lx) : (lx - x)) + ((y > ly) ? (y - ly) : (ly - y));
+        }
+
+        delay = (ticket - value - 1) * GIET_LOCK_BACKOFF_BASE * (hops + 1);
+        if ( delay > GIET_LOCK_BACKOFF_MAX ) delay = GIET_LOCK_BACKOFF_MAX;
+
+        while ( delay-- ) asm volatile ("nop");
+    }
+
+#else
+
+    while ( ioread32( current ) != ticket ) asm volatile ("nop");
+
+#endif
+
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////////
 //      Simple lock access functions
 ///////////////////////////////////////////////////////////////////////////////////
@@ -89,6 +212,11 @@ _nolock_printf("\n[DEBUG SIMPLE_LOCK] P[%d,%d,%d] enters acquire() at cycle %d\n
                x , y , l , _get_proctime() );
 #endif
 
+#if GIET_LOCK_PROFILING
+    unsigned int start     = _get_proctime();
+    unsigned int contended = ( ioread32( &lock->value ) != 0 );
+#endif
+
     asm volatile ( "1515:                   \n"
 	               "lw   $2,    0(%0)       \n"
 	               "bnez $2,    1515b       \n"
@@ -101,6 +229,10 @@ _nolock_printf("\n[DEBUG SIMPLE_LOCK] P[%d,%d,%d] enters acquire() at cycle %d\n
                    : "r"(lock)
                    : "$2", "$3", "memory" );
 
+#if GIET_LOCK_PROFILING
+    _lock_stats_acquired( &lock->stats, start, contended );
+#endif
+
 #if GIET_DEBUG_SIMPLE_LOCK
 _nolock_printf("\n[DEBUG SIMPLE_LOCK] P[%d,%d,%d] exit acquire() at cycle %d\n",
                x , y , l , _get_proctime() );
@@ -111,6 +243,11 @@ _nolock_printf("\n[DEBUG SIMPLE_LOCK] P[%d,%d,%d] exit acquire() at cycle %d\n",
 ////////////////////////////////////////////////
 void _simple_lock_release( simple_lock_t* lock )
 {
+
+#if GIET_LOCK_PROFILING
+    _lock_stats_released( &lock->stats );
+#endif
+
     asm volatile ( "sync" );   // for consistency
 
     lock->value = 0;
@@ -136,6 +273,29 @@ void _spin_lock_init( spin_lock_t* lock )
 {
     lock->current = 0;
     lock->free    = 0;
+    lock->x       = 0;
+    lock->y       = 0;
+
+#if GIET_LOCK_BACKOFF
+    // get the cluster containing the lock: a lock allocated in a 
+    // kernel heap is in the heap cluster, other locks are in cluster[0][0]
+    unsigned int cx;
+    unsigned int cy;
+    for ( cx = 0 ; cx < X_SIZE ; cx++ )
+    {
+        for ( cy = 0 ; cy < Y_SIZE ; cy++ )
+        {
+            unsigned int base = kernel_heap[cx][cy].heap_base;
+            unsigned int size = kernel_heap[cx][cy].heap_size;
+
+            if ( ((unsigned int)lock >= base) && ((unsigned int)lock < base + size) )
+            {
+                lock->x = cx;
+                lock->y = cy;
+            }
+        }
+    }
+#endif
 
 #if GIET_DEBUG_SPIN_LOCK
 unsigned int    gpid = _get_procid();
@@ -152,9 +312,18 @@ _nolock_printf("\n[DEBUG SPIN_LOCK] P[%d,%d,%d] initializes lock %x at cycle %d\
 ////////////////////////////////////////////
 void _spin_lock_acquire( spin_lock_t* lock )
 {
+
+#if GIET_LOCK_PROFILING
+    unsigned int start = _get_proctime();
+#endif
+
     // get next free slot index fromlock
     unsigned int ticket = _atomic_increment( &lock->free, 1 );
 
+#if GIET_LOCK_PROFILING
+    unsigned int contended = ( ioread32( &lock->current ) != ticket );
+#endif
+
 #if GIET_DEBUG_SPIN_LOCK
 unsigned int    gpid = _get_procid();
 unsigned int    x    = gpid >> (Y_WIDTH + P_WIDTH);
@@ -167,7 +336,11 @@ _nolock_printf("\n[DEBUG SPIN_LOCK] P[%d,%d,%d] get ticket %d for lock %x at cyc
 #endif
 
     // poll the spin_lock current slot index
-    while ( ioread32( &lock->current ) != ticket ) asm volatile ("nop");
+    _lock_ticket_wait( &lock->current, ticket, lock->x, lock->y );
+
+#if GIET_LOCK_PROFILING
+    _lock_stats_acquired( &lock->stats, start, contended );
+#endif
 
 #if GIET_DEBUG_SPIN_LOCK
 _nolock_printf("\n[DEBUG SPIN_LOCK] P[%d,%d,%d] get lock %x at cycle %d"
@@ -181,6 +354,11 @@ _nolock_printf("\n[DEBUG SPIN_LOCK] P[%d,%d,%d] get lock %x at cycle %d"
 ////////////////////////////////////////////
 void _spin_lock_release( spin_lock_t* lock )
 {
+
+#if GIET_LOCK_PROFILING
+    _lock_stats_released( &lock->stats );
+#endif
+
     asm volatile ( "sync" );   // for consistency
 
     lock->current = lock->current + 1;
@@ -234,6 +412,8 @@ unsigned int    pl   = gpid & ((1<<P_WIDTH)-1);
         node->free     = 0;
         node->level    = 0;
         node->parent   = parent;
+        node->x        = x;
+        node->y        = y;
         node->child[0] = NULL;
         node->child[1] = NULL;
         node->child[2] = NULL;
@@ -283,6 +463,8 @@ _nolock_printf("\n[DEBUG SQT_LOCK] P[%d,%d,%d] initialises SQT node[%d,%d,%d] :
         node->free     = 0;
         node->level    = level;
         node->parent   = parent;
+        node->x        = x;
+        node->y        = y;
 
 #if GIET_DEBUG_SQT_LOCK
 _nolock_printf("\n[DEBUG SQT_LOCK] P[%d,%d,%d] initialises SQT node[%d,%d,%d] : \n"
@@ -400,10 +582,13 @@ _nolock_printf("\n[DEBUG SQT_LOCK] SQT nodes initialisation completed\n");
 // from bottom to top, and starting from bottom.
 // It is blocking : it polls each "partial lock until it can be taken. 
 // The lock is finally obtained when all locks, at all levels are taken.
+// It returns a non zero value if at least one partial lock was already taken.
 //////////////////////////////////////////////////////////////////////////////////
 static 
-void _sqt_lock_take( sqt_lock_node_t* node )
+unsigned int _sqt_lock_take( sqt_lock_node_t* node )
 {
+    unsigned int contended = 0;
+
     // get next free ticket from local lock
     unsigned int ticket = _atomic_increment( &node->free, 1 );
 
@@ -418,8 +603,12 @@ _nolock_printf("\n[DEBUG SQT_LOCK] P[%d,%d,%d] get ticket %d for SQT lock %x"
                node->level , node->current , node->free );
 #endif
 
+#if GIET_LOCK_PROFILING
+    contended = ( ioread32( &node->current ) != ticket );
+#endif
+
     // poll the local lock current index
-    while ( ioread32( &node->current ) != ticket ) asm volatile( "nop" );
+    _lock_ticket_wait( &node->current, ticket, node->x, node->y );
 
 #if GIET_DEBUG_SQT_LOCK
 _nolock_printf("\n[DEBUG SQT_LOCK] P[%d,%d,%d] get SQT lock %x"
@@ -429,7 +618,9 @@ _nolock_printf("\n[DEBUG SQT_LOCK] P[%d,%d,%d] get SQT lock %x"
 #endif
 
     // try to take the parent node lock until top is reached
-    if ( node->parent != NULL ) _sqt_lock_take( node->parent );
+    if ( node->parent != NULL ) contended |= _sqt_lock_take( node->parent );
+
+    return contended;
 
 } // end _sqt_lock_take()
     
@@ -444,8 +635,14 @@ void _sqt_lock_acquire( sqt_lock_t*  lock )
     unsigned int x    = (gpid >> (Y_WIDTH + P_WIDTH)) & ((1<<X_WIDTH)-1);
     unsigned int y    = (gpid >> P_WIDTH) & ((1<<Y_WIDTH)-1);
 
+#if GIET_LOCK_PROFILING
+    unsigned int start     = _get_proctime();
+    unsigned int contended = _sqt_lock_take( lock->node[x][y][0] );
+    _lock_stats_acquired( &lock->stats, start, contended );
+#else
     // try to recursively take the distributed locks (from bottom to top)
     _sqt_lock_take( lock->node[x][y][0] );
+#endif
 }
 
 
@@ -482,6 +679,11 @@ _nolock_printf("\n[DEBUG SQT_LOCK] P[%d,%d,%d] release SQT lock %x"
 /////////////////////////////////////////////////////////////////////////////////
 void _sqt_lock_release( sqt_lock_t*  lock )
 {
+
+#if GIET_LOCK_PROFILING
+    _lock_stats_released( &lock->stats );
+#endif
+
     asm volatile ( "sync" );   // for consistency
 
     // get cluster coordinates
@@ -6,12 +6,29 @@
 //////////////////////////////////////////////////////////////////////////////
 // The locks.c and locks.h files are part of the GIET-VM nano-kernel.
 // They define both atomic increment operations and three types of locks.
+//
+// When the GIET_LOCK_PROFILING parameter is non zero, each lock records
+// contention statistics in a lock_stats_t structure (number of acquisitions,
+// number of contended acquisitions, cumulated waiting time, and max holding
+// time). These statistics are updated by the lock owner, and do not require
+// atomic operations. The locks registered with _lock_stats_register() can be
+// displayed with the giet_locks_stats() system call (shell "locks" command).
+// The instrumentation is compiled out when GIET_LOCK_PROFILING is zero.
+//
+// When the GIET_LOCK_BACKOFF parameter is non zero, a processor waiting on a
+// ticket lock (spin lock, or SQT lock node) does not poll continuously: it
+// waits between two polls a delay proportional to the number of tickets
+// before its own ticket, and to the mesh distance (number of hops) between
+// its cluster and the cluster containing the lock. The next owner polls
+// without delay. This reduces the polling traffic on the lock home memory
+// cache when the contention is high.
 //////////////////////////////////////////////////////////////////////////////
 
 #ifndef GIET_LOCKS_H
 #define GIET_LOCKS_H
 
 #include "hard_config.h"
+#include "giet_config.h"
 
 
 //////////////////////////////////////////////////////////////////////////////
@@ -27,6 +44,27 @@ extern void _atomic_or( unsigned int* ptr,
 extern void _atomic_and( unsigned int* ptr,
                          unsigned int  mask );
 
+//////////////////////////////////////////////////////////////////////////////
+//      Lock statistics structure and access functions
+//////////////////////////////////////////////////////////////////////////////
+
+typedef struct lock_stats_s
+{
+    unsigned int acquires;       // number of acquisitions
+    unsigned int contended;      // number of contended acquisitions
+    unsigned int wait;           // cumulated waiting time (cycles)
+    unsigned int max_hold;       // max holding time (cycles)
+    unsigned int date;           // date of the last acquisition (cycles)
+    char*        name;           // lock name (NULL if not registered)
+} lock_stats_t;
+
+extern void _lock_stats_register( lock_stats_t* stats,
+                                  char*         name );
+
+extern unsigned int   _lock_stats_count;
+
+extern lock_stats_t*  _lock_stats_table[GIET_LOCK_STATS_MAX];
+
 //////////////////////////////////////////////////////////////////////////////
 //      Simple lock structure and access functions
 //////////////////////////////////////////////////////////////////////////////
@@ -34,7 +72,8 @@ extern void _atomic_and( unsigned int* ptr,
 typedef struct simple_lock_s
 {
     unsigned int value;          // lock taken if non zero
-    unsigned int padding[15];    // for 64 bytes alignment
+    lock_stats_t stats;          // contention statistics (GIET_LOCK_PROFILING)
+    unsigned int padding[9];     // for 64 bytes alignment
 } simple_lock_t;
 
 extern void _simple_lock_acquire( simple_lock_t* lock );
@@ -49,7 +88,10 @@ typedef struct spin_lock_s
 {
     unsigned int current;        // current slot index:
     unsigned int free;           // next free tiket index
-    unsigned int padding[14];    // for 64 bytes alignment
+    lock_stats_t stats;          // contention statistics (GIET_LOCK_PROFILING)
+    unsigned int x;              // x coordinate of cluster containing the lock
+    unsigned int y;              // y coordinate of cluster containing the lock
+    unsigned int padding[6];     // for 64 bytes alignment
 } spin_lock_t;
 
 extern void _spin_lock_init( spin_lock_t* lock );
@@ -70,12 +112,15 @@ typedef struct sqt_lock_node_s
     unsigned int            level;           // hierarchical level (0 is bottom)
     struct sqt_lock_node_s* parent;          // parent node (NULL for root)
     struct sqt_lock_node_s* child[4];        // children node
-    unsigned int            padding[8];      // for 64 bytes alignment         
+    unsigned int            x;               // x coordinate of node cluster
+    unsigned int            y;               // y coordinate of node cluster
+    unsigned int            padding[6];      // for 64 bytes alignment         
 } sqt_lock_node_t;
 
 typedef struct sqt_lock_s 
 {
     sqt_lock_node_t* node[X_SIZE][Y_SIZE][5];  // array of pointers on SBT nodes 
+    lock_stats_t     stats;                    // contention statistics
 } sqt_lock_t;
 
 extern void _sqt_lock_init( sqt_lock_t*   lock );
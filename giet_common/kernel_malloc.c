@@ -18,8 +18,9 @@
 //   to MIN_BLOCK_SIZE (typically 64 bytes), and are aligned.
 // - All free blocks are pre-classed in 32 linked lists of free blocks, where 
 //   all blocks in a given list have the same size. 
-// - The NEXT pointer implementing those linked lists is written 
-//   in the 4 first bytes of the block itself, using the unsigned int type.
+// - Those lists are doubly linked: the NEXT pointer is written in the
+//   4 first bytes of the block itself, and the PREV pointer in the 4 next
+//   bytes (PREV is 0 for the first block of a list).
 // - The pointers on the first free block for each size are stored in an
 //   array of pointers free[32] in the heap[x][y) structure itself.
 // - The block size required can be any value, but the allocated block size
@@ -42,10 +43,16 @@
 //   of allocated block is : heap_size / MIN_BLOCK_SIZE
 // - For each allocated block, the value registered in the alloc[] array
 //   is log2( size_of_allocated_block ).
+// - For each free block, the value registered in the alloc[] array is
+//   log2( size_of_free_block ) | FREE_BLOCK_FLAG. The other entries are 0.
 // - The index in this array is computed from the allocated block base address:
 //      index = (block_base - heap_base) / MIN_BLOCK_SIZE
 // - The alloc[] array is stored at the end of heap segment. This consume
 //   (1 / MIN_BLOCK_SIZE) of the total heap storage capacity.
+// - The released block is merged with its companion block when the
+//   companion alloc[] entry shows a free block of the same size: the
+//   companion is unlinked from its free list in constant time, and the
+//   cost of _free() does not depend on the free lists length.
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "giet_config.h"
@@ -101,6 +108,11 @@ kernel_heap_t     kernel_heap[X_SIZE][Y_SIZE];
                                             (size <= 0x80000000) ? 31 :\
                                                                    32
 
+///////////////////////////////////////////////////////////////////////////////
+// Flag set in the alloc[] entry of a free block
+///////////////////////////////////////////////////////////////////////////////
+#define FREE_BLOCK_FLAG     0x80
+
 #if GIET_DEBUG_SYS_MALLOC
 
 ////////////////////////////////////////////////
@@ -179,6 +191,56 @@ unsigned int _get_heap_info( unsigned int* heap_base,
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+// This function returns a pointer on the alloc[] entry of a block.
+////////////////////////////////////////////////////////////////////////////////
+static inline unsigned char* _alloc_entry( kernel_heap_t* heap,
+                                           unsigned int   base )
+{
+    return (unsigned char*)(heap->alloc_base + 
+                            ((base - heap->heap_base) / MIN_BLOCK_SIZE));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// This function pushes a block in free[size_index], and registers it
+// as a free block in the alloc[] array.
+////////////////////////////////////////////////////////////////////////////////
+static void _push_free_block( kernel_heap_t* heap,
+                              unsigned int   base,
+                              unsigned int   size_index )
+{
+    unsigned int* block = (unsigned int*)base;
+    unsigned int  first = heap->free[size_index];
+
+    block[0] = first;                       // NEXT
+    block[1] = 0;                           // PREV
+    if ( first ) ((unsigned int*)first)[1] = base;
+    heap->free[size_index] = base;
+
+    *_alloc_entry( heap, base ) = FREE_BLOCK_FLAG | size_index;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// This function unlinks a block from free[size_index], and resets its
+// entry in the alloc[] array.
+////////////////////////////////////////////////////////////////////////////////
+static void _pop_free_block( kernel_heap_t* heap,
+                             unsigned int   base,
+                             unsigned int   size_index )
+{
+    unsigned int* block = (unsigned int*)base;
+    unsigned int  next  = block[0];
+    unsigned int  prev  = block[1];
+
+    if ( prev ) ((unsigned int*)prev)[0] = next;
+    else        heap->free[size_index]   = next;
+    if ( next ) ((unsigned int*)next)[1] = prev;
+
+    *_alloc_entry( heap, base ) = 0;
+}
+
+
+
 /////////////////
 void _heap_init()
 {
@@ -245,26 +307,24 @@ void _heap_init()
                 // reset the alloc_size array
                 memset( (unsigned char*)alloc_base , 0 , alloc_size );
  
+                kernel_heap[x][y].heap_base  = heap_base;
+                kernel_heap[x][y].heap_size  = heap_size;
+                kernel_heap[x][y].alloc_size = alloc_size;
+                kernel_heap[x][y].alloc_base = alloc_base;
+
                 // split the heap into various sizes blocks,
-                // initializes the free[] array and NEXT pointers
+                // initializes the free[] array and the alloc[] array
                 // base is the block base address
                 unsigned int   base = heap_base;
-                unsigned int*  ptr;
                 for ( index = heap_index-1 ; index >= alloc_index ; index-- )
                 {
-                    kernel_heap[x][y].free[index] = base;
-                    ptr = (unsigned int*)base;
-                    *ptr = 0;
+                    _push_free_block( &kernel_heap[x][y], base, index );
                     base = base + (1<<index);
                 }
 
-                kernel_heap[x][y].heap_base  = heap_base;
-                kernel_heap[x][y].heap_size  = heap_size;
-                kernel_heap[x][y].alloc_size = alloc_size;
-                kernel_heap[x][y].alloc_base = alloc_base;
-
                 // initialise lock
                 _spin_lock_init( &kernel_heap[x][y].lock );
+                _lock_stats_register( &kernel_heap[x][y].lock.stats, "kernel_heap" );
             }
 
 #if GIET_DEBUG_SYS_MALLOC
@@ -286,9 +346,7 @@ unsigned int _split_block( kernel_heap_t* heap,
                            unsigned int   requested_index )
 {
     // push the upper half block into free[searched_index-1]
-    unsigned int* new            = (unsigned int*)(vaddr + (1<<(searched_index-1)));
-    *new                         = heap->free[searched_index-1]; 
-    heap->free[searched_index-1] = (unsigned int)new;
+    _push_free_block( heap, vaddr + (1<<(searched_index-1)), searched_index-1 );
         
     if ( searched_index == requested_index + 1 )  //  return lower half block 
     {
@@ -322,8 +380,7 @@ unsigned int _get_block( kernel_heap_t* heap,
         else                // block found : pop it from free[searched_index] 
         {
             // pop the block from free[searched_index]
-            unsigned int next = *((unsigned int*)vaddr); 
-            heap->free[searched_index] = next;
+            _pop_free_block( heap, vaddr, searched_index );
             
             // test if the block must be split
             if ( searched_index == requested_index )  // no split required
@@ -438,9 +495,9 @@ void _update_free_array( kernel_heap_t*  heap,
     // with the companion block if this companion block is free.
     // This companion has the same size, and almost the same address
     // (only one address bit is different)
-    // - If the companion is not in free[size_index],
+    // - If the companion alloc[] entry is not a free block of the same size,
     //   the released block is pushed in free[size_index].
-    // - If the companion is found, it is evicted from free[size_index]
+    // - If the companion is free, it is unlinked from free[size_index]
     //   and the merged bloc is pushed in the free[size_index+1].
 
     // compute released block size
@@ -470,41 +527,26 @@ _nolock_printf("\n[DEBUG KERNEL_MALLOC] _update_free_array() :\n"
                size , base , companion_base , merged_base , (base & size) );
 #endif
 
-    // scan all blocks in free[size_index]
-    // the iter & prev variables are actually addresses
-    unsigned int  found = 0;
-    unsigned int  iter  = heap->free[size_index];
-    unsigned int  prev  = (unsigned int)(&heap->free[size_index]);
-    while ( iter ) 
+    // check the companion state in the alloc[] array 
+    if ( (companion_base >= heap->heap_base) &&
+         (companion_base < (heap->heap_base + heap->heap_size)) &&
+         (*_alloc_entry( heap, companion_base ) == (FREE_BLOCK_FLAG | size_index)) )
     {
-        if ( iter == companion_base ) 
-        {
-            found = 1;
-            break;
-        }
-        prev = iter;
-        iter = *(unsigned int*)iter;
-    }
+        // unlink the companion block from free[size_index]
+        _pop_free_block( heap, companion_base, size_index );
 
-    if ( found == 0 )  // Companion not found => register in free[size_index]
+        // call the update_free() function for free[size_index+1]
+        _update_free_array( heap, merged_base , size_index+1 );
+    }
+    else               // Companion not free => register in free[size_index]
     {
 
 #if GIET_DEBUG_SYS_MALLOC > 1
 _nolock_printf("\n[DEBUG KERNEL_MALLOC] _update_free_array() : companion "
-               " not found => register block %x in free[%d]", base , size );
+               " not free => register block %x in free[%d]", base , size );
 #endif
 
-        // push the block in free[size_index]  
-        *(unsigned int*)base   = heap->free[size_index];
-        heap->free[size_index] = base;
-    }
-    else               // Companion found : merge and try in free[size_index + 1]
-    {
-        // pop the companion block (address == iter) from free[size_index]
-        *(unsigned int*)prev = *(unsigned int*)iter;
-
-        // call the update_free() function for free[size_index+1]
-        _update_free_array( heap, merged_base , size_index+1 );
+        _push_free_block( heap, base, size_index );
     }
 }  // end _update_free_array()
 
@@ -538,7 +580,7 @@ void _free( void* ptr )
     unsigned int   size_index = (unsigned int)*pchar;
 
     // check block allocation
-    if ( size_index == 0 )
+    if ( (size_index == 0) || (size_index & FREE_BLOCK_FLAG) )
     {
         _printf("\n[GIET ERROR] in _free() : released block %X not allocated "
                 "in kernel_heap[%d][%d]\n", (unsigned int)ptr , x , y );
@@ -0,0 +1,158 @@
+////////////////////////////////////////////////////////////////////////////////
+// File     : kernel_slab.c
+// Date     : 01/10/2015
+// Author   : alain greiner
+// Copyright (c) UPMC-LIP6
+////////////////////////////////////////////////////////////////////////////////
+
+#include "giet_config.h"
+#include "hard_config.h"
+#include "kernel_slab.h"
+#include "kernel_malloc.h"
+#include "kernel_locks.h"
+#include "sys_handler.h"
+#include "tty0.h"
+#include "utils.h"
+
+///////////////////////////////////////////
+void _slab_init( kernel_slab_t* slab,
+                 unsigned int   size,
+                 char*          name )
+{
+    unsigned int x;
+    unsigned int y;
+
+    // round the object size to a multiple of 4 bytes
+    size = (size + 3) & 0xFFFFFFFC;
+
+    if ( (size == 0) || (size > SLAB_PAGE_SIZE) )
+    {
+        _printf("\n[GIET ERROR] in _slab_init() : illegal size for slab <%s>\n", name );
+        _exit();
+    }
+
+    slab->size = size;
+    slab->name = name;
+
+    for ( x = 0 ; x < X_SIZE ; x++ )
+    {
+        for ( y = 0 ; y < Y_SIZE ; y++ )
+        {
+            slab_cluster_t* sc = &slab->cluster[x][y];
+
+            sc->free    = 0;
+            sc->next    = 0;
+            sc->end     = 0;
+            sc->objects = 0;
+            sc->pages   = 0;
+            _spin_lock_init( &sc->lock );
+        }
+    }
+
+#if GIET_DEBUG_SYS_MALLOC
+_printf("\n[DEBUG KERNEL_SLAB] _slab_init() : slab <%s> / size = %d / %d objects per page\n",
+        name , size , SLAB_PAGE_SIZE / size );
+#endif
+
+}  // end _slab_init()
+
+/////////////////////////////////////////////////
+void* _slab_remote_alloc( kernel_slab_t* slab,
+                          unsigned int   x,
+                          unsigned int   y )
+{
+    unsigned int    base;
+
+    if ( (x >= X_SIZE) || (y >= Y_SIZE) )
+    {
+        _printf("\n[GIET ERROR] in _slab_remote_alloc() : illegal coordinates\n");
+        _exit();
+    }
+
+    slab_cluster_t* sc = &slab->cluster[x][y];
+
+    _spin_lock_acquire( &sc->lock );
+
+    if ( sc->free )                                  // pop the free list
+    {
+        base     = sc->free;
+        sc->free = *(unsigned int*)base;
+    }
+    else                                             // carve the current page
+    {
+        if ( (sc->next + slab->size) > sc->end )     // allocate a new page
+        {
+            sc->next  = (unsigned int)_remote_malloc( SLAB_PAGE_SIZE, x, y );
+            sc->end   = sc->next + SLAB_PAGE_SIZE;
+            sc->pages = sc->pages + 1;
+        }
+        base     = sc->next;
+        sc->next = sc->next + slab->size;
+    }
+
+    sc->objects = sc->objects + 1;
+
+    _spin_lock_release( &sc->lock );
+
+#if GIET_DEBUG_SYS_MALLOC
+_printf("\n[DEBUG KERNEL_SLAB] _slab_alloc() : slab <%s> / vaddr = %x from cluster[%d][%d]"
+        " / objects = %d / pages = %d\n",
+        slab->name , base , x , y , sc->objects , sc->pages );
+#endif
+
+    return (void*)base;
+
+}  // end _slab_remote_alloc()
+
+///////////////////////////////////////////
+void* _slab_alloc( kernel_slab_t* slab )
+{
+    unsigned int procid  = _get_procid();
+    unsigned int x       = procid >> (Y_WIDTH + P_WIDTH);
+    unsigned int y       = (procid >> P_WIDTH) & ((1<<Y_WIDTH)-1);
+
+    return _slab_remote_alloc( slab , x , y );
+
+}  // end _slab_alloc()
+
+///////////////////////////////////////
+void _slab_free( kernel_slab_t* slab,
+                 void*          ptr )
+{
+    // get cluster coordinates from ptr value
+    unsigned int x;
+    unsigned int y;
+    _sys_xy_from_ptr( ptr, &x, &y );
+
+    slab_cluster_t* sc = &slab->cluster[x][y];
+
+    if ( (ptr == NULL) || (sc->pages == 0) )
+    {
+        _printf("\n[GIET ERROR] in _slab_free() : illegal pointer %x for slab <%s>\n",
+                (unsigned int)ptr , slab->name );
+        _exit();
+    }
+
+    _spin_lock_acquire( &sc->lock );
+
+    *(unsigned int*)ptr = sc->free;
+    sc->free            = (unsigned int)ptr;
+    sc->objects         = sc->objects - 1;
+
+    _spin_lock_release( &sc->lock );
+
+#if GIET_DEBUG_SYS_MALLOC
+_printf("\n[DEBUG KERNEL_SLAB] _slab_free() : slab <%s> / vaddr = %x to cluster[%d][%d]"
+        " / objects = %d\n", slab->name , (unsigned int)ptr , x , y , sc->objects );
+#endif
+
+}  // end _slab_free()
+
+// Local Variables:
+// tab-width: 4
+// c-basic-offset: 4
+// c-file-offsets:((innamespace . 0)(inline-open . 0))
+// indent-tabs-mode: nil
+// End:
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=4:softtabstop=4
+
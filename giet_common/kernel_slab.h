@@ -0,0 +1,83 @@
+//////////////////////////////////////////////////////////////////////////////////
+// File     : kernel_slab.h
+// Date     : 01/10/2015
+// Author   : alain greiner
+// Copyright (c) UPMC-LIP6
+//////////////////////////////////////////////////////////////////////////////////
+// The kernel_slab.c and kernel_slab.h files are part of the giet_vm kernel.
+// They implement a slab allocator for small fixed-size kernel objects,
+// on top of the kernel heap allocator (kernel_malloc.c), that rounds each
+// request to a power of 2 larger or equal to 64 bytes.
+//
+// A slab (kernel_slab_t) is defined for one object type, and contains one
+// sub-allocator per cluster (slab_cluster_t), protected by a spin-lock:
+// - The objects are carved from SLAB_PAGE_SIZE pages, allocated in the
+//   kernel heap of the cluster. The object size is only rounded to a
+//   multiple of 4 bytes.
+// - The released objects are registered in a linked list of free objects,
+//   where the NEXT pointer is written in the 4 first bytes of the object.
+// - _slab_alloc() pops the free list, or takes the next never allocated
+//   object in the current page, or allocates a new page.
+// - _slab_free() pushes the object in the free list of its cluster.
+// Both functions are constant time. The pages are never returned to the
+// kernel heap: the released objects are only reused by the same slab.
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef KERNEL_SLAB_H_
+#define KERNEL_SLAB_H_
+
+#include "kernel_locks.h"
+#include "hard_config.h"
+
+#define SLAB_PAGE_SIZE      0x1000
+
+//////////////////////////////////////////////////////////////////////////////////
+//             slab descriptors
+//////////////////////////////////////////////////////////////////////////////////
+
+typedef struct slab_cluster_s
+{
+    spin_lock_t    lock;            // lock protecting exclusive access
+    unsigned int   free;            // first free object base address
+    unsigned int   next;            // first never allocated object in page
+    unsigned int   end;             // current page end address
+    unsigned int   objects;         // number of allocated objects
+    unsigned int   pages;           // number of pages allocated from heap
+    unsigned int   padding[11];     // for 64 bytes alignment
+} slab_cluster_t;
+
+typedef struct kernel_slab_s
+{
+    unsigned int   size;            // object size (bytes)
+    char*          name;            // object type name
+    unsigned int   padding[14];     // for 64 bytes alignment
+    slab_cluster_t cluster[X_SIZE][Y_SIZE];  // one sub-allocator per cluster
+} kernel_slab_t;
+
+//////////////////////////////////////////////////////////////////////////////////
+//  access functions
+//////////////////////////////////////////////////////////////////////////////////
+
+extern void _slab_init( kernel_slab_t* slab,
+                        unsigned int   size,
+                        char*          name );
+
+extern void* _slab_alloc( kernel_slab_t* slab );
+
+extern void* _slab_remote_alloc( kernel_slab_t* slab,
+                                 unsigned int   x,
+                                 unsigned int   y );
+
+extern void _slab_free( kernel_slab_t* slab,
+                        void*          ptr );
+
+#endif
+
+// Local Variables:
+// tab-width: 4
+// c-basic-offset: 4
+// c-file-offsets:((innamespace . 0)(inline-open . 0))
+// indent-tabs-mode: nil
+// End:
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=4:softtabstop=4
+
@@ -37,21 +37,25 @@
 #define GIET_DEBUG_FBF_CMA        0            /* FBF_CMA access */
 #define GIET_DEBUG_COPROC         0            /* coprocessor access */
 #define GIET_DEBUG_EXEC           0            /* kill/exec mechanism */
+#define GIET_DEBUG_SYS_SYNC       0            /* futex wait/wake */
 
 #define GIET_DEBUG_USER_MALLOC    0            /* malloc library */
 #define GIET_DEBUG_USER_BARRIER   0            /* barrier library */
 #define GIET_DEBUG_USER_MWMR      0            /* mwmr library */
+#define GIET_DEBUG_USER_SPSC      0            /* spsc library */
 #define GIET_DEBUG_USER_LOCK      0            /* user locks access */
+#define GIET_DEBUG_USER_WS        0            /* work stealing library */
 
 #define CONFIG_SRL_VERBOSITY TRACE 
 
 /* software parameters */
 
 #define GIET_ELF_BUFFER_SIZE     0x80000       /* buffer for .elf files  */
-#define GIET_IDLE_TASK_PERIOD    0x10000000    /* Idle Task message period */
 #define GIET_OPEN_FILES_MAX      16            /* max simultaneously open files */
 #define GIET_NB_VSPACE_MAX       16            /* max number of virtual spaces */
+#define GIET_NB_TASKS_PROC_MAX   128           /* max number of tasks per processor */
 #define GIET_TICK_VALUE	         0x00010000    /* context switch period (cycles) */
+#define GIET_GANG_SCHEDULING     0             /* co-schedule the tasks of a vspace */
 #define GIET_USE_IOMMU           0             /* IOMMU activated when non zero */
 #define GIET_NO_HARD_CC          0             /* No hard cache coherence */
 #define GIET_NIC_MAC4            0x12345678    /* 32 LSB bits of the MAC address */
@@ -60,6 +64,15 @@
 #define GIET_ISR_CHANNEL_MAX     8             /* max number of ISR channels */
 #define GIET_SDC_PERIOD          2             /* number of system cycles in SDC period */
 #define GIET_SR_INIT_VALUE       0x2000FF13    /* SR initial value (before eret) */
+#define GIET_USER_SPIN_MAX       1000          /* polling iterations before futex wait */
+#define GIET_USER_FUTEX          1             /* blocking waits use futex (yield if 0) */
+#define GIET_USER_MCS_LOCK       0             /* MCS locks for mwmr, work-stealing, apps */
+#define GIET_USER_MALLOC_CACHE   1             /* per-thread free blocks caches in malloc */
+#define GIET_LOCK_PROFILING      0             /* locks contention statistics if non zero */
+#define GIET_LOCK_BACKOFF        0             /* proportional backoff in ticket locks */
+#define GIET_LOCK_BACKOFF_BASE   16            /* backoff iterations per ticket and per hop */
+#define GIET_LOCK_BACKOFF_MAX    4096          /* max backoff iterations */
+#define GIET_LOCK_STATS_MAX      512           /* max number of profiled locks */
 
 #endif
 
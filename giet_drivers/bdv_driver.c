@@ -170,7 +170,7 @@ _printf("\n[BDV DEBUG] _bdv_access() : P[%d,%d,%d] wait on BDV_STATUS ...\n",
 
         // Set NORUN_MASK_IOC bit 
         static_scheduler_t* psched  = (static_scheduler_t*)_schedulers[x][y][p];
-        _atomic_or( &psched->context[ltid][CTX_NORUN_ID] , NORUN_MASK_IOC );
+        _ctx_set_norun( psched , ltid , NORUN_MASK_IOC );
         
         // launch transfer
         if (to_mem == 0) _bdv_set_register( BLOCK_DEVICE_OP, BLOCK_DEVICE_WRITE );
@@ -183,8 +183,10 @@ _printf("\n[BDV DEBUG] _bdv_access() : P[%d,%d,%d] launch transfer"
         x , y , p , _get_proctime() );
 #endif
 
-        // deschedule task
+        // deschedule task, and account the blocked time
+        unsigned int date = _get_proctime();
         _ctx_switch();                      
+        psched->context[ltid][CTX_IOC_WAIT_ID] += _get_proctime() - date;
 
 #if GIET_DEBUG_IOC
 if ( _get_proctime() > GIET_DEBUG_IOC )
@@ -250,13 +252,12 @@ void _bdv_isr( unsigned int irq_type,   // HWI / WTI
 
     // Reset NORUN_MASK_IOC bit 
     static_scheduler_t* psched  = (static_scheduler_t*)_schedulers[x][y][p];
-    unsigned int*       ptr     = &psched->context[ltid][CTX_NORUN_ID];
-    _atomic_and( ptr , ~NORUN_MASK_IOC );
+    _ctx_reset_norun( psched , ltid , NORUN_MASK_IOC );
 
     // send a WAKUP WTI to processor running the sleeping task 
     _xcu_send_wti( cluster,   
                    p, 
-                   0 );          // don't force context switch 
+                   0 );          // switch if idle or lower priority task
 
 #if GIET_DEBUG_IOC  
 unsigned int pid  = _get_procid();
@@ -309,8 +309,7 @@ _printf("\n[DEBUG HBA] _hba_access() : P[%d,%d,%d] get slot %d in Cmd List "
 
         // Set NORUN_MASK_IOC bit 
         static_scheduler_t* psched  = (static_scheduler_t*)_schedulers[x][y][p];
-        unsigned int*       ptr     = &psched->context[ltid][CTX_NORUN_ID];
-        _atomic_or( ptr , NORUN_MASK_IOC );
+        _ctx_set_norun( psched , ltid , NORUN_MASK_IOC );
       
         // start HBA transfer
         _hba_set_register( HBA_PXCI, (1<<cmd_id) );
@@ -318,8 +317,10 @@ _printf("\n[DEBUG HBA] _hba_access() : P[%d,%d,%d] get slot %d in Cmd List "
         // set _hba_active_cmd[cmd_id]
         _hba_active_cmd[cmd_id] = 1;
 
-        // deschedule task
+        // deschedule task, and account the blocked time
+        unsigned int date = _get_proctime();
         _ctx_switch();                      
+        psched->context[ltid][CTX_IOC_WAIT_ID] += _get_proctime() - date;
 
 #if GIET_DEBUG_IOC
 if (_get_proctime() > GIET_DEBUG_IOC)
@@ -378,7 +379,10 @@ unsigned int _hba_init()
 
     // initialise allocator lock if not in boot mode
     if ( !_hba_boot_mode )
+    {
         _sqt_lock_init(&_hba_allocator_lock);
+        _lock_stats_register(&_hba_allocator_lock.stats, "hba_allocator_lock");
+    }
 
     // initialise Command Descriptors in Command List, allocated command table
     // and active command table
@@ -447,12 +451,12 @@ void _hba_isr( unsigned int irq_type,   // HWI / WTI
  
             // Reset NORUN_MASK_IOC bit 
             static_scheduler_t* psched  = (static_scheduler_t*)_schedulers[x][y][p];
-            _atomic_and( &psched->context[ltid][CTX_NORUN_ID] , ~NORUN_MASK_IOC );
+            _ctx_reset_norun( psched , ltid , NORUN_MASK_IOC );
 
             // send a WAKUP WTI to processor running the waiting task 
             _xcu_send_wti( cluster , 
                            p , 
-                           0 );          // don't force context switch
+                           0 );          // switch if idle or lower priority task
 
 #if GIET_DEBUG_IOC  
 if (_get_proctime() > GIET_DEBUG_IOC)
@@ -216,13 +216,12 @@ void _mwr_isr( unsigned int irq_type,  // unused : should be HWI
 
     // Reset NORUN_MASK_IOC bit 
     static_scheduler_t* psched  = (static_scheduler_t*)_schedulers[r_x][r_y][r_p];
-    unsigned int*       ptr     = &psched->context[r_ltid][CTX_NORUN_ID];
-    _atomic_and( ptr , ~NORUN_MASK_COPROC );
+    _ctx_reset_norun( psched , r_ltid , NORUN_MASK_COPROC );
 
     // send a WAKUP WTI to processor running the sleeping task 
     _xcu_send_wti( r_cluster,   
                    r_p, 
-                   0 );          // don't force context switch 
+                   0 );          // switch if idle or lower priority task
 
 #if GIET_DEBUG_COPROC  
 unsigned int p          = gpid & ((1<<P_WIDTH)-1);
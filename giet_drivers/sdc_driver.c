@@ -434,14 +434,15 @@ _printf("\n[DEBUG SDC] _sdc_access() : command %d for P[%d,%d,%d] "
 
         // Set NORUN_MASK_IOC bit 
         static_scheduler_t* psched  = (static_scheduler_t*)_schedulers[x][y][p];
-        unsigned int*       ptr     = &psched->context[ltid][CTX_NORUN_ID];
-        _atomic_or( ptr , NORUN_MASK_IOC );
+        _ctx_set_norun( psched , ltid , NORUN_MASK_IOC );
         
         // start transfer
         _sdc_set_register( AHCI_PXCI, (1<<ptw) );
 
-        // deschedule task
+        // deschedule task, and account the blocked time
+        unsigned int date = _get_proctime();
         _ctx_switch();                      
+        psched->context[ltid][CTX_IOC_WAIT_ID] += _get_proctime() - date;
 
 #if GIET_DEBUG_IOC
 if (_get_proctime() > GIET_DEBUG_IOC)
@@ -506,12 +507,12 @@ void _sdc_isr( unsigned int irq_type,
  
             // Reset NORUN_MASK_IOC bit 
             static_scheduler_t* psched  = (static_scheduler_t*)_schedulers[x][y][p];
-            _atomic_and( &psched->context[ltid][CTX_NORUN_ID] , ~NORUN_MASK_IOC );
+            _ctx_reset_norun( psched , ltid , NORUN_MASK_IOC );
 
             // send a WAKUP WTI to processor running the waiting task 
             _xcu_send_wti( cluster , 
                            p , 
-                           0 );          // don't force context switch
+                           0 );          // switch if idle or lower priority task
 
 #if GIET_DEBUG_IOC  
 if (_get_proctime() > GIET_DEBUG_IOC)
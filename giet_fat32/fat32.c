@@ -22,6 +22,19 @@
 //    for each referenced file or directory, and a specific "Fat_Cache" for 
 //    the FAT itself. Each cache contain a variable number of clusters that are
 //    dynamically allocated when they are accessed, and organised as a 64-Tree.
+// 6. The FAT descriptor contains three locks, and each inode contains one lock:
+//    - the "fat_lock" protects the Inode-Tree, the file descriptors array,
+//      and the directories (including their File-Cache).
+//    - the inode "lock" protects the File-Cache, the size and the clusters
+//      chain of a file, and the seek of the file descriptors referencing it.
+//      It is only held during the File-Cache accesses by _fat_read(), so that
+//      reads of the same file hitting in the File-Cache run in parallel.
+//    - the "free_lock" protects the free clusters state (first_free_cluster,
+//      free_clusters_number and the FS_INFO sector).
+//    - the "fat_cache_lock" protects the Fat-Cache (FAT region).
+//    The locks must be taken in this order: fat_lock, inode lock, free_lock,
+//    fat_cache_lock. A File-Cache is never released while the file is open
+//    by another file descriptor.
 //////////////////////////////////////////////////////////////////////////////////
 // General Debug Policy:
 // The global variable GIET_DEBUG_FAT is defined in the giet_config.h file.
@@ -37,6 +50,7 @@
 #include <utils.h>
 #include <vmem.h>
 #include <kernel_malloc.h>
+#include <kernel_slab.h>
 #include <bdv_driver.h>
 #include <hba_driver.h>
 #include <sdc_driver.h>
@@ -68,6 +82,16 @@ unsigned int   _fat_buffer_fat_lba;
 __attribute__((section(".kdata")))
 unsigned int   _fat_buffer_data_lba;
 
+// slabs for the Inode-Tree and the File-Caches / Fat-Cache objects (kernel mode)
+__attribute__((section(".kdata")))
+kernel_slab_t  _fat_inode_slab __attribute__((aligned(64)));
+
+__attribute__((section(".kdata")))
+kernel_slab_t  _fat_cache_node_slab __attribute__((aligned(64)));
+
+__attribute__((section(".kdata")))
+kernel_slab_t  _fat_cache_desc_slab __attribute__((aligned(64)));
+
 //////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////
 //                  Static functions declaration
@@ -234,6 +258,15 @@ static unsigned int _update_device_from_cache( unsigned int      levels,
                                                fat_cache_node_t* root,
                                                char*             string );
 
+//////////////////////////////////////////////////////////////////////////////////
+// This function writes all dirty clusters of the Fat-Cache to block device,
+// taking the fat_cache_lock.
+// It returns 0 on success.
+// It returns 1 on error.
+//////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int _update_fat_from_cache();
+
 //////////////////////////////////////////////////////////////////////////////////
 // The following function accesses directly the FS_INFO block on the block device, 
 // to update the "first_free_cluster" and "free_clusters_number" values,
@@ -885,7 +918,7 @@ static fat_cache_node_t* _allocate_one_cache_node( fat_cache_node_t* first_child
     fat_cache_node_t* cnode;
     unsigned int i;
 
-    cnode = _malloc( sizeof(fat_cache_node_t) );
+    cnode = _slab_alloc( &_fat_cache_node_slab );
 
     cnode->children[0] = first_child;
     for ( i = 1 ; i < 64 ; i++ )
@@ -905,7 +938,9 @@ static fat_inode_t* _allocate_one_inode( char*        name,
                                          unsigned int dentry,
                                          unsigned int cache_allocate )
 {
-    fat_inode_t* new_inode  = _malloc( sizeof(fat_inode_t) );
+    fat_inode_t* new_inode  = _slab_alloc( &_fat_inode_slab );
+
+    _spin_lock_init( &new_inode->lock );
 
     new_inode->parent   = NULL;                 // set by _add_inode_in_tree()
     new_inode->next     = NULL;                 // set by _add_inode_in_tree()
@@ -1076,7 +1111,7 @@ _printf("\n[DEBUG FAT] _get_buffer_from_cache(): miss in File-Cache <%s> "
                 }
 
                 // allocate buffer descriptor
-                pdesc          = _malloc( sizeof(fat_cache_desc_t) );
+                pdesc          = _slab_alloc( &_fat_cache_desc_slab );
                 pdesc->lba     = lba;
                 pdesc->buffer  = buf;
                 pdesc->dirty   = 0;
@@ -1120,6 +1155,8 @@ _printf("\n[DEBUG FAT] _get_buffer_from_cache(): buffer loaded from device"
 /////////////////////////////////////
 static unsigned int _update_fs_info()
 {
+    _spin_lock_acquire( &_fat.free_lock );
+
     // update buffer if miss
     if ( _fat.fs_info_lba != _fat.block_buffer_lba )
     {
@@ -1129,6 +1166,7 @@ static unsigned int _update_fs_info()
                               (unsigned int)_fat.block_buffer, 
                               1 ) )              // one block
         {
+            _spin_lock_release( &_fat.free_lock );
             _printf("\n[FAT_ERROR] _update_fs_info(): cannot read block\n");
             return 1;
         }
@@ -1150,10 +1188,13 @@ static unsigned int _update_fs_info()
                           (unsigned int)_fat.block_buffer, 
                           1 ) )             // one block
     {
+        _spin_lock_release( &_fat.free_lock );
         _printf("\n[FAT_ERROR] _update_fs_info(): cannot write block\n");
         return 1;
     }
 
+    _spin_lock_release( &_fat.free_lock );
+
 #if (GIET_DEBUG_FAT & 1)
 if ( _get_proctime() > GIET_DEBUG_FAT )
 _printf("\n[DEBUG FAT] _update_fs_info(): nb_free = %x / first_free = %x\n",
@@ -1177,14 +1218,23 @@ static inline unsigned int _get_fat_entry( unsigned int  cluster,
     // get pointer on the relevant cluster descriptor in FAT cache
     fat_cache_desc_t*  pdesc;
     unsigned int*      buffer;
+
+    _spin_lock_acquire( &_fat.fat_cache_lock );
+
     if ( _get_buffer_from_cache( NULL,               // Fat-Cache
                                  cluster_id,
-                                 &pdesc ) ) return 1;
+                                 &pdesc ) )
+    {
+        _spin_lock_release( &_fat.fat_cache_lock );
+        return 1;
+    }
 
     // get value from FAT slot
     buffer = (unsigned int*)pdesc->buffer;
     *value = buffer[entry_id];
 
+    _spin_lock_release( &_fat.fat_cache_lock );
+
     return 0;
 }  // end _get_fat_entry()
 
@@ -1202,15 +1252,24 @@ static inline unsigned int _set_fat_entry( unsigned int cluster,
     // get pointer on the relevant cluster descriptor in FAT cache
     fat_cache_desc_t*  pdesc;
     unsigned int*      buffer; 
+
+    _spin_lock_acquire( &_fat.fat_cache_lock );
+
     if ( _get_buffer_from_cache( NULL,               // Fat-Cache
                                  cluster_id,
-                                 &pdesc ) )  return 1;           
+                                 &pdesc ) )
+    {
+        _spin_lock_release( &_fat.fat_cache_lock );
+        return 1;
+    }
 
     // set value into FAT slot
     buffer           = (unsigned int*)pdesc->buffer;
     buffer[entry_id] = value;
     pdesc->dirty     = 1;
 
+    _spin_lock_release( &_fat.fat_cache_lock );
+
     return 0;
 } // end _set_fat_entry()
 
@@ -1259,7 +1318,7 @@ _printf("\n[DEBUG FAT] _allocate_one_buffer(): buffer allocated to <%s> for clus
 #endif
 
             // allocate buffer descriptor
-            pdesc = _malloc( sizeof(fat_cache_desc_t) );
+            pdesc = _slab_alloc( &_fat_cache_desc_slab );
             pdesc->lba     = _cluster_to_lba( cluster );
             pdesc->buffer  = _malloc( 4096 );
             pdesc->dirty   = 1;
@@ -1287,6 +1346,8 @@ _printf("\n[DEBUG FAT] _allocate_one_buffer(): buffer allocated to <%s> for clus
 ///////////////////////////////////////////////////////////////////
 static unsigned int _allocate_one_cluster( unsigned int*  cluster )  
 {
+    _spin_lock_acquire( &_fat.free_lock );
+
     unsigned int nb_free = _fat.free_clusters_number;
     unsigned int free    = _fat.first_free_cluster;
 
@@ -1301,7 +1362,11 @@ static unsigned int _allocate_one_cluster( unsigned int*  cluster )
         current++;
 
         // get FAT entry indexed by current
-        if ( _get_fat_entry( current , &value ) ) return 1;
+        if ( _get_fat_entry( current , &value ) ) 
+        {
+            _spin_lock_release( &_fat.free_lock );
+            return 1;
+        }
         // test if free
         if ( value == FREE_CLUSTER ) found = 1;
     }
@@ -1310,17 +1375,24 @@ static unsigned int _allocate_one_cluster( unsigned int*  cluster )
     // check found  
     if ( found == 0 )
     {
+        _spin_lock_release( &_fat.free_lock );
         _printf("\n[FAT_ERROR] _allocate_one_cluster(): unconsistent FAT state");
         return 1;
     }
 
     // update allocated FAT slot
-    if ( _set_fat_entry( free , END_OF_CHAIN_CLUSTER_MAX ) ) return 1;
+    if ( _set_fat_entry( free , END_OF_CHAIN_CLUSTER_MAX ) ) 
+    {
+        _spin_lock_release( &_fat.free_lock );
+        return 1;
+    }
 
     // update FAT descriptor global variables
     _fat.free_clusters_number = nb_free - 1;
     _fat.first_free_cluster   = current;
 
+    _spin_lock_release( &_fat.free_lock );
+
 #if (GIET_DEBUG_FAT & 1)
 if ( _get_proctime() > GIET_DEBUG_FAT )
 _printf("\n[DEBUG FAT] _allocate_one_cluster(): cluster = %x / first_free = %x\n",
@@ -1397,6 +1469,24 @@ _printf("\n[DEBUG FAT] _update_device_from_cache(): cluster_id = %d for <%s>\n",
 
 
 
+/////////////////////////////////////////////
+static unsigned int _update_fat_from_cache()
+{
+    unsigned int ret;
+
+    _spin_lock_acquire( &_fat.fat_cache_lock );
+
+    ret = _update_device_from_cache( _fat.fat_cache_levels,
+                                     _fat.fat_cache_root,
+                                     "FAT" );
+
+    _spin_lock_release( &_fat.fat_cache_lock );
+
+    return ret;
+}  // end _update_fat_from_cache()
+
+
+
 ///////////////////////////////////////////////////////////////////
 static void _release_cache_memory( fat_cache_node_t*  root,
                                    unsigned int       levels )
@@ -1416,7 +1506,7 @@ static void _release_cache_memory( fat_cache_node_t*  root,
                     _printf("\n[FAT ERROR] _release_cache_memory(): dirty cluster\n");
 
                 _free( pdesc->buffer );
-                _free( pdesc );
+                _slab_free( &_fat_cache_desc_slab, pdesc );
                 root->children[i] = NULL;
             }
         }
@@ -1430,7 +1520,7 @@ static void _release_cache_memory( fat_cache_node_t*  root,
             if ( cnode != NULL )
             {
                 _release_cache_memory( cnode, levels - 1 );
-                _free( cnode );
+                _slab_free( &_fat_cache_node_slab, cnode );
                 root->children[i] = NULL;
             }
         }
@@ -1519,9 +1609,7 @@ _printf("\n[DEBUG FAT] _clusters_allocate(): done for cluster_id = %d / cluster
     if ( _set_fat_entry( last , END_OF_CHAIN_CLUSTER_MAX ) )  return 1;
 
     // update the FAT on block device
-    if ( _update_device_from_cache( _fat.fat_cache_levels,
-                                    _fat.fat_cache_root,
-                                    "FAT" ) )              return 1;
+    if ( _update_fat_from_cache() )              return 1;
     return 0;
 }  // end _clusters_allocate()
 
@@ -1533,13 +1621,24 @@ static unsigned int _clusters_release( unsigned int cluster )
     // scan the FAT
     unsigned int current = cluster;
     unsigned int next;
+
+    _spin_lock_acquire( &_fat.free_lock );
+
     do
     { 
         // get next_cluster index
-        if ( _get_fat_entry( current , &next ) )  return 1;
+        if ( _get_fat_entry( current , &next ) )
+        {
+            _spin_lock_release( &_fat.free_lock );
+            return 1;
+        }
 
         // release current_cluster
-        if ( _set_fat_entry( current , FREE_CLUSTER ) )   return 1;
+        if ( _set_fat_entry( current , FREE_CLUSTER ) )
+        {
+            _spin_lock_release( &_fat.free_lock );
+            return 1;
+        }
 
         // update first_free_cluster and free_clusters_number in FAT descriptor
         _fat.free_clusters_number = _fat.free_clusters_number + 1;
@@ -1550,10 +1649,10 @@ static unsigned int _clusters_release( unsigned int cluster )
     }
     while ( next < END_OF_CHAIN_CLUSTER_MIN );
 
+    _spin_lock_release( &_fat.free_lock );
+
     // update the FAT on block device
-    if ( _update_device_from_cache( _fat.fat_cache_levels,
-                                    _fat.fat_cache_root,
-                                    "FAT" ) )                return 1;
+    if ( _update_fat_from_cache() )                return 1;
     return 0;
 }  // end _clusters_release()
 
@@ -2749,6 +2848,11 @@ if ( _get_proctime() > GIET_DEBUG_FAT )
     {
         unsigned int i;
 
+        // initialize slabs
+        _slab_init( &_fat_inode_slab, sizeof(fat_inode_t), "fat_inode" );
+        _slab_init( &_fat_cache_node_slab, sizeof(fat_cache_node_t), "fat_cache_node" );
+        _slab_init( &_fat_cache_desc_slab, sizeof(fat_cache_desc_t), "fat_cache_desc" );
+
         // create Inode-Tree root
         _fat.inode_tree_root = _allocate_one_inode("/", // dir name
                                                    1,   // directory
@@ -2760,6 +2864,11 @@ if ( _get_proctime() > GIET_DEBUG_FAT )
 
         // initialize lock
         _spin_lock_init( &_fat.fat_lock );
+        _spin_lock_init( &_fat.fat_cache_lock );
+        _spin_lock_init( &_fat.free_lock );
+        _lock_stats_register( &_fat.fat_lock.stats, "fat_lock" );
+        _lock_stats_register( &_fat.fat_cache_lock.stats, "fat_cache_lock" );
+        _lock_stats_register( &_fat.free_lock.stats, "fat_free_lock" );
 
         // initialize File Descriptor Array
         for( i = 0 ; i < GIET_OPEN_FILES_MAX ; i++ ) _fat.fd[i].allocated = 0;
@@ -2797,6 +2906,7 @@ _display_fat_descriptor();
 //   GIET_FAT32_FILE_NOT_FOUND,
 //   GIET_FAT32_NAME_TOO_LONG,
 //   GIET_FAT32_IO_ERROR,
+//   GIET_FAT32_IS_OPEN,
 //   GIET_FAT32_TOO_MANY_OPEN_FILES
 ///////////////////////////////////////////////////////////////////////////////
 int _fat_open( char*        pathname,     // absolute path from root
@@ -2906,9 +3016,7 @@ _printf("\n[DEBUG FAT] _fat_open(): P[%d,%d,%d] create a new file <%s>\n",
         }
 
         // update FAT region on block device
-        if ( _update_device_from_cache( _fat.fat_cache_levels,
-                                        _fat.fat_cache_root,
-                                        "FAT" ) )
+        if ( _update_fat_from_cache() )
         {
             _spin_lock_release( &_fat.fat_lock );
             _printf("\n[FAT ERROR] _fat_open(): cannot update FAT region"
@@ -2938,6 +3046,16 @@ if ( _get_proctime() > GIET_DEBUG_FAT )
 _printf("\n[DEBUG FAT] _fat_open(): P[%d,%d,%d] found file <%s> on device : inode = %x\n",
         x , y , p , pathname , child );
 #endif
+
+        // a file open by another file descriptor cannot be truncated,
+        // as its File-Cache can be accessed without the fat_lock
+        if ( truncate && !read_only && !child->is_dir && (child->count != 0) )
+        {
+            _spin_lock_release( &_fat.fat_lock );
+            _printf("\n[FAT ERROR] _fat_open(): cannot truncate file <%s>"
+                    " open by another file descriptor\n", pathname );
+            return GIET_FAT32_IS_OPEN;
+        }
     }
 
     // Search an empty slot in file descriptors array
@@ -3198,23 +3316,36 @@ int _fat_read( unsigned int fd_id,     // file descriptor index
         return GIET_FAT32_NOT_OPEN;
     }
 
+    // get file inode pointer and lock:
+    // a directory is protected by the global lock
+    fat_inode_t* inode  = _fat.fd[fd_id].inode;
+    unsigned int is_dir = inode->is_dir;
+    spin_lock_t* lock   = (is_dir) ? &_fat.fat_lock : &inode->lock;
+
     // takes lock
-    _spin_lock_acquire( &_fat.fat_lock );
+    _spin_lock_acquire( lock );
            
-    // get file inode pointer and offset
-    fat_inode_t* inode  = _fat.fd[fd_id].inode;
+    // get offset
     unsigned int seek   = _fat.fd[fd_id].seek;
 
     // check count & seek versus file size
-    if ( count + seek > inode->size && !inode->is_dir )
+    if ( count + seek > inode->size && !is_dir )
     {
-        _spin_lock_release( &_fat.fat_lock );
+        _spin_lock_release( lock );
         _printf("\n[FAT ERROR] _fat_read(): file too small"
                 " / seek = %x / count = %x / file_size = %x\n",
                 seek , count , inode->size );
         return 0;
     }
 
+    // claim the [seek , seek + count[ range, so that concurrent
+    // read() or write() on the same file descriptor use the next one
+    _fat.fd[fd_id].seek = seek + count;
+
+    // a file lock is only held during the File-Cache accesses,
+    // and the data are moved without lock.
+    if ( is_dir == 0 ) _spin_lock_release( lock );
+
     // compute first_cluster_id and first_byte_to_move 
     unsigned int first_cluster_id   = seek >> 12;
     unsigned int first_byte_to_move = seek & 0xFFF;   
@@ -3245,11 +3376,21 @@ _printf("\n[DEBUG FAT] _fat_read(): P[%d,%d,%d] enters for file <%s> "
         // get pointer on the cluster_id buffer in cache 
         unsigned char*     cbuf;
         fat_cache_desc_t*  pdesc;
-        if ( _get_buffer_from_cache( inode, 
-                                     cluster_id,
-                                     &pdesc ) )
+        unsigned int       error;
+
+        if ( is_dir == 0 ) _spin_lock_acquire( lock );
+
+        error = _get_buffer_from_cache( inode, 
+                                        cluster_id,
+                                        &pdesc );
+
+        if ( (is_dir == 0) && (error == 0) ) _spin_lock_release( lock );
+
+        if ( error )
         {
-            _spin_lock_release( &_fat.fat_lock );
+            // give back the claimed range if it is still the last one
+            if ( _fat.fd[fd_id].seek == seek + count ) _fat.fd[fd_id].seek = seek;
+            _spin_lock_release( lock );
             _printf("\n[FAT ERROR] _fat_read(): cannot load file <%s>\n",
                     inode->name );
             return GIET_FAT32_IO_ERROR;
@@ -3298,11 +3439,8 @@ _printf("\n[DEBUG FAT] _fat_read(): P[%d,%d,%d] loaded file <%s> from Cache-File
         x , y , p , inode->name );
 #endif
 
-    // update seek
-    _fat.fd[fd_id].seek += done;
-
-    // release lock
-    _spin_lock_release( &_fat.fat_lock );
+    // release directory lock
+    if ( is_dir ) _spin_lock_release( lock );
 
     return done;
 } // end _fat_read()
@@ -3338,13 +3476,9 @@ int _fat_write( unsigned int fd_id,    // file descriptor index
         return GIET_FAT32_NOT_INITIALIZED;
     }
 
-    // takes lock
-    _spin_lock_acquire( &_fat.fat_lock );
-           
     // check fd_id overflow
     if ( fd_id >= GIET_OPEN_FILES_MAX )
     {
-        _spin_lock_release( &_fat.fat_lock );
         _printf("\n[FAT ERROR] _fat_write(): illegal file descriptor\n");
         return GIET_FAT32_INVALID_FD;
     }
@@ -3352,7 +3486,6 @@ int _fat_write( unsigned int fd_id,    // file descriptor index
     // check file open
     if ( _fat.fd[fd_id].allocated == 0 )
     {
-        _spin_lock_release( &_fat.fat_lock );
         _printf("\n[FAT ERROR] _fat_write(): file not open\n" );
         return GIET_FAT32_NOT_OPEN;
     }
@@ -3360,14 +3493,20 @@ int _fat_write( unsigned int fd_id,    // file descriptor index
     // check file writable
     if ( _fat.fd[fd_id].read_only )
     {
-        _spin_lock_release( &_fat.fat_lock );
         _printf("\n[FAT ERROR] _fat_write(): file <%s> is read-only\n",
                 _fat.fd[fd_id].inode->name );
         return GIET_FAT32_READ_ONLY;
     }
 
-    // get file inode pointer and seek 
+    // get file inode pointer and lock:
+    // a directory is protected by the global lock
     fat_inode_t* inode  = _fat.fd[fd_id].inode;
+    spin_lock_t* lock   = (inode->is_dir) ? &_fat.fat_lock : &inode->lock;
+
+    // takes lock
+    _spin_lock_acquire( lock );
+
+    // get seek 
     unsigned int seek   = _fat.fd[fd_id].seek;
 
 #if GIET_DEBUG_FAT
@@ -3412,23 +3551,13 @@ _printf("\n[DEBUG FAT] _fat_write(): P[%d,%d,%d] allocates new clusters for file
                                      old_clusters,
                                      new_clusters - old_clusters ) )
             {
-                _spin_lock_release( &_fat.fat_lock );
+                _spin_lock_release( lock );
                 _printf("\n[FAT ERROR] _fat_write(): no free clusters"
                         " for file <%s>\n", _fat.fd[fd_id].inode->name );
                 return GIET_FAT32_NO_FREE_SPACE;
             }
         }
          
-        // update parent directory entry (size and cluster index)
-        if ( _update_dir_entry( inode ) )
-        {
-            _spin_lock_release( &_fat.fat_lock );
-            _printf("\n[FAT ERROR] _fat_write(): cannot update parent directory entry"
-                    " for file <%s>\n", _fat.fd[fd_id].inode->name );
-            return GIET_FAT32_IO_ERROR;
-        }
-            
-
 #if GIET_DEBUG_FAT
 if ( _get_proctime() > GIET_DEBUG_FAT )
 _printf("\n[DEBUG FAT] _fat_write(): P[%d,%d,%d] updates size for file <%s> / size = %x\n",
@@ -3466,7 +3595,7 @@ _printf("\n[DEBUG FAT] _fat_write(): P[%d,%d,%d] starts loop on clusters for fil
                                      cluster_id,  
                                      &pdesc ) )   
         {
-            _spin_lock_release( &_fat.fat_lock );
+            _spin_lock_release( lock );
             _printf("\n[FAT ERROR] _fat_write(): cannot load file <%s>\n",
                     inode->name );
             return GIET_FAT32_IO_ERROR;
@@ -3522,7 +3651,24 @@ _printf("\n[DEBUG FAT] _fat_write(): P[%d,%d,%d] store file <%s> into Cache-File
 #endif
 
     // release lock
-    _spin_lock_release( &_fat.fat_lock );
+    _spin_lock_release( lock );
+
+    // update parent directory entry (size and cluster index),
+    // that is protected by the global lock
+    if ( new_size > old_size )
+    {
+        _spin_lock_acquire( &_fat.fat_lock );
+
+        if ( _update_dir_entry( inode ) )
+        {
+            _spin_lock_release( &_fat.fat_lock );
+            _printf("\n[FAT ERROR] _fat_write(): cannot update parent directory entry"
+                    " for file <%s>\n", inode->name );
+            return GIET_FAT32_IO_ERROR;
+        }
+
+        _spin_lock_release( &_fat.fat_lock );
+    }
 
     return done;
 } // end _fat_write()
@@ -3572,6 +3718,18 @@ int _fat_lseek( unsigned int fd_id,
         return GIET_FAT32_NOT_OPEN;
     }
 
+    // the seek of a file is protected by the file lock, that is
+    // taken before the fat_lock is released (fat_lock / inode lock order)
+    fat_inode_t*  inode = _fat.fd[fd_id].inode;
+    spin_lock_t*  lock  = &_fat.fat_lock;
+
+    if ( inode->is_dir == 0 )
+    {
+        lock = &inode->lock;
+        _spin_lock_acquire( lock );
+        _spin_lock_release( &_fat.fat_lock );
+    }
+
     unsigned int  new_seek;
 
     // compute new seek
@@ -3579,7 +3737,7 @@ int _fat_lseek( unsigned int fd_id,
     else if ( whence == SEEK_SET ) new_seek = seek;
     else
     {
-        _spin_lock_release( &_fat.fat_lock );
+        _spin_lock_release( lock );
         _printf("\n[FAT ERROR] _fat_lseek(): illegal whence value\n");
         return GIET_FAT32_INVALID_ARG;
     }
@@ -3598,7 +3756,7 @@ _printf("\n[DEBUG FAT] _fat_lseek(): P[%d,%d,%d] set seek = %x for file <%s>\n",
 #endif
 
     // release lock
-    _spin_lock_release( &_fat.fat_lock );
+    _spin_lock_release( lock );
 
     return new_seek;
 }  // end _fat_lseek()
@@ -3961,7 +4119,7 @@ _printf("\n[FAT DEBUG] _fat_rename(): P[%d,%d,%d] checked remove condition OK\n"
     _remove_inode_from_tree( old );
 
     // release "old" inode
-    _free( old );
+    _slab_free( &_fat_inode_slab, old );
 
     // updates "old_parent" directory on device
     if ( _update_device_from_cache( old_parent->levels,
@@ -4128,9 +4286,7 @@ _printf("\n[DEBUG FAT] _fat_mkdir(): P[%d,%d,%d] create new directory <%s>\n",
         }
 
         // update FAT region on block device
-        if ( _update_device_from_cache( _fat.fat_cache_levels,
-                                        _fat.fat_cache_root,
-                                        "FAT" ) )
+        if ( _update_fat_from_cache() )
         {
             _spin_lock_release( &_fat.fat_lock );
             _printf("\n[FAT ERROR] _fat_mkdir(): cannot update FAT region"
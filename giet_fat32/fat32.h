@@ -154,11 +154,15 @@ typedef struct fat_cache_desc_s
 
 
 /********************************************************************************
-  This struct defines a file/directory inode / size = 64 bytes
+  This struct defines a file/directory inode / size = 128 bytes
+  The lock protects the File-Cache, the size and the clusters chain of a file,
+  and the seek of the file descriptors referencing the file. It is not used
+  for a directory, that is protected by the global fat_lock.
 ********************************************************************************/
 
 typedef struct fat_inode_s
 {
+    spin_lock_t          lock;                   // file lock (file only)
     struct fat_inode_s*  parent;                 // parent directory inode
     struct fat_inode_s*  next;                   // next inode in same directory
     struct fat_inode_s*  child;                  // first children inode (dir only)
@@ -193,7 +197,9 @@ typedef struct fat_desc_s
 {
     unsigned char       block_buffer[512];       // one block buffer (for FS_INFO)
     fat_file_desc_t     fd[GIET_OPEN_FILES_MAX]; // file descriptors array
-    spin_lock_t         fat_lock;                // global lock protecting FAT
+    spin_lock_t         fat_lock;                // lock protecting Inode-Tree & dirs
+    spin_lock_t         fat_cache_lock;          // lock protecting Fat-Cache
+    spin_lock_t         free_lock;               // lock protecting free clusters
     fat_inode_t*        inode_tree_root;         // Inode-Tree root pointer
     fat_cache_node_t*   fat_cache_root;          // Fat_Cache root pointer
     unsigned int        fat_cache_levels;        // number of levels in Fat-Cache
@@ -23,6 +23,123 @@ extern void _task_switch(unsigned int *, unsigned int *);
 // allocated in boot.c or kernel_init.c files
 extern static_scheduler_t* _schedulers[X_SIZE][Y_SIZE][NB_PROCS_MAX];
 
+// allocated in sys_handler.c file (protects the CTX_PTHREAD_ID slots)
+extern spin_lock_t _futex_lock[GIET_NB_VSPACE_MAX];
+
+/////////////////////////////////////////////////////////////////////////////////
+//     Global variables
+/////////////////////////////////////////////////////////////////////////////////
+
+#if GIET_GANG_SCHEDULING
+// vspace index of the current gang
+volatile unsigned int _gang_vsid = 0;
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////
+// This function returns the index of the least significant non zero bit
+// in a non zero bit-vector, using the MIPS32 "clz" instruction.
+/////////////////////////////////////////////////////////////////////////////////
+static inline unsigned int _ctx_ffs( unsigned int bits )
+{
+    unsigned int zeros;
+    asm volatile( "clz    %0,   %1" 
+                  : "=r"(zeros)
+                  : "r"(bits & (-bits)) );
+    return (31 - zeros);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+// This function updates the "runnable" bit-vector from the NORUN slot of the
+// task identified by psched and ltid. As several processors can modify the
+// NORUN slot concurrently, the NORUN slot is checked again after the bit-vector
+// update, and the update is done again if the NORUN slot has been modified.
+/////////////////////////////////////////////////////////////////////////////////
+static void _ctx_update_runnable( static_scheduler_t* psched,
+                                  unsigned int        ltid )
+{
+    volatile unsigned int* pnorun = &psched->context[ltid][CTX_NORUN_ID];
+    unsigned int           norun;
+
+    unsigned int*          pword  = &psched->runnable[ltid>>5];
+    unsigned int           bit    = 1 << (ltid & 0x1F);
+
+    do
+    {
+        norun = *pnorun;
+        if ( norun == 0 ) _atomic_or ( pword ,  bit );
+        else              _atomic_and( pword , ~bit );
+    }
+    while ( norun != *pnorun );
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+// This function returns the index of the next task to be executed in the
+// priority level defined by the "level" argument: it is the first runable
+// task of this level following the "curr" task, or the first runable task
+// of this level if there is no such task. It returns 0xFFFFFFFF if there is
+// no runable task in this level.
+// If the "filter" argument is not NULL, only the tasks having their bit set
+// in the "filter" bit-vector are considered.
+/////////////////////////////////////////////////////////////////////////////////
+static unsigned int _ctx_next_in_level( static_scheduler_t* psched,
+                                        unsigned int        level,
+                                        unsigned int        curr,
+                                        unsigned int*       filter )
+{
+    unsigned int words = (psched->tasks + 31) >> 5;
+    unsigned int first = 0xFFFFFFFF;
+    unsigned int word;
+    unsigned int ready;
+
+    for ( word = 0 ; word < words ; word++ )
+    {
+        ready = psched->runnable[word] & psched->prio_mask[level][word];
+
+        if ( filter != NULL ) ready = ready & filter[word];
+
+        if ( ready == 0 ) continue;
+
+        // register first runable task in level
+        if ( first == 0xFFFFFFFF ) first = (word<<5) + _ctx_ffs( ready );
+
+        // skip this word if all tasks are not larger than curr 
+        if ( ((word<<5) + 31) <= curr ) continue;
+
+        // keep only tasks larger than curr if curr is in this word
+        if ( (word<<5) <= curr ) ready = ready & (0xFFFFFFFE << (curr & 0x1F));
+
+        if ( ready ) return (word<<5) + _ctx_ffs( ready );
+    }
+    return first;
+}
+
+/////////////////////////////////////
+void _ctx_set_norun( static_scheduler_t* psched,
+                     unsigned int        ltid,
+                     unsigned int        mask )
+{
+    _atomic_or( &psched->context[ltid][CTX_NORUN_ID] , mask );
+    _ctx_update_runnable( psched , ltid );
+}
+
+///////////////////////////////////////
+void _ctx_reset_norun( static_scheduler_t* psched,
+                       unsigned int        ltid,
+                       unsigned int        mask )
+{
+    _atomic_and( &psched->context[ltid][CTX_NORUN_ID] , ~mask );
+    _ctx_update_runnable( psched , ltid );
+}
+
+///////////////////////////////////
+void _ctx_set_sig( static_scheduler_t* psched,
+                   unsigned int        ltid,
+                   unsigned int        mask )
+{
+    _atomic_or( &psched->context[ltid][CTX_SIG_ID] , mask );
+    _atomic_or( &psched->sigpend[ltid>>5] , 1 << (ltid & 0x1F) );
+}
+
 //////////////////
 static void _ctx_kill_task( unsigned int ltid )
 {
@@ -71,8 +188,11 @@ static void _ctx_kill_task( unsigned int ltid )
     // restore scheduled task
     psched->current = cur_task;
 
+    // forget the awaited futex if any
+    psched->context[ltid][CTX_WAIT_ID] = 0;
+
     // set NORUN_MASK_TASK bit
-    _atomic_or( &psched->context[ltid][CTX_NORUN_ID], NORUN_MASK_TASK );
+    _ctx_set_norun( psched , ltid , NORUN_MASK_TASK );
 }
 
 
@@ -92,12 +212,32 @@ static void _ctx_exec_task( unsigned int ltid )
     unsigned int vseg_id       = task[task_id].stack_vseg_id;
     unsigned int sp_value      = vseg[vseg_id].vbase + vseg[vseg_id].length;
 
-    // reset task context: RA / SR / SP / EPC / NORUN
+    // reset task context: RA / SR / SP / EPC / WAIT / NORUN
     psched->context[ltid][CTX_RA_ID]    = (unsigned int)&_ctx_eret;
     psched->context[ltid][CTX_SR_ID]    = GIET_SR_INIT_VALUE;
     psched->context[ltid][CTX_SP_ID]    = sp_value;
     psched->context[ltid][CTX_EPC_ID]   = psched->context[ltid][CTX_ENTRY_ID];
-    psched->context[ltid][CTX_NORUN_ID] = 0;
+    psched->context[ltid][CTX_WAIT_ID]  = 0;
+
+    // a pthread slot becomes available, but is not activated
+    if ( psched->context[ltid][CTX_PTHREAD_ID] != PTHREAD_NONE )
+    {
+        unsigned int vsid = psched->context[ltid][CTX_VSID_ID];
+        unsigned int save_sr;
+
+        _it_disable( &save_sr );
+        _spin_lock_acquire( &_futex_lock[vsid] );
+
+        psched->context[ltid][CTX_PTHREAD_ID] = PTHREAD_FREE;
+        _ctx_reset_norun( psched , ltid , ~NORUN_MASK_TASK );
+
+        _spin_lock_release( &_futex_lock[vsid] );
+        _it_restore( &save_sr );
+    }
+    else
+    {
+        _ctx_reset_norun( psched , ltid , 0xFFFFFFFF );
+    }
 }
 
 
@@ -134,8 +274,8 @@ void _ctx_display( unsigned int x,
 }  // _ctx_display()
 
 
-//////////////////
-void _ctx_switch() 
+///////////////////////
+void _ctx_update_tick()
 {
     unsigned int gpid       = _get_procid();
     unsigned int cluster_xy = gpid >> P_WIDTH;
@@ -144,50 +284,216 @@ void _ctx_switch()
     // get scheduler address
     static_scheduler_t* psched = (static_scheduler_t*)_get_sched();
 
-    // get number of tasks allocated to scheduler
-    unsigned int tasks = psched->tasks;
+    // test if there is more than one runable task
+    unsigned int words    = (psched->tasks + 31) >> 5;
+    unsigned int count    = 0;
+    unsigned int word;
+    unsigned int runnable;
 
-    // get current task index
-    unsigned int curr_task_id = psched->current;
+    for ( word = 0 ; word < words ; word++ )
+    {
+        runnable = psched->runnable[word];
+        if      ( runnable & (runnable - 1) ) count += 2;
+        else if ( runnable )                  count += 1;
+    }
 
-    // select the next task using a round-robin policy
-    unsigned int next_task_id;
-    unsigned int tid;
-    unsigned int found = 0;
+    unsigned int required = (count > 1);
 
-    for (tid = curr_task_id + 1; tid < curr_task_id + 1 + tasks; tid++) 
+#if GIET_GANG_SCHEDULING
+    // only P[0,0,0] uses its TICK timer, that is always running
+    required = (gpid == 0);
+#endif
+
+    if ( required && (psched->ticking == 0) )
+    {
+        _xcu_timer_start( cluster_xy, lpid, GIET_TICK_VALUE );
+        psched->ticking = 1;
+    }
+    else if ( (required == 0) && psched->ticking )
     {
-        next_task_id = tid % tasks;
+        _xcu_timer_stop( cluster_xy, lpid );
+        psched->ticking = 0;
+    }
+}  // end _ctx_update_tick()
 
-        // this task needs to be killed
-        if ( psched->context[next_task_id][CTX_SIG_ID] & SIG_MASK_KILL )
-        {
-            _ctx_kill_task( next_task_id );
+///////////////////////////////////
+unsigned int _ctx_preempt_required()
+{
+    // get scheduler address
+    static_scheduler_t* psched = (static_scheduler_t*)_get_sched();
+
+    unsigned int curr  = psched->current;
+    unsigned int words = (psched->tasks + 31) >> 5;
+    unsigned int level;
+    unsigned int word;
+
+    // the idle task is always preempted
+    if ( curr == psched->tasks ) return 1;
 
-            // acknowledge signal
-            _atomic_and( &psched->context[next_task_id][CTX_SIG_ID], ~SIG_MASK_KILL );
+    // search a runable task in a higher priority level
+    for ( level = psched->context[curr][CTX_PRIO_ID] + 1 ; 
+          level < PRIORITY_LEVELS ; 
+          level++ )
+    {
+        for ( word = 0 ; word < words ; word++ )
+        {
+            if ( psched->runnable[word] & psched->prio_mask[level][word] ) return 1;
         }
+    }
+    return 0;
+}  // end _ctx_preempt_required()
+
+#if GIET_GANG_SCHEDULING
+
+/////////////////////
+void _ctx_gang_tick()
+{
+    mapping_header_t* header = (mapping_header_t *)SEG_BOOT_MAPPING_BASE;
 
-        // this task needs to be executed
-        if ( psched->context[next_task_id][CTX_SIG_ID] & SIG_MASK_EXEC )
+    unsigned int x;
+    unsigned int y;
+
+    // select next gang vspace
+    _gang_vsid = (_gang_vsid + 1) % header->vspaces;
+
+    // make the new gang visible before the WTIs
+    asm volatile ("sync" ::: "memory");
+
+    // one WTI per cluster : P0 of each cluster relays it
+    for ( x = 0 ; x < X_SIZE ; x++ )
+    {
+        for ( y = 0 ; y < Y_SIZE ; y++ )
         {
-            _ctx_exec_task( next_task_id );
+            if ( (x == 0) && (y == 0) )          continue;
+            if ( _schedulers[x][y][0] == NULL )  continue;
 
-            // acknowledge signal
-            _atomic_and( &psched->context[next_task_id][CTX_SIG_ID], ~SIG_MASK_EXEC );
+            _xcu_send_wti( (x<<Y_WIDTH) + y , 0 , WAKUP_GANG_RELAY );
         }
+    }
+
+    // P[0,0,0] is the relay for cluster[0,0]
+    _ctx_gang_relay();
+
+#if GIET_DEBUG_SWITCH
+_printf("\n[DEBUG SWITCH] P[0,0,0] selects gang vspace %d at cycle %d\n",
+        _gang_vsid , _get_proctime() );
+#endif
+}  // end _ctx_gang_tick()
+
+//////////////////////
+void _ctx_gang_relay()
+{
+    unsigned int gpid       = _get_procid();
+    unsigned int cluster_xy = gpid >> P_WIDTH;
+    unsigned int x          = cluster_xy >> Y_WIDTH;
+    unsigned int y          = cluster_xy & ((1<<Y_WIDTH)-1);
+    unsigned int p;
+
+    // force a context switch on the other processors of the cluster
+    for ( p = 1 ; p < NB_PROCS_MAX ; p++ )
+    {
+        if ( _schedulers[x][y][p] == NULL ) continue;
+
+        _xcu_send_wti( cluster_xy , p , WAKUP_SWITCH );
+    }
+}  // end _ctx_gang_relay()
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////
+// This buffer receives the registers of a pthread calling _ctx_exit_switch():
+// they are never restored, and its slot can be reused as soon as the exited
+// state has been published. It is written by all processors and never read.
+/////////////////////////////////////////////////////////////////////////////////
+static unsigned int _ctx_exit_trash[64];
+
+/////////////////////////////////////////////////////////////////////////////////
+// This function implements both _ctx_switch() and _ctx_exit_switch().
+// When <exited> is non zero, the current task context is not saved in its
+// slot, and the switch is done even if the selected task is in the same slot.
+/////////////////////////////////////////////////////////////////////////////////
+static void _ctx_switch_generic( unsigned int exited ) 
+{
+    unsigned int gpid       = _get_procid();
+    unsigned int cluster_xy = gpid >> P_WIDTH;
+    unsigned int lpid       = gpid & ((1<<P_WIDTH)-1);
+
+    // get scheduler address
+    static_scheduler_t* psched = (static_scheduler_t*)_get_sched();
+
+    // get current task index
+    unsigned int curr_task_id = psched->current;
+
+    // get number of tasks allocated to scheduler
+    unsigned int tasks = psched->tasks;
+    unsigned int words = (tasks + 31) >> 5;
 
-        // test if the task is runable
-        if ( psched->context[next_task_id][CTX_NORUN_ID] == 0 ) 
+    unsigned int next_task_id;
+    unsigned int word;
+    unsigned int tid;
+    unsigned int sig;
+
+    // handle all pending signals
+    for ( word = 0 ; word < words ; word++ )
+    {
+        while ( psched->sigpend[word] )
         {
-            found = 1;
-            // TODO: don't break to process all pending signals.
-            break;
+            tid = (word<<5) + _ctx_ffs( psched->sigpend[word] );
+
+            // acknowledge pending signals before handling them
+            _atomic_and( &psched->sigpend[word] , ~(1 << (tid & 0x1F)) );
+            sig = psched->context[tid][CTX_SIG_ID];
+
+            // this task needs to be killed
+            if ( sig & SIG_MASK_KILL )
+            {
+                _ctx_kill_task( tid );
+
+                // acknowledge signal
+                _atomic_and( &psched->context[tid][CTX_SIG_ID], ~SIG_MASK_KILL );
+            }
+
+            // this task needs to be executed
+            if ( sig & SIG_MASK_EXEC )
+            {
+                _ctx_exec_task( tid );
+
+                // acknowledge signal
+                _atomic_and( &psched->context[tid][CTX_SIG_ID], ~SIG_MASK_EXEC );
+            }
         }
     }
 
-    // launch "idle" task if no runable task
-    if (found == 0) next_task_id = IDLE_TASK_INDEX;
+    // select the highest priority level containing a runable task,
+    // and the next task in this level using a round-robin policy.
+    // launch the "idle" task if there is no runable task.
+    unsigned int level;
+
+    next_task_id = 0xFFFFFFFF;
+
+#if GIET_GANG_SCHEDULING
+    // try first the runable tasks of the current gang vspace
+    unsigned int* gang = &psched->vspace_mask[_gang_vsid][0];
+
+    for ( level = PRIORITY_LEVELS ; 
+          (level > 0) && (next_task_id == 0xFFFFFFFF) ; 
+          level-- )
+    {
+        next_task_id = _ctx_next_in_level( psched , level - 1 , curr_task_id , gang );
+    }
+#endif
+
+    for ( level = PRIORITY_LEVELS ; 
+          (level > 0) && (next_task_id == 0xFFFFFFFF) ; 
+          level-- )
+    {
+        next_task_id = _ctx_next_in_level( psched , level - 1 , curr_task_id , NULL );
+    }
+
+    if ( next_task_id == 0xFFFFFFFF ) next_task_id = tasks;
+
+    // start or stop the TICK timer
+    _ctx_update_tick();
 
 #if GIET_DEBUG_SWITCH
 unsigned int x = cluster_xy >> Y_WIDTH;
@@ -196,10 +502,26 @@ _printf("\n[DEBUG SWITCH] (%d) -> (%d) on processor[%d,%d,%d] at cycle %d\n",
         curr_task_id, next_task_id, x, y , lpid, _get_proctime() );
 #endif
 
-    if (curr_task_id != next_task_id)  // actual task switch required
+    if ( (curr_task_id != next_task_id) || exited )  // actual task switch required
     {
         unsigned int* curr_ctx_vaddr = &(psched->context[curr_task_id][0]);
         unsigned int* next_ctx_vaddr = &(psched->context[next_task_id][0]);
+        unsigned int  date           = _get_proctime();
+
+        // update accounting slots (the current task is preempted 
+        // if it is still runable). The slot of an exited task can
+        // already be reused: its context is saved in the trash buffer.
+        if ( exited )
+        {
+            curr_ctx_vaddr = _ctx_exit_trash;
+        }
+        else
+        {
+            curr_ctx_vaddr[CTX_RUN_ID]     += date - curr_ctx_vaddr[CTX_DATE_ID];
+            curr_ctx_vaddr[CTX_NSWITCH_ID] += 1;
+            if ( curr_ctx_vaddr[CTX_NORUN_ID] == 0 ) curr_ctx_vaddr[CTX_NPREEMPT_ID] += 1;
+        }
+        next_ctx_vaddr[CTX_DATE_ID]     = date;
 
         // reset TICK timer counter. 
         _xcu_timer_reset_cpt( cluster_xy, lpid );
@@ -210,37 +532,28 @@ _printf("\n[DEBUG SWITCH] (%d) -> (%d) on processor[%d,%d,%d] at cycle %d\n",
         // makes context switch
         _task_switch( curr_ctx_vaddr , next_ctx_vaddr );
     }
-} //end _ctx_switch()
+} //end _ctx_switch_generic()
+
+//////////////////
+void _ctx_switch() 
+{
+    _ctx_switch_generic( 0 );
+}
+
+//////////////////////
+void _ctx_exit_switch() 
+{
+    _ctx_switch_generic( 1 );
+}
 
 
 /////////////////
 void _idle_task() 
 {
-    unsigned int gpid       = _get_procid();
-    unsigned int cluster_xy = gpid >> P_WIDTH;
-    unsigned int x          = cluster_xy >> Y_WIDTH;
-    unsigned int y          = cluster_xy & ((1<<Y_WIDTH)-1);
-    unsigned int p          = gpid & ((1<<P_WIDTH)-1);
-
     while(1)
     {
-        // initialize counter
-        unsigned int count = GIET_IDLE_TASK_PERIOD;
-
-        // decounting loop
-        asm volatile(
-                "move   $3,   %0              \n"
-                "_idle_task_loop:             \n"
-                "addi   $3,   $3,   -1        \n"
-                "bnez   $3,   _idle_task_loop \n"
-                "nop                          \n"
-                :
-                : "r"(count)
-                : "$3" ); 
-
-        // warning message
-        _printf("\n[GIET WARNING] Processor[%d,%d,%d] still idle at cycle %d",
-                x , y , p , _get_proctime() );
+        // wait for an interrupt (TICK timer is generally stopped)
+        asm volatile( "wait" );
     }
 } // end ctx_idle()
 
@@ -8,10 +8,52 @@
 // This code is used to support context switch when several tasks are executing
 // in time multiplexing on a single processor.
 // The tasks are statically allocated to a processor in the boot phase, and
-// there is one private scheduler per processor. Each sheduler occupies 8K bytes, 
-// and contains up to 14 task contexts (task_id is from 0 to 13).
-// The task context [13] is reserved for the "idle" task that does nothing, and
-// is launched by the scheduler when there is no other runable task.
+// there is one private scheduler per processor. Each scheduler has a variable
+// size : a fixed size header (512 bytes), followed by the idle task stack 
+// (4 Kbytes), followed by (tasks + 1) task contexts (256 bytes per context),
+// where "tasks" is the number of tasks placed on the processor by the mapping,
+// that cannot be larger than GIET_NB_TASKS_PROC_MAX (task_id is from 0 to 
+// tasks-1). The boot-loader computes the length of the schedulers vseg in each
+// cluster from the actual number of tasks placed on each processor, and 
+// checks it against the vseg length defined in the mapping: as the header
+// size is unchanged, an 8 Kbytes scheduler still supports 13 tasks.
+// In gang scheduling mode, the header is extended by the "vspace_mask"
+// bit-vectors (GIET_NB_VSPACE_MAX * SCHED_WORDS words).
+// The last task context [tasks] is reserved for the "idle" task that does 
+// nothing, and is launched by the scheduler when there is no other runable task.
+// The scheduler maintains two bit-vectors indexed by the local task index:
+// - the "runnable" bit-vector has bit[ltid] set when CTX_NORUN[ltid] is zero.
+// - the "sigpend" bit-vector has bit[ltid] set when CTX_SIG[ltid] is non zero.
+// They must be updated each time a NORUN or SIG slot is modified, and this is
+// done by the _ctx_set_norun(), _ctx_reset_norun() and _ctx_set_sig() functions,
+// that must be used instead of direct access to these slots.
+// They allow the _ctx_switch() function to select the next task and to handle
+// pending signals with a cost that does not depend on the number of tasks.
+// Each task has a priority level defined in the mapping, from 0 (lowest) to
+// (PRIORITY_LEVELS - 1) (highest). The "prio_mask[level]" bit-vector, defined 
+// by the boot-loader, has bit[ltid] set when the task priority is "level".
+// The scheduler always selects a task in the highest level containing
+// a runable task, with a round-robin policy between tasks in the same level.
+// The TICK timer is only activated when there is more than one runable task:
+// when there is nothing to preempt, the timer is stopped, and the "idle" task
+// waits for an interrupt. It is activated again by the WAKUP WTI signaling
+// that a blocked task becomes runable (see _ctx_update_tick()).
+// When GIET_GANG_SCHEDULING is non zero, the tasks of a same vspace are
+// co-scheduled on all processors: the TICK timer of processor P[0,0,0] is
+// always running, and the other TICK timers are stopped. At each TICK,
+// P[0,0,0] selects the next "gang" vspace (_gang_vsid), and sends one WAKUP
+// WTI to processor P0 of each other cluster, that forwards it to the other
+// processors of its cluster. All processors are forced to switch context:
+// the time slices are therefore aligned, and each scheduler selects in
+// priority the runable tasks of the gang vspace, defined by the
+// "vspace_mask[vsid]" bit-vector (only defined in this mode).
+// It falls back to the default policy when no such task is runable.
+// Some task slots can be reserved in the mapping ("dynamic" tasks) to support
+// the giet_pthread_create() system call: these tasks are not active at boot,
+// and the CTX_PTHREAD slot defines the state of the slot (see below).
+// Each task context contains accounting slots: the execution time and the
+// number of context switches are updated by _ctx_switch(), and the time spent
+// blocked on IOC or COPROC transfers is updated by the blocking functions.
 /////////////////////////////////////////////////////////////////////////////////
 // A task context is an array of 64 uint32 words => 256 bytes. 
 // It contains copies of processor registers (when the task is preempted)
@@ -28,14 +70,14 @@
 // ctx[6] <- $6    |ctx[14]<- $14    |ctx[22]<- $22    |ctx[30]<- $30
 // ctx[7] <- $7    |ctx[15]<- $15    |ctx[23]<- $23    |ctx[31]<- RA
 //
-// ctx[32]<- EPC   |ctx[40]<- TTY    |ctx[48]<- TRDID  |ctx[56]<- ***
-// ctx[33]<- CR    |ctx[41]<- CMA_FB |ctx[49]<- GTID   |ctx[57]<- ***
-// ctx[34]<- SR    |ctx[42]<- CMA_RX |ctx[50]<- NORUN  |ctx[58]<- ***
-// ctx[35]<- BVAR  |ctx[43]<- CMA_TX |ctx[51]<- COPROC |ctx[59]<- ***
-// ctx[36]<- PTAB  |ctx[44]<- NIC_RX |ctx[52]<- ENTRY  |ctx[60]<- ***
-// ctx[37]<- LTID  |ctx[45]<- NIC_TX |ctx[53]<- SIG    |ctx[61]<- ***
-// ctx[38]<- VSID  |ctx[46]<- TIM    |ctx[54]<- ***    |ctx[62]<- ***
-// ctx[39]<- PTPR  |ctx[47]<- HBA    |ctx[55]<- ***    |ctx[63]<- ***
+// ctx[32]<- EPC   |ctx[40]<- TTY    |ctx[48]<- TRDID  |ctx[56]<- PTHREAD
+// ctx[33]<- CR    |ctx[41]<- CMA_FB |ctx[49]<- GTID   |ctx[57]<- RETVAL
+// ctx[34]<- SR    |ctx[42]<- CMA_RX |ctx[50]<- NORUN  |ctx[58]<- RUN
+// ctx[35]<- BVAR  |ctx[43]<- CMA_TX |ctx[51]<- COPROC |ctx[59]<- NSWITCH
+// ctx[36]<- PTAB  |ctx[44]<- NIC_RX |ctx[52]<- ENTRY  |ctx[60]<- NPREEMPT
+// ctx[37]<- LTID  |ctx[45]<- NIC_TX |ctx[53]<- SIG    |ctx[61]<- IOC_WAIT
+// ctx[38]<- VSID  |ctx[46]<- TIM    |ctx[54]<- PRIO   |ctx[62]<- COP_WAIT
+// ctx[39]<- PTPR  |ctx[47]<- HBA    |ctx[55]<- WAIT   |ctx[63]<- DATE
 /////////////////////////////////////////////////////////////////////////////////
 
 #ifndef _CTX_HANDLER_H
@@ -74,6 +116,17 @@
 #define CTX_COPROC_ID    51    // cluster_xy : coprocessor coordinates
 #define CTX_ENTRY_ID     52    // Virtual address of task entry point
 #define CTX_SIG_ID       53    // bit-vector : pending signals for task
+#define CTX_PRIO_ID      54    // task priority level (0 is the lowest)
+#define CTX_WAIT_ID      55    // user virtual address of the awaited futex
+#define CTX_PTHREAD_ID   56    // pthread slot state (PTHREAD_NONE if static)
+#define CTX_RETVAL_ID    57    // value returned by an exited pthread
+
+#define CTX_RUN_ID       58    // cumulated execution time (cycles)
+#define CTX_NSWITCH_ID   59    // number of times the task has been descheduled
+#define CTX_NPREEMPT_ID  60    // number of times the task has been preempted
+#define CTX_IOC_WAIT_ID  61    // cumulated time blocked on IOC transfers
+#define CTX_COP_WAIT_ID  62    // cumulated time blocked on COPROC transfers
+#define CTX_DATE_ID      63    // date of the last task switch (cycles)
 
 /////////////////////////////////////////////////////////////////////////////////
 //    Definition of the NORUN bit-vector masks
@@ -82,6 +135,7 @@
 #define NORUN_MASK_TASK       0x00000001   // Task not active  
 #define NORUN_MASK_IOC        0x00000002   // Task blocked on IOC transfer
 #define NORUN_MASK_COPROC     0x00000004   // Task blocked on COPROC transfer
+#define NORUN_MASK_WAIT       0x00000008   // Task blocked on a futex
 
 /////////////////////////////////////////////////////////////////////////////////
 //    Definition of the SIG bit-vector masks
@@ -90,23 +144,66 @@
 #define SIG_MASK_KILL         0x00000001   // Task will be killed at next tick
 #define SIG_MASK_EXEC         0x00000002   // Task will be executed at next tick
 
+/////////////////////////////////////////////////////////////////////////////////
+//    Definition of the WAKUP WTI mailbox values
+/////////////////////////////////////////////////////////////////////////////////
+
+#define WAKUP_SWITCH          1            // force a context switch
+#define WAKUP_GANG_RELAY      2            // forward to cluster, then switch
+
+/////////////////////////////////////////////////////////////////////////////////
+//    Definition of the PTHREAD slot states
+/////////////////////////////////////////////////////////////////////////////////
+
+#define PTHREAD_NONE          0            // Static task (not a pthread slot)
+#define PTHREAD_FREE          1            // Slot available for pthread_create
+#define PTHREAD_RUNNING       2            // Pthread created and not exited
+#define PTHREAD_EXITED        3            // Pthread exited and not joined
+
+/////////////////////////////////////////////////////////////////////////////////
+//    Number of task priority levels
+/////////////////////////////////////////////////////////////////////////////////
+
+#define PRIORITY_LEVELS       4
+
+/////////////////////////////////////////////////////////////////////////////////
+//    Number of 32 bits words in the scheduler bit-vectors
+/////////////////////////////////////////////////////////////////////////////////
+
+#define SCHED_WORDS           ((GIET_NB_TASKS_PROC_MAX + 31) >> 5)
+
+#if ( ((PRIORITY_LEVELS + 2) * SCHED_WORDS) > 29 )
+# error: GIET_NB_TASKS_PROC_MAX too large for the scheduler header
+#endif
+
 /////////////////////////////////////////////////////////////////////////////////
 //    Definition of the scheduler structure
 /////////////////////////////////////////////////////////////////////////////////
 
 typedef struct static_scheduler_s 
 {
-    unsigned int context[14][64];      // at most 14 task (including idle_task)
-    unsigned int tasks;                // actual number of tasks
+    unsigned int tasks;                // actual number of tasks (idle excluded)
     unsigned int current;              // current task index
     unsigned int hwi_vector[32];       // hardware interrupt vector
     unsigned int pti_vector[32];       // timer    interrupt vector
     unsigned int wti_vector[32];       // software interrupt vector
-    unsigned int reserved[30];         // padding to 4 Kbytes
-    unsigned int idle_stack[1024];     // private stack for idle stack (4Kbytes)
+    unsigned int runnable[SCHED_WORDS];    // bit-vector : runnable tasks
+    unsigned int sigpend[SCHED_WORDS];     // bit-vector : pending signals
+    unsigned int prio_mask[PRIORITY_LEVELS][SCHED_WORDS]; // tasks per level
+    unsigned int ticking;              // TICK timer activated if non zero
+    unsigned int reserved[29 - ((PRIORITY_LEVELS + 2) * SCHED_WORDS)]; // 512 bytes
+#if GIET_GANG_SCHEDULING
+    unsigned int vspace_mask[GIET_NB_VSPACE_MAX][SCHED_WORDS]; // tasks per vspace
+#endif
+    unsigned int idle_stack[1024];     // private stack for idle task (4 Kbytes)
+    unsigned int context[][64];        // (tasks + 1) contexts (idle is the last)
 } static_scheduler_t;
 
-#define IDLE_TASK_INDEX        13
+/////////////////////////////////////////////////////////////////////////////////
+//    Scheduler length (bytes) as a function of the number of tasks
+/////////////////////////////////////////////////////////////////////////////////
+
+#define SCHED_SIZE( tasks )   (sizeof(static_scheduler_t) + (((tasks) + 1) << 8))
 
 
 /////////////////////////////////////////////////////////////////////////////////
@@ -117,15 +214,100 @@ typedef struct static_scheduler_s
 // This function performs a context switch between the running task
 // and  another task, using a round-robin sheduling policy between all
 // tasks allocated to a given processor (static allocation).
-// It selects the next runable task to resume execution. 
+// It first handles the pending signals registered in the "sigpend" bit-vector.
+// It selects the next runable task to resume execution in the highest priority
+// level containing a runable task, as the first task of this level following
+// the current task in the "runnable" bit-vector. 
 // If the only runable task is the current task, return without context switch.
 // If there is no runable task, the scheduler switch to the default "idle" task.
 // The return address contained in $31 is saved in the current task context
 // (in the ctx[31] slot), and the function actually returns to the address
 // contained in the ctx[31] slot of the next task context.
+// It starts or stops the TICK timer, depending on the number of runable tasks.
 /////////////////////////////////////////////////////////////////////////////////
 extern void _ctx_switch();
 
+/////////////////////////////////////////////////////////////////////////////////
+// This function is called by an exiting pthread, with interrupts disabled,
+// after the PTHREAD_EXITED state has been published: the pthread slot can
+// then be freed by a joining task and reused by giet_pthread_create() on
+// another processor before the switch. It does the same as _ctx_switch(),
+// but the registers of the exiting pthread are not saved in its slot, and
+// the switch is done even if the next task is in the same (reused) slot.
+// This function never returns.
+/////////////////////////////////////////////////////////////////////////////////
+extern void _ctx_exit_switch();
+
+/////////////////////////////////////////////////////////////////////////////////
+// This function starts the TICK timer of the calling processor when there is 
+// more than one runable task in its scheduler, and stops it otherwise.
+// It must be called by the processor owning the scheduler, with interrupts
+// disabled, each time a task can have become runable: this is done by the
+// _ctx_switch() function, and by the _isr_wakup() function.
+/////////////////////////////////////////////////////////////////////////////////
+extern void _ctx_update_tick();
+
+/////////////////////////////////////////////////////////////////////////////////
+// This function returns a non zero value if the running task on the calling
+// processor must be immediately preempted: the current task is the idle task,
+// or there is a runable task in a priority level higher than the current
+// task level. It is used by the _isr_wakup() function, to avoid waiting
+// the next TICK when a blocked task is woken by an IOC or COPROC completion.
+// It must be called with interrupts disabled.
+/////////////////////////////////////////////////////////////////////////////////
+extern unsigned int _ctx_preempt_required();
+
+#if GIET_GANG_SCHEDULING
+
+/////////////////////////////////////////////////////////////////////////////////
+// This function is only used when GIET_GANG_SCHEDULING is non zero, and is
+// called by processor P[0,0,0] at each TICK, before its own context switch.
+// It selects the next "gang" vspace, sends a WAKUP WTI with the WAKUP_GANG_RELAY
+// mailbox value to processor P0 of all other clusters, and forces a context
+// switch on the other processors of cluster[0,0].
+/////////////////////////////////////////////////////////////////////////////////
+extern void _ctx_gang_tick();
+
+/////////////////////////////////////////////////////////////////////////////////
+// This function is only used when GIET_GANG_SCHEDULING is non zero, and is
+// called by processor P0 of a cluster when it receives a WAKUP WTI with the
+// WAKUP_GANG_RELAY mailbox value. It sends a WAKUP WTI (with the
+// WAKUP_SWITCH mailbox value) to the other processors of the cluster.
+/////////////////////////////////////////////////////////////////////////////////
+extern void _ctx_gang_relay();
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////
+// This function sets the bits defined by the mask argument in the NORUN slot
+// of the task identified by the psched and ltid arguments, and updates
+// the scheduler "runnable" bit-vector accordingly. It can be called by any
+// processor (for example by an ISR), as it uses atomic operations.
+/////////////////////////////////////////////////////////////////////////////////
+extern void _ctx_set_norun( static_scheduler_t* psched,
+                            unsigned int        ltid,
+                            unsigned int        mask );
+
+/////////////////////////////////////////////////////////////////////////////////
+// This function resets the bits defined by the mask argument in the NORUN slot
+// of the task identified by the psched and ltid arguments, and updates
+// the scheduler "runnable" bit-vector accordingly. It can be called by any
+// processor (for example by an ISR), as it uses atomic operations.
+/////////////////////////////////////////////////////////////////////////////////
+extern void _ctx_reset_norun( static_scheduler_t* psched,
+                              unsigned int        ltid,
+                              unsigned int        mask );
+
+/////////////////////////////////////////////////////////////////////////////////
+// This function sets the bits defined by the mask argument in the SIG slot
+// of the task identified by the psched and ltid arguments, and registers
+// the task in the scheduler "sigpend" bit-vector. The signal is handled
+// by the scheduler at the next context switch.
+/////////////////////////////////////////////////////////////////////////////////
+extern void _ctx_set_sig( static_scheduler_t* psched,
+                          unsigned int        ltid,
+                          unsigned int        mask );
+
 /////////////////////////////////////////////////////////////////////////////////
 // The address of this function is used to initialise the return address
 // in the "idle" task context.
@@ -134,6 +316,7 @@ extern void _ctx_eret();
 
 /////////////////////////////////////////////////////////////////////////////////
 // This function is executed task when no other task can be executed.
+// It waits for an interrupt (generally a WAKUP WTI) without polling.
 /////////////////////////////////////////////////////////////////////////////////
 extern void _idle_task();
 
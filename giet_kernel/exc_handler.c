@@ -84,7 +84,8 @@ static void _display_cause( unsigned int type )
             mips32_exc_str[type], _get_epc(), _get_bvar() );
 
     // goes to sleeping state
-    _set_context_slot( CTX_NORUN_ID , 1 );
+    static_scheduler_t* psched = (static_scheduler_t*)_get_sched();
+    _ctx_set_norun( psched , task , NORUN_MASK_TASK );
 
     // deschedule 
     unsigned int save_sr;  
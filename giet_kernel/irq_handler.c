@@ -363,6 +363,8 @@ void _isr_wakup( unsigned int irq_type,   // HWI / WTI / PTI
 
     unsigned int ltid       = _get_current_task_id();
 
+    static_scheduler_t* psched = (static_scheduler_t*)_get_sched();
+
     if ( irq_type != IRQ_TYPE_WTI )
     {
         _printf("[GIET ERROR] P[%d,%d,%d] enters _isr_wakup() at cycle %d\n"
@@ -380,13 +382,17 @@ _printf("\n[DEBUG SWITCH] P[%d,%d,%d] enters _isr_wakup() at cycle %d\n"
         x , y , p , _get_proctime() , irq_id , ltid , value );
 #endif
 
-    // enter critical section and swich context (if required)
-    if ( (ltid == IDLE_TASK_INDEX) || (value != 0) )
-    {
-        _it_disable( &save_sr );
-        _ctx_switch();
-        _it_restore( &save_sr );
-    }
+    // enter critical section and swich context (if required, or if a
+    // higher priority task became runable), or restart the TICK timer
+    // if a second task became runable
+    _it_disable( &save_sr );
+#if GIET_GANG_SCHEDULING
+    if ( value == WAKUP_GANG_RELAY ) _ctx_gang_relay();
+#endif
+    if ( (ltid == psched->tasks) || (value != 0) || 
+         _ctx_preempt_required() ) _ctx_switch();
+    else                           _ctx_update_tick();
+    _it_restore( &save_sr );
 
 } // end _isr_wakup
 
@@ -422,7 +428,11 @@ _printf("\n[DEBUG SWITCH] P[%d,%d,%d] enters _isr_tick() at cycle %d\n"
 #endif
 
     // enter critical section and switch context 
+    // (P[0,0,0] first selects the next gang in gang scheduling mode)
     _it_disable( &save_sr );
+#if GIET_GANG_SCHEDULING
+    if ( gpid == 0 ) _ctx_gang_tick();
+#endif
     _ctx_switch();
     _it_restore( &save_sr );
 
@@ -126,8 +126,11 @@ extern void _isr_default();
 ///////////////////////////////////////////////////////////////////////////
 // This ISR can only be executed after a WTI to force a context switch
 // on a remote processor. The context switch is only executed if the 
-// current task is the IDLE_TASK, or if the value written in the mailbox 
-// is non zero.
+// current task is the IDLE_TASK, if the value written in the mailbox 
+// is non zero, or if a runable task has a priority level higher than the 
+// current task (see _ctx_preempt_required()): a task woken by an IOC or
+// COPROC completion does not wait the next TICK to preempt a lower
+// priority task.
 ///////////////////////////////////////////////////////////////////////////
 
 extern void _isr_wakup( unsigned int irq_type,
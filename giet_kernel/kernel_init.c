@@ -59,8 +59,8 @@
 # error: You must define USE_PIC in the hard_config.h file
 #endif
 
-#if !defined(IDLE_TASK_INDEX) 
-# error: You must define IDLE_TASK_INDEX in the ctx_handler.h file
+#if !defined(GIET_NB_TASKS_PROC_MAX) 
+# error: You must define GIET_NB_TASKS_PROC_MAX in the giet_config.h file
 #endif
 
 #if !defined(GIET_TICK_VALUE) 
@@ -173,6 +173,7 @@ _nolock_printf("\n[DEBUG KINIT] P[%d,%d,%d] completes MMC distributed lock init\
 #endif
         //////  distributed lock for TTY0
         _sqt_lock_init( &_tty0_sqt_lock );
+        _lock_stats_register( &_tty0_sqt_lock.stats, "tty0_sqt_lock" );
 
 #if GIET_DEBUG_INIT
 _nolock_printf("\n[DEBUG KINIT] P[%d,%d,%d] completes TTY0 lock init\n", x , y , p );
@@ -222,6 +223,7 @@ _nolock_printf("\n[DEBUG KINIT] P[%d,%d,%d] completes SDC init\n", x , y , p );
         if ( USE_IOC_BDV )
         {
             _bdv_init();
+            _lock_stats_register( &_bdv_lock.stats, "bdv_lock" );
             _ext_irq_alloc( ISR_BDV , 0 , &unused );
 
 #if GIET_DEBUG_INIT
@@ -318,23 +320,24 @@ _printf("\n[DEBUG KINIT] P[%d,%d,%d] initialises PTABS arrays"
     // step 3 : - Each processor complete idle task context initialisation.
     //            Only CTX_SP, CTX_RA, CTX_EPC, CTX_ENTRY slots, because other
     //            slots have been initialised in boot code)
-    //            The 4 Kbytes idle stack is implemented in the scheduler itself.
-    //          - Each processor starts TICK timer, if at least one task.
+    //            The 4 Kbytes idle stack is implemented in the scheduler itself,
+    //            and the idle task context is the last context in scheduler.
+    //          - Each processor starts TICK timer, if more than one runable task.
     //          - P[0,0,0] initialises FAT (not done before, because it must 
     //            be done after the _ptabs_vaddr[v][x][y] array initialisation, 
     //            for V2P translation in _fat_ioc_access() function).
     ////////////////////////////////////////////////////////////////////////////
 
-    unsigned int sp    = ((unsigned int)psched) + 0x2000;
+    unsigned int sp    = (unsigned int)(&psched->idle_stack[1024]);
     unsigned int ra    = (unsigned int)(&_ctx_eret);
     unsigned int entry = (unsigned int)(&_idle_task);
 
-    _set_task_slot( x , y , p , IDLE_TASK_INDEX , CTX_SP_ID  , sp    );
-    _set_task_slot( x , y , p , IDLE_TASK_INDEX , CTX_RA_ID  , ra    );
-    _set_task_slot( x , y , p , IDLE_TASK_INDEX , CTX_EPC_ID , entry );
-    _set_task_slot( x , y , p , IDLE_TASK_INDEX , CTX_ENTRY_ID , entry );
+    _set_task_slot( x , y , p , tasks , CTX_SP_ID  , sp    );
+    _set_task_slot( x , y , p , tasks , CTX_RA_ID  , ra    );
+    _set_task_slot( x , y , p , tasks , CTX_EPC_ID , entry );
+    _set_task_slot( x , y , p , tasks , CTX_ENTRY_ID , entry );
 
-    if (tasks > 0) _xcu_timer_start( cluster_xy, p, GIET_TICK_VALUE ); 
+    _ctx_update_tick();
 
 #if GIET_DEBUG_INIT
 _printf("\n[DEBUG KINIT] P[%d,%d,%d] initializes idle_task and starts TICK\n",  
@@ -366,8 +369,8 @@ _printf("\n[DEBUG KINIT] P[%d,%d,%d] completes kernel FAT init\n",
     if (tasks == 0) _printf("\n[GIET WARNING] No task allocated to P[%d,%d,%d]\n",
                             x, y, p );
 
-    // default value for ltid
-    ltid = IDLE_TASK_INDEX;
+    // default value for ltid (idle task)
+    ltid = tasks;
 
     // scan allocated tasks to find a runable task
     unsigned int  task_id; 
@@ -380,8 +383,9 @@ _printf("\n[DEBUG KINIT] P[%d,%d,%d] completes kernel FAT init\n",
         }
     }
 
-    // update scheduler
+    // update scheduler and accounting date
     psched->current = ltid;
+    _set_task_slot( x, y, p, ltid, CTX_DATE_ID, _get_proctime() );
 
     // get values from selected task context
     unsigned int sp_value   = _get_task_slot( x, y, p, ltid, CTX_SP_ID);
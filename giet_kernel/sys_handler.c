@@ -12,6 +12,7 @@
 #include <mmc_driver.h>
 #include <mwr_driver.h>
 #include <cma_driver.h>
+#include <xcu_driver.h>
 #include <ctx_handler.h>
 #include <fat32.h>
 #include <utils.h>
@@ -128,6 +129,18 @@ unsigned long long _fbf_chbuf_paddr[NB_CMA_CHANNELS];
 __attribute__((section(".kdata")))
 buffer_status_t _fbf_status[NB_CMA_CHANNELS] __attribute__((aligned(64)));
 
+////////////////////////////////////////////////////////////////////////////
+// Futex locks array, indexed by the vspace index.
+// A futex is identified by a user virtual address, that is only meaningful
+// in the vspace of the calling task: the waiting tasks are registered in
+// their CTX_WAIT slot, and this lock protects the test-and-block sequence
+// in _sys_futex_wait() against a concurrent _sys_futex_wake().
+// It protects also the CTX_PTHREAD slots of the tasks in the vspace.
+////////////////////////////////////////////////////////////////////////////
+
+__attribute__((section(".kdata")))
+spin_lock_t _futex_lock[GIET_NB_VSPACE_MAX] __attribute__((aligned(64)));
+
 ////////////////////////////////////////////////////////////////////////////
 //    Initialize the syscall vector with syscall handlers
 // Note: This array must be synchronised with the define in file stdio.h
@@ -142,7 +155,7 @@ const void * _syscall_vector[64] =
     &_sys_tty_read,                  /* 0x03 */
     &_sys_tty_alloc,                 /* 0x04 */
     &_sys_tasks_status,              /* 0x05 */
-    &_sys_ukn,                       /* 0x06 */
+    &_sys_pthread_join,              /* 0x06 */
     &_sys_heap_info,                 /* 0x07 */
     &_sys_local_task_id,             /* 0x08 */
     &_sys_global_task_id,            /* 0x09 */ 
@@ -166,9 +179,9 @@ const void * _syscall_vector[64] =
     &_sys_vseg_get_vbase,            /* 0x1A */
     &_sys_vseg_get_length,           /* 0x1B */
     &_sys_xy_from_ptr,               /* 0x1C */
-    &_sys_ukn,                       /* 0x1D */
-    &_sys_ukn,                       /* 0x1E */
-    &_sys_ukn,                       /* 0x1F */
+    &_sys_futex_wait,                /* 0x1D */
+    &_sys_futex_wake,                /* 0x1E */
+    &_sys_pthread_create,            /* 0x1F */
 
     &_fat_open,                      /* 0x20 */
     &_fat_read,                      /* 0x21 */
@@ -182,7 +195,7 @@ const void * _syscall_vector[64] =
     &_fat_opendir,                   /* 0x29 */
     &_fat_closedir,                  /* 0x2A */
     &_fat_readdir,                   /* 0x2B */
-    &_sys_ukn,                       /* 0x2C */
+    &_sys_pthread_exit,              /* 0x2C */
     &_sys_ukn,                       /* 0x2D */
     &_sys_ukn,                       /* 0x2E */
     &_sys_ukn,                       /* 0x2F */
@@ -193,8 +206,8 @@ const void * _syscall_vector[64] =
     &_sys_nic_stop,                  /* 0x33 */
     &_sys_nic_stats,                 /* 0x34 */
     &_sys_nic_clear,                 /* 0x35 */ 
-    &_sys_ukn,                       /* 0x36 */
-    &_sys_ukn,                       /* 0x37 */
+    &_sys_tasks_stats,               /* 0x36 */
+    &_sys_locks_stats,               /* 0x37 */
     &_sys_ukn,                       /* 0x38 */   
     &_sys_ukn,                       /* 0x39 */
     &_sys_ukn,                       /* 0x3A */
@@ -249,7 +262,11 @@ _printf("\n[DEBUG EXEC] enters _sys_kill_application() for %s\n", name );
                 static_scheduler_t* psched  = (static_scheduler_t*)_schedulers[x][y][p];
 
                 // set KILL signal bit
-                _atomic_or( &psched->context[ltid][CTX_SIG_ID] , SIG_MASK_KILL );
+                _ctx_set_sig( psched , ltid , SIG_MASK_KILL );
+
+                // send a WAKUP WTI to force a context switch on the processor
+                // running the task (the TICK timer can be stopped)
+                _xcu_send_wti( (x<<Y_WIDTH) + y , p , 1 );
             } 
 
 #if GIET_DEBUG_EXEC 
@@ -307,7 +324,11 @@ _printf("\n[DEBUG EXEC] enters _sys_exec_application() at cycle %d for %s\n",
                 static_scheduler_t* psched  = (static_scheduler_t*)_schedulers[x][y][p];
 
                 // set EXEC signal bit
-                _atomic_or( &psched->context[ltid][CTX_SIG_ID] , SIG_MASK_EXEC );
+                _ctx_set_sig( psched , ltid , SIG_MASK_EXEC );
+
+                // send a WAKUP WTI to force a context switch on the processor
+                // running the task (the TICK timer can be stopped)
+                _xcu_send_wti( (x<<Y_WIDTH) + y , p , 1 );
             } 
 
 #if GIET_DEBUG_EXEC 
@@ -329,6 +350,383 @@ _printf("\n[DEBUG EXEC] exit _sys_exec_application() at cycle %d : %s not found\
     return -1;    // not found 
 
 }  // end _sys_exec_application()
+
+
+//////////////////////////////////////////////////////////////////////////////
+//           Futex related syscall handlers 
+//////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////
+int _sys_futex_wait( unsigned int* vaddr,
+                     unsigned int  value )
+{
+    unsigned int save_sr;
+
+    // check address alignment
+    if ( (unsigned int)vaddr & 0x3 )
+    {
+        _printf("\n[GIET ERROR] in _sys_futex_wait() : vaddr %x not aligned\n",
+                (unsigned int)vaddr );
+        return -1;
+    }
+
+    static_scheduler_t* psched = (static_scheduler_t*)_get_sched();
+    unsigned int        ltid   = psched->current;
+    unsigned int        vsid   = psched->context[ltid][CTX_VSID_ID];
+
+    _it_disable( &save_sr );
+    _spin_lock_acquire( &_futex_lock[vsid] );
+
+    // return immediately if the futex value has already changed
+    if ( *vaddr != value )
+    {
+        _spin_lock_release( &_futex_lock[vsid] );
+        _it_restore( &save_sr );
+        return 0;
+    }
+
+    // register the futex and deschedule
+    psched->context[ltid][CTX_WAIT_ID] = (unsigned int)vaddr;
+    _ctx_set_norun( psched , ltid , NORUN_MASK_WAIT );
+
+#if GIET_DEBUG_SYS_SYNC
+if ( _get_proctime() > GIET_DEBUG_SYS_SYNC )
+_printf("\n[DEBUG SYS_SYNC] _sys_futex_wait() : task %d in vspace %d"
+        " blocked on futex %x at cycle %d\n",
+        ltid , vsid , (unsigned int)vaddr , _get_proctime() );
+#endif
+
+    _spin_lock_release( &_futex_lock[vsid] );
+    _ctx_switch();
+    _it_restore( &save_sr );
+
+    return 0;
+}  // end _sys_futex_wait()
+
+//////////////////////////////////////////////////////////////////////////////
+// This function makes runable at most <count> tasks of vspace <vsid> that are
+// blocked on the futex identified by <key>, and returns their number.
+// The caller must hold the _futex_lock[vsid] lock.
+//////////////////////////////////////////////////////////////////////////////
+static unsigned int _futex_wake_locked( unsigned int vsid,
+                                        unsigned int key,
+                                        unsigned int count )
+{
+    mapping_header_t * header  = (mapping_header_t *)SEG_BOOT_MAPPING_BASE;
+    mapping_vspace_t * vspace  = _get_vspace_base(header);
+    mapping_task_t   * task    = _get_task_base(header);
+
+    unsigned int task_id;
+    unsigned int woken  = 0;
+    unsigned int y_size = header->y_size;
+    unsigned int min    = vspace[vsid].task_offset;
+    unsigned int max    = min + vspace[vsid].tasks;
+
+    // scan tasks in vspace
+    for ( task_id = min ; (task_id < max) && (woken < count) ; task_id++ )
+    {
+        unsigned int cid   = task[task_id].clusterid;
+        unsigned int x     = cid / y_size;
+        unsigned int y     = cid % y_size;
+        unsigned int p     = task[task_id].proclocid;
+        unsigned int ltid  = task[task_id].ltid;
+
+        // get scheduler pointer for processor running the task
+        static_scheduler_t* psched  = (static_scheduler_t*)_schedulers[x][y][p];
+
+        if ( psched->context[ltid][CTX_WAIT_ID] == key )
+        {
+            // unregister the futex and reset NORUN_MASK_WAIT bit
+            psched->context[ltid][CTX_WAIT_ID] = 0;
+            _ctx_reset_norun( psched , ltid , NORUN_MASK_WAIT );
+
+            // send a WAKUP WTI to the processor running the task
+            // (the TICK timer can be stopped)
+            _xcu_send_wti( (x<<Y_WIDTH) + y , p , 0 );
+
+            woken++;
+        }
+    }
+
+    return woken;
+}  // end _futex_wake_locked()
+
+///////////////////////////////////////////////
+int _sys_futex_wake( unsigned int* vaddr,
+                     unsigned int  count )
+{
+    unsigned int vsid = _get_context_slot( CTX_VSID_ID );
+    unsigned int woken;
+    unsigned int save_sr;
+
+    _it_disable( &save_sr );
+    _spin_lock_acquire( &_futex_lock[vsid] );
+
+    woken = _futex_wake_locked( vsid , (unsigned int)vaddr , count );
+
+    _spin_lock_release( &_futex_lock[vsid] );
+    _it_restore( &save_sr );
+
+#if GIET_DEBUG_SYS_SYNC
+if ( _get_proctime() > GIET_DEBUG_SYS_SYNC )
+_printf("\n[DEBUG SYS_SYNC] _sys_futex_wake() : %d task(s) in vspace %d"
+        " woken on futex %x at cycle %d\n",
+        woken , vsid , (unsigned int)vaddr , _get_proctime() );
+#endif
+
+    return woken;
+}  // end _sys_futex_wake()
+
+
+//////////////////////////////////////////////////////////////////////////////
+//           Pthread related syscall handlers 
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// This function returns the initial stack pointer of the dynamic task 
+// identified by its global index <task_id>. The stack vseg of a dynamic task
+// is a stack pool, that can be shared by several dynamic tasks of the same
+// vspace: it is split in as many equal parts as tasks sharing the pool.
+//////////////////////////////////////////////////////////////////////////////
+static unsigned int _pthread_stack_top( unsigned int task_id )
+{
+    mapping_header_t * header  = (mapping_header_t *)SEG_BOOT_MAPPING_BASE;
+    mapping_vspace_t * vspace  = _get_vspace_base(header);
+    mapping_task_t   * task    = _get_task_base(header);
+    mapping_vseg_t   * vseg    = _get_vseg_base(header);
+
+    unsigned int vseg_id = task[task_id].stack_vseg_id;
+    unsigned int nslots  = 0;
+    unsigned int rank    = 0;
+    unsigned int vspace_id;
+    unsigned int min       = 0;
+    unsigned int max       = 0;
+    unsigned int tid;
+
+    // find the vspace containing the task
+    for ( vspace_id = 0 ; vspace_id < header->vspaces ; vspace_id++ )
+    {
+        min = vspace[vspace_id].task_offset;
+        max = min + vspace[vspace_id].tasks;
+        if ( (task_id >= min) && (task_id < max) ) break;
+    }
+
+    // count the dynamic tasks sharing the stack pool
+    for ( tid = min ; tid < max ; tid++ )
+    {
+        if ( (task[tid].stack_vseg_id == vseg_id) && task[tid].dynamic )
+        {
+            if ( tid < task_id ) rank++;
+            nslots++;
+        }
+    }
+
+    unsigned int size = (vseg[vseg_id].length / nslots) & 0xFFFFFFF8;
+
+    return vseg[vseg_id].vbase + ((rank + 1) * size);
+}  // end _pthread_stack_top()
+
+//////////////////////////////////////////////////////
+int _sys_pthread_create( unsigned int  xyp,
+                         unsigned int  start,
+                         unsigned int  entry,
+                         unsigned int  arg )
+{
+    mapping_header_t * header  = (mapping_header_t *)SEG_BOOT_MAPPING_BASE;
+    mapping_vspace_t * vspace  = _get_vspace_base(header);
+    mapping_task_t   * task    = _get_task_base(header);
+
+    unsigned int x      = (xyp >> 24) & 0xFF;
+    unsigned int y      = (xyp >> 16) & 0xFF;
+    unsigned int p      = xyp & 0xFFFF;
+    unsigned int y_size = header->y_size;
+    unsigned int vsid   = _get_context_slot( CTX_VSID_ID );
+    unsigned int min    = vspace[vsid].task_offset;
+    unsigned int max    = min + vspace[vsid].tasks;
+    unsigned int task_id;
+    unsigned int save_sr;
+
+    // check processor coordinates
+    if ( (x >= X_SIZE) || (y >= Y_SIZE) || (p >= NB_PROCS_MAX) )
+    {
+        _printf("\n[GIET ERROR] in _sys_pthread_create() : "
+                "illegal processor coordinates [%d,%d,%d]\n", x, y, p );
+        return -1;
+    }
+
+    _it_disable( &save_sr );
+    _spin_lock_acquire( &_futex_lock[vsid] );
+
+    // scan tasks in vspace to find a free slot on P[x,y,p]
+    for ( task_id = min ; task_id < max ; task_id++ )
+    {
+        unsigned int cid   = task[task_id].clusterid;
+        unsigned int ltid  = task[task_id].ltid;
+
+        if ( ((cid / y_size) != x) || 
+             ((cid % y_size) != y) || 
+             (task[task_id].proclocid != p) ) continue;
+
+        static_scheduler_t* psched = (static_scheduler_t*)_schedulers[x][y][p];
+
+        if ( psched->context[ltid][CTX_PTHREAD_ID] != PTHREAD_FREE ) continue;
+
+        // initialise the task context : the <start> function 
+        // receives <entry> and <arg> in registers $4 and $5
+        psched->context[ltid][4]              = entry;
+        psched->context[ltid][5]              = arg;
+        psched->context[ltid][CTX_RA_ID]      = (unsigned int)&_ctx_eret;
+        psched->context[ltid][CTX_SR_ID]      = GIET_SR_INIT_VALUE;
+        psched->context[ltid][CTX_SP_ID]      = _pthread_stack_top( task_id );
+        psched->context[ltid][CTX_EPC_ID]     = start;
+        psched->context[ltid][CTX_WAIT_ID]    = 0;
+        psched->context[ltid][CTX_RETVAL_ID]  = 0;
+        psched->context[ltid][CTX_PTHREAD_ID] = PTHREAD_RUNNING;
+
+        // reset accounting slots
+        psched->context[ltid][CTX_RUN_ID]      = 0;
+        psched->context[ltid][CTX_NSWITCH_ID]  = 0;
+        psched->context[ltid][CTX_NPREEMPT_ID] = 0;
+        psched->context[ltid][CTX_IOC_WAIT_ID] = 0;
+        psched->context[ltid][CTX_COP_WAIT_ID] = 0;
+
+        // activate the task
+        _ctx_reset_norun( psched , ltid , NORUN_MASK_TASK );
+
+        _spin_lock_release( &_futex_lock[vsid] );
+        _it_restore( &save_sr );
+
+        // send a WAKUP WTI to the selected processor
+        // (the TICK timer can be stopped)
+        _xcu_send_wti( (x<<Y_WIDTH) + y , p , 0 );
+
+#if GIET_DEBUG_SYS_SYNC
+if ( _get_proctime() > GIET_DEBUG_SYS_SYNC )
+_printf("\n[DEBUG SYS_SYNC] _sys_pthread_create() : thread %d in vspace %d"
+        " created on P[%d,%d,%d] at cycle %d\n",
+        task[task_id].trdid , vsid , x , y , p , _get_proctime() );
+#endif
+
+        return task[task_id].trdid;
+    }
+
+    _spin_lock_release( &_futex_lock[vsid] );
+    _it_restore( &save_sr );
+
+    _printf("\n[GIET ERROR] in _sys_pthread_create() : "
+            "no free pthread slot on P[%d,%d,%d]\n", x, y, p );
+    return -1;
+}  // end _sys_pthread_create()
+
+////////////////////////////////////////////
+int _sys_pthread_exit( unsigned int retval )
+{
+    static_scheduler_t* psched = (static_scheduler_t*)_get_sched();
+    unsigned int        ltid   = psched->current;
+    unsigned int        vsid   = psched->context[ltid][CTX_VSID_ID];
+    unsigned int        save_sr;
+
+    if ( psched->context[ltid][CTX_PTHREAD_ID] != PTHREAD_RUNNING ) return -1;
+
+    _it_disable( &save_sr );
+    _spin_lock_acquire( &_futex_lock[vsid] );
+
+    // register the returned value, and wake up the joining task if any
+    psched->context[ltid][CTX_RETVAL_ID]  = retval;
+    psched->context[ltid][CTX_PTHREAD_ID] = PTHREAD_EXITED;
+    _futex_wake_locked( vsid , 
+                        (unsigned int)&psched->context[ltid][CTX_PTHREAD_ID] , 
+                        0xFFFFFFFF );
+
+    // deactivate the task
+    _ctx_set_norun( psched , ltid , NORUN_MASK_TASK );
+
+#if GIET_DEBUG_SYS_SYNC
+if ( _get_proctime() > GIET_DEBUG_SYS_SYNC )
+_printf("\n[DEBUG SYS_SYNC] _sys_pthread_exit() : thread %d in vspace %d"
+        " exit at cycle %d\n",
+        psched->context[ltid][CTX_TRDID_ID] , vsid , _get_proctime() );
+#endif
+
+    // the slot can be reused as soon as the lock is released : the 
+    // registers of the exiting pthread must not be saved in this slot
+    _spin_lock_release( &_futex_lock[vsid] );
+    _ctx_exit_switch();
+
+    // not reached
+    _it_restore( &save_sr );
+
+    return 0;
+}  // end _sys_pthread_exit()
+
+////////////////////////////////////////////////
+int _sys_pthread_join( unsigned int  trdid,
+                       unsigned int* retval )
+{
+    mapping_header_t * header  = (mapping_header_t *)SEG_BOOT_MAPPING_BASE;
+    mapping_vspace_t * vspace  = _get_vspace_base(header);
+    mapping_task_t   * task    = _get_task_base(header);
+
+    static_scheduler_t* psched = (static_scheduler_t*)_get_sched();
+    unsigned int        ltid   = psched->current;
+    unsigned int        vsid   = psched->context[ltid][CTX_VSID_ID];
+    unsigned int        min    = vspace[vsid].task_offset;
+    unsigned int        max    = min + vspace[vsid].tasks;
+    unsigned int        y_size = header->y_size;
+    unsigned int        task_id;
+    unsigned int        save_sr;
+
+    // find the thread in vspace
+    for ( task_id = min ; task_id < max ; task_id++ )
+    {
+        if ( task[task_id].trdid == trdid ) break;
+    }
+
+    if ( (task_id == max) || (task[task_id].dynamic == 0) ) 
+    {
+        _printf("\n[GIET ERROR] in _sys_pthread_join() : "
+                "thread %d is not a pthread\n", trdid );
+        return -1;
+    }
+
+    // get the thread context 
+    unsigned int        cid     = task[task_id].clusterid;
+    unsigned int        tx      = cid / y_size;
+    unsigned int        ty      = cid % y_size;
+    unsigned int        tp      = task[task_id].proclocid;
+    unsigned int        tltid   = task[task_id].ltid;
+    static_scheduler_t* tsched  = (static_scheduler_t*)_schedulers[tx][ty][tp];
+    unsigned int*       pstate  = &tsched->context[tltid][CTX_PTHREAD_ID];
+
+    _it_disable( &save_sr );
+    _spin_lock_acquire( &_futex_lock[vsid] );
+
+    // wait the thread completion
+    while ( *pstate == PTHREAD_RUNNING )
+    {
+        psched->context[ltid][CTX_WAIT_ID] = (unsigned int)pstate;
+        _ctx_set_norun( psched , ltid , NORUN_MASK_WAIT );
+        _spin_lock_release( &_futex_lock[vsid] );
+        _ctx_switch();
+        _spin_lock_acquire( &_futex_lock[vsid] );
+    }
+
+    if ( *pstate != PTHREAD_EXITED ) 
+    {
+        _spin_lock_release( &_futex_lock[vsid] );
+        _it_restore( &save_sr );
+        return -1;
+    }
+
+    // get the returned value and release the slot
+    if ( retval != NULL ) *retval = tsched->context[tltid][CTX_RETVAL_ID];
+    *pstate = PTHREAD_FREE;
+
+    _spin_lock_release( &_futex_lock[vsid] );
+    _it_restore( &save_sr );
+
+    return 0;
+}  // end _sys_pthread_join()
     
 
 //////////////////////////////////////////////////////////////////////////////
@@ -624,8 +1022,7 @@ _printf("\n[GIET DEBUG COPROC] _sys_coproc_run() P[%d,%d,%d] starts coprocessor[
 
         // set NORUN_MASK_COPROC bit
         static_scheduler_t* psched  = (static_scheduler_t*)_schedulers[x][y][p];
-        unsigned int*       ptr     = &psched->context[ltid][CTX_NORUN_ID];
-        _atomic_or( ptr , NORUN_MASK_COPROC );
+        _ctx_set_norun( psched , ltid , NORUN_MASK_COPROC );
 
         // start coprocessor
         _mwr_set_coproc_register( cluster_xy , coproc_reg_index , 1 );
@@ -635,8 +1032,10 @@ _printf("\n[GIET DEBUG COPROC] _sys_coproc_run() P[%d,%d,%d] starts coprocessor[
         "   MODE_DMA_IRQ at cycle %d\n", x , y , p , cx , cy , _get_proctime() );
 #endif
 
-        // deschedule task
+        // deschedule task, and account the blocked time
+        unsigned int date = _get_proctime();
         _ctx_switch(); 
+        psched->context[ltid][CTX_COP_WAIT_ID] += _get_proctime() - date;
 
 #if GIET_DEBUG_COPROC
 _printf("\n[GIET DEBUG COPROC] _sys_coproc_run() P[%d,%d,%d] resume\n"
@@ -2085,8 +2484,7 @@ int _sys_task_exit( char* string )
 
     // set NORUN_MASK_TASK bit (non runnable state)
     static_scheduler_t*  psched  = (static_scheduler_t*)_schedulers[x][y][p];
-    unsigned int*        ptr     = &psched->context[ltid][CTX_NORUN_ID];
-    _atomic_or( ptr , NORUN_MASK_TASK );
+    _ctx_set_norun( psched , ltid , NORUN_MASK_TASK );
 
     // deschedule
     _sys_context_switch();
@@ -2355,6 +2753,123 @@ int _sys_tasks_status()
     return 0;
 }  // end _sys_tasks_status()
 
+/////////////////////////////////////////////////////
+int _sys_tasks_stats( giet_task_stats_t* buffer,
+                      unsigned int       first,
+                      unsigned int       count )
+{
+    mapping_header_t *  header  = (mapping_header_t *)SEG_BOOT_MAPPING_BASE;
+    mapping_task_t *    task    = _get_task_base(header);
+    mapping_vspace_t *  vspace  = _get_vspace_base(header);
+    mapping_cluster_t * cluster = _get_cluster_base(header);
+
+    unsigned int task_id;
+    unsigned int vspace_id;
+    unsigned int n     = 0;
+    unsigned int date  = _get_proctime();
+
+    // scan all vspaces
+    for( vspace_id = 0 ; vspace_id < header->vspaces ; vspace_id++ )
+    {
+        // scan the tasks in vspace, from global index first
+        unsigned int min = vspace[vspace_id].task_offset ;
+        unsigned int max = min + vspace[vspace_id].tasks ;
+        if ( min < first ) min = first;
+
+        for ( task_id = min ; (task_id < max) && (n < count) ; task_id++ )
+        {
+            unsigned int         clusterid = task[task_id].clusterid;
+            unsigned int         p         = task[task_id].proclocid;
+            unsigned int         x         = cluster[clusterid].x;
+            unsigned int         y         = cluster[clusterid].y;
+            unsigned int         ltid      = task[task_id].ltid;
+            static_scheduler_t*  psched    = (static_scheduler_t*)_schedulers[x][y][p];
+            unsigned int*        ctx       = psched->context[ltid];
+
+            _strcpy( buffer[n].vspace , vspace[vspace_id].name );
+            _strcpy( buffer[n].name   , task[task_id].name );
+            buffer[n].x          = x;
+            buffer[n].y          = y;
+            buffer[n].p          = p;
+            buffer[n].norun      = ctx[CTX_NORUN_ID];
+            buffer[n].running    = ( psched->current == ltid );
+            buffer[n].run        = ctx[CTX_RUN_ID];
+            buffer[n].switches   = ctx[CTX_NSWITCH_ID];
+            buffer[n].preempts   = ctx[CTX_NPREEMPT_ID];
+            buffer[n].ioc_wait   = ctx[CTX_IOC_WAIT_ID];
+            buffer[n].cop_wait   = ctx[CTX_COP_WAIT_ID];
+
+            // the current execution slice of a running task is included
+            if ( buffer[n].running ) buffer[n].run += date - ctx[CTX_DATE_ID];
+
+            n++;
+        }
+    }
+    return n;
+}  // end _sys_tasks_stats()
+
+//////////////////////////////////////////////////////////////////////////////
+// This function returns the statistics of the <count> registered kernel
+// locks with the largest cumulated waiting time, in decreasing order.
+// It returns the number of returned entries, or -1 if the locks profiling
+// is not enabled.
+//////////////////////////////////////////////////////////////////////////////
+int _sys_locks_stats( giet_lock_stats_t* buffer,
+                      unsigned int       count )
+{
+
+#if GIET_LOCK_PROFILING
+
+    unsigned char   selected[GIET_LOCK_STATS_MAX];
+    unsigned int    nlocks = _lock_stats_count;
+    unsigned int    n;
+    unsigned int    i;
+
+    if ( nlocks > GIET_LOCK_STATS_MAX ) nlocks = GIET_LOCK_STATS_MAX;
+    if ( count  > nlocks )              count  = nlocks;
+
+    // a slot claimed by a concurrent registration can be not yet written
+    for ( i = 0 ; i < nlocks ; i++ ) selected[i] = (_lock_stats_table[i] == NULL);
+
+    for ( n = 0 ; n < count ; n++ )
+    {
+        // select the not yet selected lock with the largest waiting time
+        unsigned int max   = 0;
+        unsigned int found = 0;
+
+        for ( i = 0 ; i < nlocks ; i++ )
+        {
+            if ( (selected[i] == 0) && 
+                 ((found == 0) || (_lock_stats_table[i]->wait > max)) )
+            {
+                max   = _lock_stats_table[i]->wait;
+                found = i + 1;
+            }
+        }
+
+        if ( found == 0 ) break;
+
+        lock_stats_t* stats = _lock_stats_table[found - 1];
+        selected[found - 1] = 1;
+
+        buffer[n].name[0]   = 0;
+        _strcpy( buffer[n].name , stats->name );
+        buffer[n].vaddr     = (unsigned int)stats;
+        buffer[n].acquires  = stats->acquires;
+        buffer[n].contended = stats->contended;
+        buffer[n].wait      = stats->wait;
+        buffer[n].max_hold  = stats->max_hold;
+    }
+    return n;
+
+#else
+
+    return -1;
+
+#endif
+
+}  // end _sys_locks_stats()
+
 
 
 // Local Variables:
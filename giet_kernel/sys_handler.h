@@ -192,6 +192,49 @@ int _sys_fbf_cma_display( unsigned int buffer_index );
 
 int _sys_fbf_cma_stop();
 
+//////////////////////////////////////////////////////////////////////////////
+//    Futex related syscall handlers
+//////////////////////////////////////////////////////////////////////////////
+// A futex is a 32 bits word in the user space, identified by its virtual
+// address in the vspace of the calling task.
+// - _sys_futex_wait() blocks the calling task (NORUN_MASK_WAIT), if the
+//   futex value is equal to <value>. It returns immediately otherwise.
+// - _sys_futex_wake() makes runable at most <count> tasks of the calling
+//   task vspace that are blocked on the futex, and returns their number.
+//////////////////////////////////////////////////////////////////////////////
+
+int _sys_futex_wait( unsigned int* vaddr,
+                     unsigned int  value );
+
+int _sys_futex_wake( unsigned int* vaddr,
+                     unsigned int  count );
+
+//////////////////////////////////////////////////////////////////////////////
+//    Pthread related syscall handlers
+//////////////////////////////////////////////////////////////////////////////
+// A pthread is executed by a task slot reserved in the mapping ("dynamic"
+// task), that is not active at boot. Its stack is a part of the stack vseg
+// of the task, that can be shared by several dynamic tasks (stack pool).
+// - _sys_pthread_create() activates a free slot on processor [x,y,p], that
+//   executes the <start> function with <entry> and <arg> as arguments. 
+//   The processor coordinates are packed in <xyp> : (x<<24) | (y<<16) | p.
+//   It returns the thread index in vspace, or -1 if no slot available.
+// - _sys_pthread_exit() registers the value returned by the calling pthread,
+//   wakes up the joining task, and deactivates the slot.
+// - _sys_pthread_join() blocks until the pthread identified by <trdid> exits,
+//   copies its returned value to <retval>, and releases the slot.
+//////////////////////////////////////////////////////////////////////////////
+
+int _sys_pthread_create( unsigned int  xyp,
+                         unsigned int  start,
+                         unsigned int  entry,
+                         unsigned int  arg );
+
+int _sys_pthread_exit( unsigned int retval );
+
+int _sys_pthread_join( unsigned int  trdid,
+                       unsigned int* retval );
+
 //////////////////////////////////////////////////////////////////////////////
 //    Miscelaneous syscall handlers
 //////////////////////////////////////////////////////////////////////////////
@@ -239,6 +282,13 @@ int _sys_heap_info( unsigned int* vaddr,
 
 int _sys_tasks_status();
 
+int _sys_tasks_stats( giet_task_stats_t* buffer,
+                      unsigned int       first,
+                      unsigned int       count );
+
+int _sys_locks_stats( giet_lock_stats_t* buffer,
+                      unsigned int       count );
+
 #endif
 
 // Local Variables:
@@ -7,6 +7,7 @@
 
 #include "malloc.h"
 #include "stdio.h"
+#include "stdlib.h"
 #include "giet_config.h"
 
 // Global variables defining the heap descriptors array (one heap per cluster)
@@ -46,6 +47,9 @@ giet_heap_t     heap[X_SIZE][Y_SIZE];
                                             (size <= 0x40000000) ? 30 :\
                                             (size <= 0x80000000) ? 31 :\
                                                                    32
+
+// Flag set in the alloc[] entry of a free block
+#define FREE_BLOCK_FLAG     0x80
 ////////////////////////////////////////
 void display_free_array( unsigned int x,
                          unsigned int y )
@@ -73,6 +77,54 @@ void display_free_array( unsigned int x,
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+// This function returns a pointer on the alloc[] entry of a block.
+////////////////////////////////////////////////////////////////////////////////
+static inline unsigned char* alloc_entry( giet_heap_t* heap,
+                                          unsigned int base )
+{
+    return (unsigned char*)(heap->alloc_base + 
+                            ((base - heap->heap_base) / MIN_BLOCK_SIZE));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// This function pushes a block in free[size_index], and registers it
+// as a free block in the alloc[] array.
+////////////////////////////////////////////////////////////////////////////////
+static void push_free_block( giet_heap_t* heap,
+                             unsigned int base,
+                             unsigned int size_index )
+{
+    unsigned int* block = (unsigned int*)base;
+    unsigned int  first = heap->free[size_index];
+
+    block[0] = first;                       // NEXT
+    block[1] = 0;                           // PREV
+    if ( first ) ((unsigned int*)first)[1] = base;
+    heap->free[size_index] = base;
+
+    *alloc_entry( heap, base ) = FREE_BLOCK_FLAG | size_index;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// This function unlinks a block from free[size_index], and resets its
+// entry in the alloc[] array.
+////////////////////////////////////////////////////////////////////////////////
+static void pop_free_block( giet_heap_t* heap,
+                            unsigned int base,
+                            unsigned int size_index )
+{
+    unsigned int* block = (unsigned int*)base;
+    unsigned int  next  = block[0];
+    unsigned int  prev  = block[1];
+
+    if ( prev ) ((unsigned int*)prev)[0] = next;
+    else        heap->free[size_index]   = next;
+    if ( next ) ((unsigned int*)next)[1] = prev;
+
+    *alloc_entry( heap, base ) = 0;
+}
+
 ////////////////////////////////
 void heap_init( unsigned int x,
                 unsigned int y )
@@ -131,19 +183,6 @@ giet_tty_printf("\n[DEBUG USER_MALLOC] Starting Heap[%d][%d] initialisation /"
     unsigned int*  tab = (unsigned int*)alloc_base;
     for ( word = 0 ; word < (alloc_size>>2) ; word++ )  tab[word] = 0;
  
-    // split the heap into various sizes blocks,
-    // initializes the free[] array and NEXT pointers
-    // base is the block base address
-    unsigned int   base = heap_base;
-    unsigned int*  ptr;
-    for ( index = heap_index-1 ; index >= alloc_index ; index-- )
-    {
-        heap[x][y].free[index] = base;
-        ptr = (unsigned int*)base;
-        *ptr = 0;
-        base = base + (1<<index);
-    }
-
     heap[x][y].init       = HEAP_INITIALIZED;
     heap[x][y].x          = x;
     heap[x][y].y          = y;
@@ -152,6 +191,16 @@ giet_tty_printf("\n[DEBUG USER_MALLOC] Starting Heap[%d][%d] initialisation /"
     heap[x][y].alloc_size = alloc_size;
     heap[x][y].alloc_base = alloc_base;
 
+    // split the heap into various sizes blocks,
+    // initializes the free[] array and the alloc[] array
+    // base is the block base address
+    unsigned int   base = heap_base;
+    for ( index = heap_index-1 ; index >= alloc_index ; index-- )
+    {
+        push_free_block( &heap[x][y], base, index );
+        base = base + (1<<index);
+    }
+
     lock_init( &heap[x][y].lock );
 
 #if GIET_DEBUG_USER_MALLOC
@@ -168,9 +217,7 @@ unsigned int split_block( giet_heap_t* heap,
                           unsigned int requested_index )
 {
     // push the upper half block into free[searched_index-1]
-    unsigned int* new            = (unsigned int*)(vaddr + (1<<(searched_index-1)));
-    *new                         = heap->free[searched_index-1]; 
-    heap->free[searched_index-1] = (unsigned int)new;
+    push_free_block( heap, vaddr + (1<<(searched_index-1)), searched_index-1 );
         
     if ( searched_index == requested_index + 1 )  // terminal case: return lower half block 
     {
@@ -202,8 +249,7 @@ unsigned int get_block( giet_heap_t* heap,
         else                // block found : pop it from free[searched_index] 
         {
             // pop the block from free[searched_index]
-            unsigned int next = *((unsigned int*)vaddr); 
-            heap->free[searched_index] = next;
+            pop_free_block( heap, vaddr, searched_index );
             
             // test if the block must be split
             if ( searched_index == requested_index )  // no split required
@@ -218,10 +264,282 @@ unsigned int get_block( giet_heap_t* heap,
     }
 } // end get_block()
 
-////////////////////////////////////////
-void * remote_malloc( unsigned int size,
-                      unsigned int x,
-                      unsigned int y ) 
+///////////////////////////////////////////
+void update_free_array( giet_heap_t* heap,
+                        unsigned int base,
+                        unsigned int size_index )
+{
+    // This recursive function try to merge the released block 
+    // with the companion block if this companion block is free.
+    // This companion has the same size, and almost the same address
+    // (only one address bit is different)
+    // - If the companion alloc[] entry is not a free block of the same size,
+    //   the released block is pushed in free[size_index].
+    // - If the companion is free, it is unlinked from free[size_index]
+    //   and the merged bloc is pushed in the free[size_index+1].
+
+
+    // compute released block size
+    unsigned int size = 1<<size_index;
+
+    // compute companion block and merged block base addresses
+    unsigned int companion_base;  
+    unsigned int merged_base;  
+
+    if ( (base & size) == 0 )   // the released block is aligned on (2*size)
+    {
+        companion_base  = base + size;
+        merged_base     = base;
+    }
+    else
+    {
+        companion_base  = base - size;
+        merged_base     = base - size;
+    }
+
+    // check the companion state in the alloc[] array
+    if ( (companion_base >= heap->heap_base) &&
+         (companion_base < (heap->heap_base + heap->heap_size)) &&
+         (*alloc_entry( heap, companion_base ) == (FREE_BLOCK_FLAG | size_index)) )
+    {
+        // unlink the companion block from free[size_index]
+        pop_free_block( heap, companion_base, size_index );
+
+        // call the update_free() function for free[size_index+1]
+        update_free_array( heap, merged_base , size_index+1 );
+    }
+    else               // Companion not free => push in free[size_index]  
+    {
+        push_free_block( heap, base, size_index );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// This function allocates a block of size (1 << index) in the heap, and
+// registers it in the alloc[] array. The heap lock must be taken by the caller.
+// It returns 0 if no block is available.
+////////////////////////////////////////////////////////////////////////////////
+static unsigned int heap_alloc_block( giet_heap_t* heap,
+                                      unsigned int index )
+{
+    // call the recursive function get_block
+    unsigned int base = get_block( heap, index, index );
+
+    if ( base == 0 ) return 0;
+
+    // compute pointer in alloc[] array
+    unsigned offset    = (base - heap->heap_base) / MIN_BLOCK_SIZE;
+    unsigned char* ptr = (unsigned char*)(heap->alloc_base + offset);
+
+    // check the alloc[] array
+    if ( *ptr != 0 )
+    {
+        lock_release( &heap->lock );
+        giet_exit("\nERROR in remote_malloc() : block already allocated ???\n");
+    }
+
+    // update alloc_array
+    *ptr = index;
+
+    return base;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// This function releases a block of size (1 << index) in the heap, and
+// resets its entry in the alloc[] array. The heap lock must be taken 
+// by the caller.
+////////////////////////////////////////////////////////////////////////////////
+static void heap_free_block( giet_heap_t* heap,
+                             unsigned int base,
+                             unsigned int index )
+{
+    unsigned offset    = (base - heap->heap_base) / MIN_BLOCK_SIZE;
+    unsigned char* ptr = (unsigned char*)(heap->alloc_base + offset);
+
+    *ptr = 0;
+
+    // call the recursive function update_free_array() 
+    update_free_array( heap, base, index ); 
+}
+
+#if GIET_USER_MALLOC_CACHE
+
+// Global variable defining the per-thread caches array (indexed by thread)
+malloc_cache_t* malloc_cache[MALLOC_CACHE_THREADS];
+
+////////////////////////////////////////////////////////////////////////////////
+// This function returns the cache of the calling thread, and allocates it
+// in the local heap at the first call. It returns NULL if the thread
+// index is too large, or if the local heap is not initialised.
+////////////////////////////////////////////////////////////////////////////////
+static malloc_cache_t* malloc_cache_get()
+{
+    unsigned int     trdid = giet_thread_id();
+    malloc_cache_t*  cache;
+    unsigned int     x;
+    unsigned int     y;
+    unsigned int     lpid;
+    unsigned int     c;
+
+    if ( trdid >= MALLOC_CACHE_THREADS ) return NULL;
+
+    cache = malloc_cache[trdid];
+
+    if ( cache == NULL )
+    {
+        giet_proc_xyp( &x, &y, &lpid );
+
+        if ( heap[x][y].init != HEAP_INITIALIZED ) return NULL;
+
+        lock_acquire( &heap[x][y].lock );
+        cache = (malloc_cache_t*)heap_alloc_block( &heap[x][y], 
+                                                   GET_SIZE_INDEX( MIN_BLOCK_SIZE ) );
+        lock_release( &heap[x][y].lock );
+
+        if ( cache == NULL ) return NULL;
+
+        cache->x = x;
+        cache->y = y;
+        for ( c = 0 ; c < MALLOC_CACHE_CLASSES ; c++ )
+        {
+            cache->count[c] = 0;
+            cache->first[c] = 0;
+        }
+
+        malloc_cache[trdid] = cache;
+
+#if GIET_DEBUG_USER_MALLOC
+giet_tty_printf("\n[DEBUG USER_MALLOC] thread %d allocates cache %x in heap[%d][%d]\n",
+                trdid, (unsigned int)cache, x, y );
+#endif
+
+    }
+    return cache;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// This function moves MALLOC_CACHE_BATCH blocks (or all blocks if the
+// <all> argument is non zero) from the cache to the home heap.
+////////////////////////////////////////////////////////////////////////////////
+static void malloc_cache_drain( malloc_cache_t* cache,
+                                unsigned int    index,
+                                unsigned int    all )
+{
+    giet_heap_t*  h = &heap[cache->x][cache->y];
+    unsigned int  c = index - MALLOC_CACHE_MIN_INDEX;
+    unsigned int  n = ( all ) ? cache->count[c] : MALLOC_CACHE_BATCH;
+    unsigned int  base;
+
+    lock_acquire( &h->lock );
+
+    while ( n && cache->count[c] )
+    {
+        base            = cache->first[c];
+        cache->first[c] = *(unsigned int*)base;
+        cache->count[c] = cache->count[c] - 1;
+        heap_free_block( h, base, index );
+        n--;
+    }
+
+    lock_release( &h->lock );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// This function moves up to MALLOC_CACHE_BATCH blocks from the home heap
+// to the cache. If the heap is exhausted, the other classes of the cache
+// are drained, and the allocation is retried.
+////////////////////////////////////////////////////////////////////////////////
+static void malloc_cache_refill( malloc_cache_t* cache,
+                                 unsigned int    index )
+{
+    giet_heap_t*  h = &heap[cache->x][cache->y];
+    unsigned int  c = index - MALLOC_CACHE_MIN_INDEX;
+    unsigned int  n;
+    unsigned int  i;
+    unsigned int  base;
+
+    lock_acquire( &h->lock );
+
+    for ( n = 0 ; n < MALLOC_CACHE_BATCH ; n++ )
+    {
+        base = heap_alloc_block( h, index );
+        if ( base == 0 ) break;
+
+        *(unsigned int*)base = cache->first[c];
+        cache->first[c]      = base;
+        cache->count[c]      = cache->count[c] + 1;
+    }
+
+    lock_release( &h->lock );
+
+    if ( cache->count[c] == 0 )
+    {
+        for ( i = MALLOC_CACHE_MIN_INDEX ; i <= MALLOC_CACHE_MAX_INDEX ; i++ )
+        {
+            if ( i != index ) malloc_cache_drain( cache, i, 1 );
+        }
+
+        lock_acquire( &h->lock );
+        base = heap_alloc_block( h, index );
+        lock_release( &h->lock );
+
+        if ( base )
+        {
+            *(unsigned int*)base = 0;
+            cache->first[c]      = base;
+            cache->count[c]      = 1;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// This function allocates a block of size (1 << index) from the cache.
+// It returns 0 if the home heap is exhausted.
+////////////////////////////////////////////////////////////////////////////////
+static unsigned int malloc_cache_pop( malloc_cache_t* cache,
+                                      unsigned int    index )
+{
+    unsigned int  c = index - MALLOC_CACHE_MIN_INDEX;
+    unsigned int  base;
+
+    if ( cache->count[c] == 0 ) malloc_cache_refill( cache, index );
+
+    if ( cache->count[c] == 0 ) return 0;
+
+    base            = cache->first[c];
+    cache->first[c] = *(unsigned int*)base;
+    cache->count[c] = cache->count[c] - 1;
+
+    return base;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// This function releases a block of size (1 << index) in the cache.
+////////////////////////////////////////////////////////////////////////////////
+static void malloc_cache_push( malloc_cache_t* cache,
+                               unsigned int    base,
+                               unsigned int    index )
+{
+    unsigned int  c = index - MALLOC_CACHE_MIN_INDEX;
+
+    *(unsigned int*)base = cache->first[c];
+    cache->first[c]      = base;
+    cache->count[c]      = cache->count[c] + 1;
+
+    if ( cache->count[c] > MALLOC_CACHE_DEPTH ) malloc_cache_drain( cache, index, 0 );
+}
+
+#endif  // GIET_USER_MALLOC_CACHE
+
+////////////////////////////////////////////////////////////////////////////////
+// This function implements remote_malloc() and malloc(). The <cache> argument
+// is the calling thread cache, already obtained by the caller, or NULL.
+// It is only used for small blocks in the cache home heap.
+////////////////////////////////////////////////////////////////////////////////
+static void* heap_malloc( unsigned int     size,
+                          unsigned int     x,
+                          unsigned int     y,
+                          malloc_cache_t*  cache ) 
 {
 
 #if GIET_DEBUG_USER_MALLOC
@@ -255,13 +573,30 @@ giet_tty_printf("\n[DEBUG USER_MALLOC] request for Heap[%d][%d] / size = %x\n",
     // compute requested_index for the free[] array
     unsigned int requested_index = GET_SIZE_INDEX( size );
 
+    unsigned int base;
+
+#if GIET_USER_MALLOC_CACHE
+
+    // small block in the home heap : use the calling thread cache
+    if ( (requested_index <= MALLOC_CACHE_MAX_INDEX) &&
+         (cache != NULL) && (cache->x == x) && (cache->y == y) )
+    {
+        base = malloc_cache_pop( cache, requested_index );
+
+        if ( base == 0 )
+        {
+            giet_exit("\nERROR in remote_malloc() : no more space\n");
+        }
+        return (void*)base;
+    }
+
+#endif
+
     // take the lock protecting access to heap[x][y]
     lock_acquire( &heap[x][y].lock );
 
-    // call the recursive function get_block
-    unsigned int base = get_block( &heap[x][y], 
-                                   requested_index, 
-                                   requested_index );
+    // get a block and register it in the alloc[] array
+    base = heap_alloc_block( &heap[x][y], requested_index );
 
     // check block found
     if ( base == 0 )
@@ -270,20 +605,6 @@ giet_tty_printf("\n[DEBUG USER_MALLOC] request for Heap[%d][%d] / size = %x\n",
         giet_exit("\nERROR in remote_malloc() : no more space\n");
     }
 
-    // compute pointer in alloc[] array
-    unsigned offset    = (base - heap[x][y].heap_base) / MIN_BLOCK_SIZE;
-    unsigned char* ptr = (unsigned char*)(heap[x][y].alloc_base + offset);
-
-    // check the alloc[] array
-    if ( *ptr != 0 )
-    {
-        lock_release( &heap[x][y].lock );
-        giet_exit("\nERROR in remote_malloc() : block already allocated ???\n");
-    }
-
-    // update alloc_array
-    *ptr = requested_index;
-
     // release the lock
     lock_release( &heap[x][y].lock );
  
@@ -295,6 +616,27 @@ display_free_array(x,y);
 
     return (void*)base;
 
+} // end heap_malloc()
+
+////////////////////////////////////////
+void * remote_malloc( unsigned int size,
+                      unsigned int x,
+                      unsigned int y ) 
+{
+    malloc_cache_t* cache = NULL;
+
+#if GIET_USER_MALLOC_CACHE
+
+    // the thread cache is only looked up for small blocks
+    if ( (size != 0) && (size <= (1 << MALLOC_CACHE_MAX_INDEX)) )
+    {
+        cache = malloc_cache_get();
+    }
+
+#endif
+
+    return heap_malloc( size, x, y, cache );
+
 } // end remote_malloc()
 
 
@@ -305,78 +647,61 @@ void * malloc( unsigned int size )
     unsigned int    x;
     unsigned int    y;
     unsigned int    lpid;
+
+#if GIET_USER_MALLOC_CACHE
+
+    // the home cluster is registered in the thread cache
+    malloc_cache_t* cache = malloc_cache_get();
+
+    if ( cache != NULL ) return heap_malloc( size, cache->x, cache->y, cache );
+
+#endif
+
     giet_proc_xyp( &x, &y, &lpid );
 
-    return remote_malloc( size, x, y );
+    return heap_malloc( size, x, y, NULL );
 } 
 
-///////////////////////////////////////////
-void update_free_array( giet_heap_t* heap,
-                        unsigned int base,
-                        unsigned int size_index )
+//////////////////////
+void free( void* ptr )
 {
-    // This recursive function try to merge the released block 
-    // with the companion block if this companion block is free.
-    // This companion has the same size, and almost the same address
-    // (only one address bit is different)
-    // - If the companion is not in free[size_index],
-    //   the released block is pushed in free[size_index].
-    // - If the companion is found, it is evicted from free[size_index]
-    //   and the merged bloc is pushed in the free[size_index+1].
-
+    unsigned int base = (unsigned int)ptr;
 
-    // compute released block size
-    unsigned int size = 1<<size_index;
+#if GIET_USER_MALLOC_CACHE
 
-    // compute companion block and merged block base addresses
-    unsigned int companion_base;  
-    unsigned int merged_base;  
+    // small block in the home heap : use the calling thread cache
+    malloc_cache_t* cache = malloc_cache_get();
 
-    if ( (base & size) == 0 )   // the released block is aligned on (2*size)
-    {
-        companion_base  = base + size;
-        merged_base     = base;
-    }
-    else
+    if ( cache != NULL )
     {
-        companion_base  = base - size;
-        merged_base     = base - size;
-    }
+        giet_heap_t* h = &heap[cache->x][cache->y];
 
-    // scan all blocks in free[size_index]
-    // the iter & prev variables are actually addresses
-    unsigned int  found = 0;
-    unsigned int  iter  = heap->free[size_index];
-    unsigned int  prev  = (unsigned int)&heap->free[size_index];
-    while ( iter ) 
-    {
-        if ( iter == companion_base ) 
+        if ( (base >= h->heap_base) && (base < (h->heap_base + h->heap_size)) )
         {
-            found = 1;
-            break;
-        }
-        prev = iter;
-        iter = *(unsigned int*)iter;
-    }
+            // the alloc[] entry of an allocated block is not modified 
+            // by the other threads : it can be read without lock
+            unsigned int   index      = (base - h->heap_base) / MIN_BLOCK_SIZE;
+            unsigned char* pchar      = (unsigned char*)(h->alloc_base + index);
+            unsigned int   size_index = (unsigned int)*pchar;
 
-    if ( found == 0 )  // Companion not found => push in free[size_index]  
-    {
-        *(unsigned int*)base   = heap->free[size_index];
-        heap->free[size_index] = base;
+            if ( (size_index == 0) || (size_index & FREE_BLOCK_FLAG) )
+            {
+                giet_exit("\nERROR in free() : released block not allocated ???\n");
+            }
+            if ( base % (1 << size_index) )
+            {
+                giet_exit("\nERROR in free() : released block not aligned\n");
+            }
+            if ( size_index <= MALLOC_CACHE_MAX_INDEX )
+            {
+                malloc_cache_push( cache, base, size_index );
+                return;
+            }
+        }
     }
-    else               // Companion found : merge
-    {
-        // evict the searched block from free[size_index]
-        *(unsigned int*)prev = *(unsigned int*)iter;
 
-        // call the update_free() function for free[size_index+1]
-        update_free_array( heap, merged_base , size_index+1 );
-    }
-}
+#endif
 
-//////////////////////
-void free( void* ptr )
-{
     // get the cluster coordinate from ptr value
     unsigned int x;
     unsigned int y;
@@ -388,7 +713,6 @@ giet_tty_printf("\n[DEBUG USER_MALLOC] Free for vaddr = %x / x = %d / y = %d\n",
 #endif
 
     // check ptr value
-    unsigned int base = (unsigned int)ptr;
     if ( (base < heap[x][y].heap_base) || 
          (base >= (heap[x][y].heap_base + heap[x][y].heap_size)) )
     {
@@ -406,7 +730,7 @@ giet_tty_printf("\n[DEBUG USER_MALLOC] Free for vaddr = %x / x = %d / y = %d\n",
     unsigned int   size_index = (unsigned int)*pchar;
 
     // check block allocation
-    if ( size_index == 0 )
+    if ( (size_index == 0) || (size_index & FREE_BLOCK_FLAG) )
     {
         lock_release( &heap[x][y].lock );
         giet_exit("\nERROR in free() : released block not allocated ???\n");
@@ -415,11 +739,12 @@ giet_tty_printf("\n[DEBUG USER_MALLOC] Free for vaddr = %x / x = %d / y = %d\n",
     // check released block alignment
     if ( base % (1 << size_index) )
     {
+        lock_release( &heap[x][y].lock );
         giet_exit("\nERROR in free() : released block not aligned\n");
     }
 
-    // call the recursive function update_free_array() 
-    update_free_array( &heap[x][y], base, size_index ); 
+    // reset the alloc[] entry and update the free[] array
+    heap_free_block( &heap[x][y], base, size_index ); 
 
     // release the lock
     lock_release( &heap[x][y].lock );
@@ -430,6 +755,341 @@ display_free_array(x,y);
 
 } // end free()
 
+////////////////////////////////////////////////////////////////////////////////
+// This function returns the heap containing an allocated block, and checks
+// that the block is registered as allocated in the alloc[] array.
+// The <caller> argument is only used in the error messages.
+////////////////////////////////////////////////////////////////////////////////
+static giet_heap_t* heap_from_block( void* ptr,
+                                     char*  caller )
+{
+    unsigned int base = (unsigned int)ptr;
+    unsigned int x;
+    unsigned int y;
+
+    giet_get_xy( ptr, &x, &y );
+
+    giet_heap_t* h = &heap[x][y];
+
+    if ( (h->init != HEAP_INITIALIZED) ||
+         (base < h->heap_base) || 
+         (base >= (h->heap_base + h->heap_size)) )
+    {
+        giet_tty_printf("\nERROR in %s() : illegal pointer %x\n", caller, base );
+        giet_exit("illegal pointer");
+    }
+
+    // the alloc[] entry of an allocated block is not modified 
+    // by the other threads : it can be read without lock
+    unsigned int size_index = *alloc_entry( h, base );
+
+    if ( (size_index == 0) || (size_index & FREE_BLOCK_FLAG) ||
+         (base % (1 << size_index)) )
+    {
+        giet_tty_printf("\nERROR in %s() : block %x not allocated\n", caller, base );
+        giet_exit("block not allocated");
+    }
+
+    return h;
+}
+
+////////////////////////////////////////////////////////
+void * calloc( unsigned int count,
+               unsigned int size )
+{
+    // zero size request
+    if ( (count == 0) || (size == 0) ) return NULL;
+
+    unsigned int  bytes = count * size;
+
+    // check count * size overflow
+    if ( (bytes / count) != size )
+    {
+        giet_exit("\nERROR in calloc() : requested size overflow\n");
+    }
+
+    unsigned int* ptr   = (unsigned int*)malloc( bytes );
+    unsigned int  words = (bytes + 3) >> 2;
+    unsigned int  w;
+
+    for ( w = 0 ; w < words ; w++ ) ptr[w] = 0;
+
+    return ptr;
+}
+
+////////////////////////////////////////////////////////
+void * realloc( void*        ptr,
+                unsigned int size )
+{
+    // zero size request : release the block if any
+    if ( size == 0 )
+    {
+        if ( ptr != NULL ) free( ptr );
+        return NULL;
+    }
+
+    if ( ptr == NULL ) return malloc( size );
+
+    unsigned int   base = (unsigned int)ptr;
+    giet_heap_t*   h    = heap_from_block( ptr, "realloc" );
+
+    // normalize size
+    if ( size < MIN_BLOCK_SIZE ) size = MIN_BLOCK_SIZE;
+
+    unsigned int   new_index = GET_SIZE_INDEX( size );
+    unsigned int   i;
+
+    lock_acquire( &h->lock );
+
+    unsigned char* entry      = alloc_entry( h, base );
+    unsigned int   size_index = *entry;
+
+    if ( new_index < size_index )    // shrink : release the upper halves
+    {
+        for ( i = size_index - 1 ; i >= new_index ; i-- )
+        {
+            update_free_array( h, base + (1 << i), i );
+        }
+        *entry = new_index;
+    }
+    else if ( new_index > size_index )  // grow in place if all companions are free
+    {
+        for ( i = size_index ; i < new_index ; i++ )
+        {
+            unsigned int companion = base + (1 << i);
+
+            if ( (base & (1 << i)) ||
+                 (companion >= (h->heap_base + h->heap_size)) ||
+                 (*alloc_entry( h, companion ) != (FREE_BLOCK_FLAG | i)) ) break;
+        }
+
+        if ( i < new_index )          // allocate a new block and copy
+        {
+            lock_release( &h->lock );
+
+            void* new = remote_malloc( size, h->x, h->y );
+            memcpy( new, ptr, 1 << size_index );
+            free( ptr );
+
+#if GIET_DEBUG_USER_MALLOC
+giet_tty_printf("\n[DEBUG USER_MALLOC] realloc() moves block %x to %x / size = %x\n",
+                base, (unsigned int)new, size );
+#endif
+
+            return new;
+        }
+
+        for ( i = size_index ; i < new_index ; i++ )
+        {
+            pop_free_block( h, base + (1 << i), i );
+        }
+        *entry = new_index;
+    }
+
+    lock_release( &h->lock );
+
+#if GIET_DEBUG_USER_MALLOC
+giet_tty_printf("\n[DEBUG USER_MALLOC] realloc() resizes block %x in place / size = %x\n",
+                base, size );
+display_free_array( h->x, h->y );
+#endif
+
+    return ptr;
+}
+
+////////////////////////////////////////////////////////
+void * memalign( unsigned int alignment,
+                 unsigned int size )
+{
+    if ( (alignment == 0) || (alignment & (alignment - 1)) )
+    {
+        giet_exit("\nERROR in memalign() : alignment must be a power of 2\n");
+    }
+
+    // all blocks are aligned on their size
+    if ( size < alignment ) size = alignment;
+
+    return malloc( size );
+}
+
+////////////////////////////////////////////////////////
+unsigned int malloc_usable_size( void* ptr )
+{
+    if ( ptr == NULL ) return 0;
+
+    giet_heap_t* h = heap_from_block( ptr, "malloc_usable_size" );
+
+    return 1 << *alloc_entry( h, (unsigned int)ptr );
+}
+
+///////////////////////////////////////////////////////////
+interleaved_t* interleaved_malloc( unsigned int size,
+                                   unsigned int stripe )
+{
+    unsigned int x;
+    unsigned int y;
+
+    if ( stripe == 0 ) stripe = INTERLEAVE_STRIPE;
+
+    if ( (size == 0) || (stripe < 4) || (stripe & (stripe - 1)) )
+    {
+        giet_exit("\nERROR in interleaved_malloc() : illegal size or stripe\n");
+    }
+
+    interleaved_t* array = (interleaved_t*)malloc( sizeof(interleaved_t) );
+
+    // count the initialised heaps
+    array->nclusters = 0;
+    for ( x = 0 ; x < X_SIZE ; x++ )
+    {
+        for ( y = 0 ; y < Y_SIZE ; y++ )
+        {
+            if ( heap[x][y].init == HEAP_INITIALIZED ) array->nclusters++;
+        }
+    }
+
+    array->size         = size;
+    array->stripe       = stripe;
+    array->stripe_index = GET_SIZE_INDEX( stripe );
+
+    // number of stripes per heap
+    unsigned int nstripes = (size + stripe - 1) >> array->stripe_index;
+    unsigned int rows     = (nstripes + array->nclusters - 1) / array->nclusters;
+    unsigned int c        = 0;
+
+    for ( x = 0 ; x < X_SIZE ; x++ )
+    {
+        for ( y = 0 ; y < Y_SIZE ; y++ )
+        {
+            if ( heap[x][y].init == HEAP_INITIALIZED )
+            {
+                array->chunk[c] = remote_malloc( rows << array->stripe_index, x, y );
+                c++;
+            }
+        }
+    }
+
+#if GIET_DEBUG_USER_MALLOC
+giet_tty_printf("\n[DEBUG USER_MALLOC] interleaved_malloc() : size = %x / stripe = %x"
+                " / %d heaps / %d stripes per heap\n", 
+                size, stripe, array->nclusters, rows );
+#endif
+
+    return array;
+}
+
+///////////////////////////////////////////////
+void* interleaved_ptr( interleaved_t* array,
+                       unsigned int   offset )
+{
+    unsigned int k   = offset >> array->stripe_index;   // stripe index
+    unsigned int c   = k % array->nclusters;            // heap index
+    unsigned int row = k / array->nclusters;            // stripe index in heap
+
+    return (char*)array->chunk[c] + (row << array->stripe_index) 
+                                  + (offset & (array->stripe - 1));
+}
+
+//////////////////////////////////////////////////
+void* interleaved_stripe( interleaved_t* array,
+                          unsigned int   index )
+{
+    unsigned int c   = index % array->nclusters;
+    unsigned int row = index / array->nclusters;
+
+    return (char*)array->chunk[c] + (row << array->stripe_index);
+}
+
+///////////////////////////////////////////////
+void interleaved_free( interleaved_t* array )
+{
+    unsigned int c;
+
+    for ( c = 0 ; c < array->nclusters ; c++ ) free( array->chunk[c] );
+
+    free( array );
+}
+
+///////////////////////////////////////////////
+replicated_t* replicated_malloc( unsigned int size )
+{
+    unsigned int x;
+    unsigned int y;
+
+    replicated_t* rep = (replicated_t*)malloc( sizeof(replicated_t) );
+
+    rep->size  = size;
+    rep->first = NULL;
+
+    for ( x = 0 ; x < X_SIZE ; x++ )
+    {
+        for ( y = 0 ; y < Y_SIZE ; y++ )
+        {
+            if ( heap[x][y].init == HEAP_INITIALIZED )
+            {
+                rep->copy[x][y] = remote_malloc( size, x, y );
+                if ( rep->first == NULL ) rep->first = rep->copy[x][y];
+            }
+            else
+            {
+                rep->copy[x][y] = NULL;
+            }
+        }
+    }
+
+#if GIET_DEBUG_USER_MALLOC
+giet_tty_printf("\n[DEBUG USER_MALLOC] replicated_malloc() : size = %x\n", size );
+#endif
+
+    return rep;
+}
+
+/////////////////////////////////////////
+void replicated_copy( replicated_t* rep,
+                      void*         src )
+{
+    unsigned int x;
+    unsigned int y;
+
+    for ( x = 0 ; x < X_SIZE ; x++ )
+    {
+        for ( y = 0 ; y < Y_SIZE ; y++ )
+        {
+            if ( rep->copy[x][y] ) memcpy( rep->copy[x][y], src, rep->size );
+        }
+    }
+}
+
+//////////////////////////////////////////
+void* replicated_local( replicated_t* rep )
+{
+    unsigned int x;
+    unsigned int y;
+    unsigned int lpid;
+
+    giet_proc_xyp( &x, &y, &lpid );
+
+    if ( rep->copy[x][y] ) return rep->copy[x][y];
+    else                   return rep->first;
+}
+
+////////////////////////////////////////
+void replicated_free( replicated_t* rep )
+{
+    unsigned int x;
+    unsigned int y;
+
+    for ( x = 0 ; x < X_SIZE ; x++ )
+    {
+        for ( y = 0 ; y < Y_SIZE ; y++ )
+        {
+            if ( rep->copy[x][y] ) free( rep->copy[x][y] );
+        }
+    }
+
+    free( rep );
+}
+
 // Local Variables:
 // tab-width: 4
 // c-basic-offset: 4
@@ -15,8 +15,9 @@
 // - All free blocks are aligned.
 // - They are pre-classed in NB_SIZES linked lists, where all blocks in a
 //   given list have the same size. 
-// - The NEXT pointer implementing those linked lists is written 
-//   in the 4 first bytes of the block itself, using the unsigned int type.
+// - Those lists are doubly linked: the NEXT pointer is written in the
+//   4 first bytes of the block itself, and the PREV pointer in the 4 next
+//   bytes (PREV is 0 for the first block of a list).
 // - The pointers on the first free block for each size are stored in an
 //   array of pointers free[32] in the heap(x,y) descriptor.
 ////////////////////////////////////////////////////////////////////////////////
@@ -49,10 +50,58 @@
 //   of allocated block is : heap_size / 128.
 // - For each allocated block, the value registered in the alloc[] array
 //   is log2( size_of_allocated_block ).
+// - For each free block, the value registered in the alloc[] array is
+//   log2( size_of_free_block ) | FREE_BLOCK_FLAG. The other entries are 0.
 // - The index in this array is computed from the allocated block base address:
 //      index = (block_base - heap_base) / MIN_BLOCK_SIZE
 // - The alloc[] array is stored at the end of heap segment. This consume
 //   (1 / MIN_BLOCK_SIZE) of the total heap storage capacity.
+// - The released block is merged with its companion block when the
+//   companion alloc[] entry shows a free block of the same size: the
+//   companion is unlinked from its free list in constant time, and the
+//   cost of free() does not depend on the free lists length.
+////////////////////////////////////////////////////////////////////////////////
+// Other allocation functions:
+// - calloc() allocates a block with malloc(), and resets it word per word.
+// - calloc() and realloc() return NULL for a zero size request.
+// - realloc() uses the alloc[] array to get the current block size.
+//   A block is shrunk in place, and the released upper halves are pushed
+//   in the free[] lists. A block is grown in place if it is the lower half
+//   of each larger block, and if all the upper halves are free blocks.
+//   Otherwise a new block is allocated in the same heap, and the data
+//   are copied.
+// - memalign() returns a block of size max( size , alignment ), that is
+//   aligned on its size.
+// - malloc_usable_size() returns the actual size of an allocated block.
+////////////////////////////////////////////////////////////////////////////////
+// NUMA allocation policies:
+// - interleaved_malloc() distributes a large buffer on all initialised
+//   heaps: the buffer is cut in stripes (a power of 2 number of bytes,
+//   INTERLEAVE_STRIPE by default), and the stripe of index k is stored
+//   in the heap of index (k % nclusters). The buffer is described by an
+//   interleaved_t descriptor, and must be accessed with the
+//   interleaved_ptr() or interleaved_stripe() functions, because the
+//   stripes are not contiguous in the virtual space.
+// - replicated_malloc() allocates one copy of a buffer in each initialised
+//   heap. The copies are initialised with replicated_copy(), and each
+//   thread reads the copy in its own cluster, returned by replicated_local().
+// - The descriptors are allocated with malloc() in the local heap.
+////////////////////////////////////////////////////////////////////////////////
+// Per-thread caches:
+// - When the GIET_USER_MALLOC_CACHE parameter is non zero, each thread
+//   (identified by giet_thread_id()) owns a cache of free blocks, for the
+//   small sizes (MIN_BLOCK_SIZE to 1 << MALLOC_CACHE_MAX_INDEX bytes).
+//   The cache is allocated at the first malloc() or free() in the heap
+//   of the cluster running the thread, called the home heap.
+// - The cached blocks are registered as allocated in the alloc[] array.
+//   A malloc() in the home heap pops a block from the cache, and a free()
+//   of a block of the home heap pushes the block in the cache, without
+//   taking the heap lock.
+// - An empty cache is refilled with MALLOC_CACHE_BATCH blocks, and a full
+//   cache (MALLOC_CACHE_DEPTH blocks) is drained by MALLOC_CACHE_BATCH
+//   blocks, with one single lock acquisition.
+// - Requests for a remote heap, for larger blocks, or from threads with a
+//   thread index larger or equal to MALLOC_CACHE_THREADS, use the heap lock.
 ////////////////////////////////////////////////////////////////////////////////
 
 #ifndef _MALLOC_H_
@@ -69,6 +118,23 @@
 
 #define MIN_BLOCK_SIZE      0x80
 
+////////////////////////////////////////////////////////////////////////////////
+//  per-thread caches parameters
+////////////////////////////////////////////////////////////////////////////////
+
+#define MALLOC_CACHE_THREADS     (X_SIZE * Y_SIZE * NB_PROCS_MAX)
+#define MALLOC_CACHE_MIN_INDEX   7        // log2( MIN_BLOCK_SIZE )
+#define MALLOC_CACHE_MAX_INDEX   10       // largest cached block : 1 Kbytes
+#define MALLOC_CACHE_CLASSES     (MALLOC_CACHE_MAX_INDEX - MALLOC_CACHE_MIN_INDEX + 1)
+#define MALLOC_CACHE_DEPTH       8        // max number of blocks per class
+#define MALLOC_CACHE_BATCH       4        // number of blocks per refill / drain
+
+////////////////////////////////////////////////////////////////////////////////
+//  NUMA allocation policies parameters
+////////////////////////////////////////////////////////////////////////////////
+
+#define INTERLEAVE_STRIPE        0x1000   // default stripe size : one page
+
 ////////////////////////////////////////////////////////////////////////////////
 // heap(x,y) descriptor (one per cluster)
 ////////////////////////////////////////////////////////////////////////////////
@@ -87,6 +153,42 @@ typedef struct giet_heap_s
                                     // (address of first block of a given size)
 } giet_heap_t;
 
+////////////////////////////////////////////////////////////////////////////////
+// per-thread cache of free blocks (one per thread)
+////////////////////////////////////////////////////////////////////////////////
+
+typedef struct malloc_cache_s
+{
+    unsigned int   x;                              // home cluster X coordinate
+    unsigned int   y;                              // home cluster Y coordinate
+    unsigned int   count[MALLOC_CACHE_CLASSES];    // number of cached blocks
+    unsigned int   first[MALLOC_CACHE_CLASSES];    // first cached block base
+} malloc_cache_t;
+
+////////////////////////////////////////////////////////////////////////////////
+// interleaved buffer descriptor
+////////////////////////////////////////////////////////////////////////////////
+
+typedef struct interleaved_s
+{
+    unsigned int   size;                        // buffer size (bytes)
+    unsigned int   stripe;                      // stripe size (bytes)
+    unsigned int   stripe_index;                // log2( stripe )
+    unsigned int   nclusters;                   // number of heaps used
+    void*          chunk[X_SIZE * Y_SIZE];      // stripes base in each heap
+} interleaved_t;
+
+////////////////////////////////////////////////////////////////////////////////
+// replicated buffer descriptor
+////////////////////////////////////////////////////////////////////////////////
+
+typedef struct replicated_s
+{
+    unsigned int   size;                        // buffer size (bytes)
+    void*          copy[X_SIZE][Y_SIZE];        // copy base (NULL if no heap)
+    void*          first;                       // first allocated copy
+} replicated_t;
+
 ///////// user functions /////////////////
 
 extern void heap_init( unsigned int x,
@@ -100,6 +202,37 @@ extern void* remote_malloc( unsigned int size,
 
 extern void free(void * ptr);
 
+extern void* calloc( unsigned int count,
+                     unsigned int size );
+
+extern void* realloc( void*        ptr,
+                      unsigned int size );
+
+extern void* memalign( unsigned int alignment,
+                       unsigned int size );
+
+extern unsigned int malloc_usable_size( void* ptr );
+
+extern interleaved_t* interleaved_malloc( unsigned int size,
+                                          unsigned int stripe );
+
+extern void* interleaved_ptr( interleaved_t* array,
+                              unsigned int   offset );
+
+extern void* interleaved_stripe( interleaved_t* array,
+                                 unsigned int   index );
+
+extern void interleaved_free( interleaved_t* array );
+
+extern replicated_t* replicated_malloc( unsigned int size );
+
+extern void replicated_copy( replicated_t* rep,
+                             void*         src );
+
+extern void* replicated_local( replicated_t* rep );
+
+extern void replicated_free( replicated_t* rep );
+
 #endif
 
 // Local Variables:
@@ -33,8 +33,22 @@ giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] initialises fifo %x / "
     mwmr->width = width;
     mwmr->depth = width * nitems;
     mwmr->data  = buffer;
+    mwmr->waiters = 0;
+    mwmr->wpending = 0;
+    mwmr->rpending = 0;
 
-    lock_init( &mwmr->lock );
+    cfg_lock_init( &mwmr->lock );
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// This function wakes up the tasks blocked on the channel status if any.
+// It must be called each time the channel status is modified.
+//////////////////////////////////////////////////////////////////////////////
+static inline void mwmr_wake( mwmr_channel_t* mwmr )
+{
+    asm volatile ("sync" ::: "memory");
+
+    if ( mwmr->waiters ) giet_futex_wake( &mwmr->sts, 0xFFFFFFFF );
 }
 
 
@@ -65,7 +79,7 @@ giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] enters nb_mwmr_write()"
     if (items == 0) return 0;
 
     // get the lock
-    lock_acquire( &mwmr->lock );
+    cfg_lock_acquire( &mwmr->lock );
 
     // access fifo status
     depth  = mwmr->depth;
@@ -75,6 +89,12 @@ giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] enters nb_mwmr_write()"
     spaces = depth - sts;
     nwords = width * items;
 
+    if (mwmr->wpending) // reserved spans not committed : release lock and return
+    {
+        cfg_lock_release( &mwmr->lock );
+        return 0;
+    }
+
     if (spaces >= nwords) // transfer items, release lock and return 
     { 
         for (n = 0; n < nwords; n++) 
@@ -85,18 +105,19 @@ giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] enters nb_mwmr_write()"
         }
         mwmr->sts = mwmr->sts + nwords;
         mwmr->ptw = ptw;
+        mwmr_wake( mwmr );
 
 #if GIET_DEBUG_USER_MWMR
 giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] writes %d words in fifo %x : sts = %d\n",
                 x, y, lpid, nwords, (unsigned int)mwmr, mwmr->sts );
 #endif
 
-        lock_release( &mwmr->lock );
+        cfg_lock_release( &mwmr->lock );
         return items;
     }
     else if (spaces < width) // release lock and return 
     {
-        lock_release( &mwmr->lock );
+        cfg_lock_release( &mwmr->lock );
         return 0;
     }
     else // transfer as many items as possible, release lock and return 
@@ -110,13 +131,14 @@ giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] writes %d words in fifo %x : sts
         }
         mwmr->sts = sts + nwords;
         mwmr->ptw = ptw;
+        mwmr_wake( mwmr );
 
 #if GIET_DEBUG_USER_MWMR
 giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] writes %d words in fifo %x : sts = %d\n",
                 x, y, lpid, nwords, (unsigned int)mwmr, mwmr->sts );
 #endif
 
-        lock_release( &mwmr->lock );
+        cfg_lock_release( &mwmr->lock );
         return (nwords / width);
     }
 } // end nb_mwmr_write()
@@ -149,7 +171,7 @@ giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] enters nb_mwmr_read()"
     if (items == 0) return 0;
 
     // get the lock
-    lock_acquire( &mwmr->lock );
+    cfg_lock_acquire( &mwmr->lock );
 
     // access fifo status
     depth  = mwmr->depth;
@@ -158,6 +180,12 @@ giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] enters nb_mwmr_read()"
     ptr    = mwmr->ptr;
     nwords = width * items;
 
+    if (mwmr->rpending) // acquired spans not released : release lock and return
+    {
+        cfg_lock_release( &mwmr->lock );
+        return 0;
+    }
+
     if (sts >= nwords) // transfer items, release lock and return 
     {
         for (n = 0; n < nwords; n++) 
@@ -168,13 +196,14 @@ giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] enters nb_mwmr_read()"
         }
         mwmr->sts = mwmr->sts - nwords;
         mwmr->ptr = ptr;
+        mwmr_wake( mwmr );
 
 #if GIET_DEBUG_USER_MWMR
 giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] read %d words in fifo %x : sts = %d\n",
                 x, y, lpid, nwords, (unsigned int)mwmr, mwmr->sts );
 #endif
 
-        lock_release( &mwmr->lock );
+        cfg_lock_release( &mwmr->lock );
         return items;
     }
     else if (sts < width) // release lock and return 
@@ -185,7 +214,7 @@ giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] read nothing in fifo %x : sts = %
                 x, y, lpid, (unsigned int)mwmr, mwmr->sts );
 #endif
 
-        lock_release( &mwmr->lock );
+        cfg_lock_release( &mwmr->lock );
         return 0;
     }
     else // transfer as many items as possible, release lock and return 
@@ -199,23 +228,26 @@ giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] read nothing in fifo %x : sts = %
         }
         mwmr->sts = sts - nwords;
         mwmr->ptr = ptr;
+        mwmr_wake( mwmr );
 
 #if GIET_DEBUG_USER_MWMR
 giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] read %d words in fifo %x : sts = %d\n",
                 x, y, lpid, nwords, (unsigned int)mwmr, mwmr->sts );
 #endif
 
-        lock_release( &mwmr->lock );
+        cfg_lock_release( &mwmr->lock );
         return (nwords / width);
     }
 } // nb_mwmr_read()
 
 
 
-////////////////////////////////////////
-void mwmr_write( mwmr_channel_t * mwmr, 
-                 unsigned int *   buffer, 
-                 unsigned int     items ) 
+///////////////////////////////////////////////////
+static
+void mwmr_write_generic( mwmr_channel_t * mwmr, 
+                         unsigned int *   buffer, 
+                         unsigned int     items,
+                         unsigned int     sleep ) 
 {
 
 #if GIET_DEBUG_USER_MWMR
@@ -241,7 +273,8 @@ giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] enters mwmr_write()"
     while (1) 
     {
         // get the lock
-        lock_acquire( &mwmr->lock );
+        if ( sleep ) cfg_lock_acquire_sleep( &mwmr->lock );
+        else         cfg_lock_acquire( &mwmr->lock );
 
         // compute spaces and nwords
         depth = mwmr->depth;
@@ -251,7 +284,11 @@ giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] enters mwmr_write()"
         spaces = depth - sts;
         nwords = width * items;
 
-        if (spaces >= nwords) // write nwords, release lock and return
+        if (mwmr->wpending) // reserved spans not committed : release lock and retry
+        {
+            cfg_lock_release( &mwmr->lock );
+        }
+        else if (spaces >= nwords) // write nwords, release lock and return
         {
             for (n = 0; n < nwords; n++) 
             {
@@ -261,18 +298,19 @@ giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] enters mwmr_write()"
             }
             mwmr->ptw = ptw;
             mwmr->sts = sts + nwords;
+            mwmr_wake( mwmr );
 
 #if GIET_DEBUG_USER_MWMR
 giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] writes %d words in fifo %x : sts = %d\n",
                 x, y, lpid, nwords, (unsigned int)mwmr, mwmr->sts );
 #endif
 
-            lock_release( &mwmr->lock );
+            cfg_lock_release( &mwmr->lock );
             return;
         }
         else if (spaces < width) // release lock and retry           
         {
-            lock_release( &mwmr->lock );
+            cfg_lock_release( &mwmr->lock );
         }
         else // write as many items as possible, release lock and retry
         {
@@ -283,8 +321,10 @@ giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] writes %d words in fifo %x : sts
                 if ((ptw + 1) == depth)  ptw = 0; 
                 else                     ptw = ptw + 1;
             }
-            mwmr->sts = sts + nwords;
+            sts = sts + nwords;
+            mwmr->sts = sts;
             mwmr->ptw = ptw;
+            mwmr_wake( mwmr );
             buffer = buffer + nwords;
             items = items - (nwords/width);
 
@@ -293,19 +333,37 @@ giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] writes %d words in fifo %x : sts
                 x, y, lpid, nwords, (unsigned int)mwmr, mwmr->sts );
 #endif
 
-            lock_release( &mwmr->lock );
+            cfg_lock_release( &mwmr->lock );
         }
 
-        // we could deschedule before retry...
-        // giet_context_switch();
+        // wait a status modification before retry
+        if ( sleep ) spin_then_sleep( &mwmr->sts, sts, &mwmr->waiters );
     }
-} // end mwmr_write()
+} // end mwmr_write_generic()
 
+////////////////////////////////////////
+void mwmr_write( mwmr_channel_t * mwmr, 
+                 unsigned int *   buffer, 
+                 unsigned int     items ) 
+{
+    mwmr_write_generic( mwmr, buffer, items, 0 );
+}
 
-//////////////////////////////////////
-void mwmr_read( mwmr_channel_t * mwmr, 
-                unsigned int *   buffer, 
-                unsigned int     items) 
+//////////////////////////////////////////////
+void mwmr_write_sleep( mwmr_channel_t * mwmr, 
+                       unsigned int *   buffer, 
+                       unsigned int     items ) 
+{
+    mwmr_write_generic( mwmr, buffer, items, 1 );
+}
+
+
+//////////////////////////////////////////////////
+static
+void mwmr_read_generic( mwmr_channel_t * mwmr, 
+                        unsigned int *   buffer, 
+                        unsigned int     items,
+                        unsigned int     sleep ) 
 {
 
 #if GIET_DEBUG_USER_MWMR
@@ -330,7 +388,8 @@ giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] enters mwmr_read()"
     while (1) 
     {
         // get the lock
-        lock_acquire( &mwmr->lock );
+        if ( sleep ) cfg_lock_acquire_sleep( &mwmr->lock );
+        else         cfg_lock_acquire( &mwmr->lock );
 
         // compute nwords
         depth  = mwmr->depth;
@@ -339,7 +398,11 @@ giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] enters mwmr_read()"
         ptr    = mwmr->ptr;
         nwords = width * items;
 
-        if (sts >= nwords) // read nwords, release lock and return
+        if (mwmr->rpending) // acquired spans not released : release lock and retry
+        {
+            cfg_lock_release( &mwmr->lock );
+        }
+        else if (sts >= nwords) // read nwords, release lock and return
         {
             for (n = 0; n < nwords; n++) 
             {
@@ -349,18 +412,19 @@ giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] enters mwmr_read()"
             }
             mwmr->sts = mwmr->sts - nwords;
             mwmr->ptr = ptr;
+            mwmr_wake( mwmr );
 
 #if GIET_DEBUG_USER_MWMR
 giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] read %d words in fifo %x : sts = %d\n",
                 x, y, lpid, nwords, (unsigned int)mwmr, mwmr->sts );
 #endif
 
-            lock_release( &mwmr->lock );
+            cfg_lock_release( &mwmr->lock );
             return;
         }
         else if (sts < width) // release lock and retry
         {
-            lock_release( &mwmr->lock );
+            cfg_lock_release( &mwmr->lock );
         }
         else // read as many items as possible, release lock and retry
         {   
@@ -371,8 +435,10 @@ giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] read %d words in fifo %x : sts =
                 if ((ptr + 1) == depth) ptr = 0;
                 else                    ptr = ptr + 1;
             }
-            mwmr->sts = sts - nwords;
+            sts = sts - nwords;
+            mwmr->sts = sts;
             mwmr->ptr = ptr;
+            mwmr_wake( mwmr );
             buffer = buffer + nwords;
             items = items - (nwords/width);
 
@@ -381,13 +447,201 @@ giet_tty_printf("\n[MWMR DEBUG] Proc[%d,%d,%d] read %d words in fifo %x : sts =
                 x, y, lpid, nwords, (unsigned int)mwmr, mwmr->sts );
 #endif
 
-            lock_release( &mwmr->lock );
+            cfg_lock_release( &mwmr->lock );
         }
 
-        // we could deschedule before retry...
-        // giet_context_switch();
+        // wait a status modification before retry
+        if ( sleep ) spin_then_sleep( &mwmr->sts, sts, &mwmr->waiters );
+    }
+} // end mwmr_read_generic() 
+
+//////////////////////////////////////
+void mwmr_read( mwmr_channel_t * mwmr, 
+                unsigned int *   buffer, 
+                unsigned int     items ) 
+{
+    mwmr_read_generic( mwmr, buffer, items, 0 );
+}
+
+////////////////////////////////////////////
+void mwmr_read_sleep( mwmr_channel_t * mwmr, 
+                      unsigned int *   buffer, 
+                      unsigned int     items ) 
+{
+    mwmr_read_generic( mwmr, buffer, items, 1 );
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+//      Zero-copy access functions
+// The reserved (or acquired) spans are contiguous in the circular buffer,
+// modulo the buffer wrap: the first pending span starts (wpending) words
+// before ptw (or (rpending) words before ptr).
+///////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+static inline unsigned int mwmr_index_sub( unsigned int index,
+                                           unsigned int nwords,
+                                           unsigned int depth )
+{
+    if ( index >= nwords ) return index - nwords;
+    else                   return index + depth - nwords;
+}
+
+//////////////////////////////////////////////////////////////////////
+static inline unsigned int mwmr_index_add( unsigned int index,
+                                           unsigned int nwords,
+                                           unsigned int depth )
+{
+    index = index + nwords;
+    if ( index >= depth ) index = index - depth;
+    return index;
+}
+
+//////////////////////////////////////////////
+void mwmr_write_reserve( mwmr_channel_t* mwmr,
+                         mwmr_span_t*    span,
+                         unsigned int    items )
+{
+    unsigned int nwords = mwmr->width * items;
+
+    if ( (items == 0) || (nwords > mwmr->depth) )
+    {
+        giet_exit("MWMR ERROR in mwmr_write_reserve() : illegal number of items");
     }
-} // end mwmr_read() 
+
+    while ( 1 )
+    {
+        cfg_lock_acquire( &mwmr->lock );
+
+        if ( (mwmr->depth - mwmr->sts - mwmr->wpending) >= nwords )
+        {
+            span->data   = mwmr->data;
+            span->start  = mwmr->ptw;
+            span->nwords = nwords;
+            span->depth  = mwmr->depth;
+            span->width  = mwmr->width;
+
+            mwmr->ptw      = mwmr_index_add( mwmr->ptw, nwords, mwmr->depth );
+            mwmr->wpending = mwmr->wpending + nwords;
+
+#if GIET_DEBUG_USER_MWMR
+giet_tty_printf("\n[MWMR DEBUG] reserves %d words in fifo %x : start = %d\n",
+                nwords, (unsigned int)mwmr, span->start );
+#endif
+
+            cfg_lock_release( &mwmr->lock );
+            return;
+        }
+
+        cfg_lock_release( &mwmr->lock );
+    }
+} // end mwmr_write_reserve()
+
+/////////////////////////////////////////////
+void mwmr_write_commit( mwmr_channel_t* mwmr,
+                        mwmr_span_t*    span )
+{
+    // the items built in place must be visible before the status
+    asm volatile ("sync" ::: "memory");
+
+    while ( 1 )
+    {
+        cfg_lock_acquire( &mwmr->lock );
+
+        // commit only if this span is the oldest reserved span
+        if ( mwmr_index_sub( mwmr->ptw, mwmr->wpending, mwmr->depth ) == span->start )
+        {
+            mwmr->sts      = mwmr->sts + span->nwords;
+            mwmr->wpending = mwmr->wpending - span->nwords;
+            mwmr_wake( mwmr );
+
+            cfg_lock_release( &mwmr->lock );
+            return;
+        }
+
+        cfg_lock_release( &mwmr->lock );
+    }
+} // end mwmr_write_commit()
+
+/////////////////////////////////////////////
+void mwmr_read_acquire( mwmr_channel_t* mwmr,
+                        mwmr_span_t*    span,
+                        unsigned int    items )
+{
+    unsigned int nwords = mwmr->width * items;
+
+    if ( (items == 0) || (nwords > mwmr->depth) )
+    {
+        giet_exit("MWMR ERROR in mwmr_read_acquire() : illegal number of items");
+    }
+
+    while ( 1 )
+    {
+        cfg_lock_acquire( &mwmr->lock );
+
+        if ( (mwmr->sts - mwmr->rpending) >= nwords )
+        {
+            span->data   = mwmr->data;
+            span->start  = mwmr->ptr;
+            span->nwords = nwords;
+            span->depth  = mwmr->depth;
+            span->width  = mwmr->width;
+
+            mwmr->ptr      = mwmr_index_add( mwmr->ptr, nwords, mwmr->depth );
+            mwmr->rpending = mwmr->rpending + nwords;
+
+#if GIET_DEBUG_USER_MWMR
+giet_tty_printf("\n[MWMR DEBUG] acquires %d words in fifo %x : start = %d\n",
+                nwords, (unsigned int)mwmr, span->start );
+#endif
+
+            cfg_lock_release( &mwmr->lock );
+            return;
+        }
+
+        cfg_lock_release( &mwmr->lock );
+    }
+} // end mwmr_read_acquire()
+
+/////////////////////////////////////////////
+void mwmr_read_release( mwmr_channel_t* mwmr,
+                        mwmr_span_t*    span )
+{
+    // the items processed in place must be read before the slots are freed
+    asm volatile ("sync" ::: "memory");
+
+    while ( 1 )
+    {
+        cfg_lock_acquire( &mwmr->lock );
+
+        // release only if this span is the oldest acquired span
+        if ( mwmr_index_sub( mwmr->ptr, mwmr->rpending, mwmr->depth ) == span->start )
+        {
+            mwmr->sts      = mwmr->sts - span->nwords;
+            mwmr->rpending = mwmr->rpending - span->nwords;
+            mwmr_wake( mwmr );
+
+            cfg_lock_release( &mwmr->lock );
+            return;
+        }
+
+        cfg_lock_release( &mwmr->lock );
+    }
+} // end mwmr_read_release()
+
+/////////////////////////////////////////////////
+unsigned int* mwmr_span_item( mwmr_span_t*  span,
+                              unsigned int  index )
+{
+    unsigned int offset = index * span->width;
+
+    if ( offset >= span->nwords )
+    {
+        giet_exit("MWMR ERROR in mwmr_span_item() : index too large");
+    }
+
+    return &span->data[mwmr_index_add( span->start, offset, span->depth )];
+}
 
 
 // Local Variables:
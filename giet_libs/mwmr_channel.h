@@ -21,7 +21,24 @@
 // a multiple of the "width" parameter.
 //
 // Both the mwmr_read() and mwmr_write() functions are blocking functions. 
-// A queuing lock provides exclusive access to the MWMR channel.
+// A queuing lock provides exclusive access to the MWMR channel: it is a ticket
+// lock, or a MCS lock if the GIET_USER_MCS_LOCK parameter is non zero.
+// The mwmr_read_sleep() and mwmr_write_sleep() variants do not busy wait 
+// on a full or empty channel: they poll the channel status GIET_USER_SPIN_MAX
+// times, and then deschedule the calling task on a futex, that is signaled
+// by any function modifying the channel status.
+//
+// The zero-copy functions give direct access to the circular buffer:
+// - mwmr_write_reserve() reserves a span of empty items, that can be built
+//   in place by the producer, and mwmr_write_commit() makes them readable.
+// - mwmr_read_acquire() gets a span of full items, that can be processed
+//   in place by the consumer, and mwmr_read_release() frees them.
+// As the depth is a multiple of the width, an item is never split by the
+// buffer wrap, and mwmr_span_item() returns a pointer on any item of a span.
+// The spans are committed (or released) in the reservation (or acquisition)
+// order: a commit (or release) waits until all older spans are committed
+// (or released). The mwmr_write() (or mwmr_read()) functions wait until
+// there is no pending reserved (or acquired) span.
 ///////////////////////////////////////////////////////////////////////////////////
 
 #ifndef _MWMR_CHANNEL_H_
@@ -35,16 +52,35 @@
 
 typedef struct mwmr_channel_s 
 {
-    user_lock_t    lock;         // exclusive access lock
+    cfg_lock_t     lock;         // exclusive access lock
     unsigned int   sts;          // number of words available
     unsigned int   ptr;          // index of the first valid data word
     unsigned int   ptw;          // index of the first empty slot 
     unsigned int   depth;        // max number of words in the channel
     unsigned int   width;        // number of words in an item      
     unsigned int*  data;         // circular buffer base address
-    unsigned int   padding[10];  // for 64 bytes alignment
+    unsigned int   waiters;      // number of tasks blocked on a futex
+    unsigned int   wpending;     // number of reserved but not committed words
+    unsigned int   rpending;     // number of acquired but not released words
+    unsigned int   padding[7];   // for 64 bytes alignment
 } mwmr_channel_t;
 
+// The sts field counts the committed words that are not yet released,
+// including the rpending acquired words.
+
+///////////////////////////////////////////////////////////////////////////////////
+//  MWMR span descriptor (zero-copy access)
+///////////////////////////////////////////////////////////////////////////////////
+
+typedef struct mwmr_span_s
+{
+    unsigned int*  data;         // channel buffer base address
+    unsigned int   start;        // index of the first word in the buffer
+    unsigned int   nwords;       // number of words in the span
+    unsigned int   depth;        // channel depth (in words)
+    unsigned int   width;        // number of words in an item
+} mwmr_span_t;
+
 //////////////////////////////////////////////////////////////////////////////
 //  MWMR access functions
 //////////////////////////////////////////////////////////////////////////////
@@ -62,6 +98,14 @@ void mwmr_write( mwmr_channel_t* mwmr,
                  unsigned int*   buffer,
                  unsigned int    items );
 
+void mwmr_read_sleep(  mwmr_channel_t* mwmr,
+                       unsigned int*   buffer,
+                       unsigned int    items );
+
+void mwmr_write_sleep( mwmr_channel_t* mwmr,
+                       unsigned int*   buffer,
+                       unsigned int    items );
+
 unsigned int nb_mwmr_read ( mwmr_channel_t * mwmr,
                             unsigned int * buffer,
                             unsigned int items );
@@ -70,6 +114,23 @@ unsigned int nb_mwmr_write( mwmr_channel_t * mwmr,
                             unsigned int * buffer,
                             unsigned int items );
 
+void mwmr_write_reserve( mwmr_channel_t* mwmr,
+                         mwmr_span_t*    span,
+                         unsigned int    items );
+
+void mwmr_write_commit( mwmr_channel_t* mwmr,
+                        mwmr_span_t*    span );
+
+void mwmr_read_acquire( mwmr_channel_t* mwmr,
+                        mwmr_span_t*    span,
+                        unsigned int    items );
+
+void mwmr_read_release( mwmr_channel_t* mwmr,
+                        mwmr_span_t*    span );
+
+unsigned int* mwmr_span_item( mwmr_span_t*  span,
+                              unsigned int  index );
+
 #endif
 
 // Local Variables:
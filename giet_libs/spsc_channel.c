@@ -0,0 +1,321 @@
+//////////////////////////////////////////////////////////////////////////////////
+// File     : spsc_channel.c
+// Date     : 01/10/2015
+// Author   : alain greiner
+// Copyright (c) UPMC-LIP6
+///////////////////////////////////////////////////////////////////////////////////
+
+#include "spsc_channel.h"
+#include "giet_config.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "user_lock.h"
+
+///////////////////////////////////////////////////////////////////////////////////
+//      Index manipulation functions
+// The ptw and ptr indexes are in the [0 , 2*depth[ interval: the channel
+// is empty when (ptw == ptr), and full when (ptw - ptr) == depth.
+///////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////
+static inline unsigned int spsc_words( spsc_channel_t* spsc,
+                                       unsigned int    ptw,
+                                       unsigned int    ptr )
+{
+    if ( ptw >= ptr ) return ptw - ptr;
+    else              return ptw + (spsc->depth << 1) - ptr;
+}
+
+////////////////////////////////////////////////////////////////
+static inline unsigned int spsc_advance( spsc_channel_t* spsc,
+                                         unsigned int    index,
+                                         unsigned int    nwords )
+{
+    index = index + nwords;
+    if ( index >= (spsc->depth << 1) ) index = index - (spsc->depth << 1);
+    return index;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// This function copies <nwords> words from <buffer> to the channel, starting
+// at <index>. It uses one memcpy() per contiguous span (two at most).
+///////////////////////////////////////////////////////////////////////////////////
+static void spsc_copy_in( spsc_channel_t* spsc,
+                          unsigned int    index,
+                          unsigned int*   buffer,
+                          unsigned int    nwords )
+{
+    unsigned int depth = spsc->depth;
+    unsigned int slot  = ( index >= depth ) ? index - depth : index;
+    unsigned int first = depth - slot;
+
+    if ( first >= nwords )
+    {
+        memcpy( &spsc->data[slot], buffer, nwords << 2 );
+    }
+    else
+    {
+        memcpy( &spsc->data[slot], buffer, first << 2 );
+        memcpy( spsc->data, buffer + first, (nwords - first) << 2 );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// This function copies <nwords> words from the channel to <buffer>, starting
+// at <index>. It uses one memcpy() per contiguous span (two at most).
+///////////////////////////////////////////////////////////////////////////////////
+static void spsc_copy_out( spsc_channel_t* spsc,
+                           unsigned int    index,
+                           unsigned int*   buffer,
+                           unsigned int    nwords )
+{
+    unsigned int depth = spsc->depth;
+    unsigned int slot  = ( index >= depth ) ? index - depth : index;
+    unsigned int first = depth - slot;
+
+    if ( first >= nwords )
+    {
+        memcpy( buffer, &spsc->data[slot], nwords << 2 );
+    }
+    else
+    {
+        memcpy( buffer, &spsc->data[slot], first << 2 );
+        memcpy( buffer + first, spsc->data, (nwords - first) << 2 );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+//      Channel initialisation functions
+///////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////
+void spsc_init( spsc_channel_t*  spsc,
+                unsigned int*    buffer,     // buffer base address
+                unsigned int     width,      // number of words per item
+                unsigned int     nitems )    // max number of items
+{
+
+#if GIET_DEBUG_USER_SPSC
+unsigned int    x;
+unsigned int    y;
+unsigned int    lpid;
+giet_proc_xyp( &x, &y, &lpid );
+giet_tty_printf("\n[SPSC DEBUG] Proc[%d,%d,%d] initialises fifo %x / "
+                " buffer = %x / width = %d / nitems = %d\n",
+                x, y, lpid, (unsigned int)spsc, (unsigned int)buffer, width, nitems );
+#endif
+
+    if ( (width == 0) || (nitems == 0) ) giet_exit("SPSC ERROR : empty channel");
+
+    spsc->ptw           = 0;
+    spsc->ptr_copy      = 0;
+    spsc->empty_waiters = 0;
+    spsc->ptr           = 0;
+    spsc->ptw_copy      = 0;
+    spsc->full_waiters  = 0;
+    spsc->depth         = width * nitems;
+    spsc->width         = width;
+    spsc->data          = buffer;
+
+    asm volatile ("sync" ::: "memory");
+}
+
+////////////////////////////////////////////////////
+spsc_channel_t* spsc_vseg_init( char*         vspace_name,
+                                char*         vseg_name,
+                                unsigned int  width )
+{
+    unsigned int  vbase;
+    unsigned int  length;
+
+    giet_vobj_get_vbase( vspace_name, vseg_name, &vbase );
+    giet_vobj_get_length( vspace_name, vseg_name, &length );
+
+    if ( length < (sizeof(spsc_channel_t) + (width << 2)) )
+    {
+        giet_exit("SPSC ERROR : vseg too small");
+    }
+
+    spsc_init( (spsc_channel_t*)vbase,
+               (unsigned int*)(vbase + sizeof(spsc_channel_t)),
+               width,
+               (length - sizeof(spsc_channel_t)) / (width << 2) );
+
+    return (spsc_channel_t*)vbase;
+}
+
+///////////////////////////////////////////////////
+spsc_channel_t* spsc_vseg_get( char*  vspace_name,
+                               char*  vseg_name )
+{
+    unsigned int  vbase;
+
+    giet_vobj_get_vbase( vspace_name, vseg_name, &vbase );
+
+    return (spsc_channel_t*)vbase;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+//      Channel access functions
+///////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////
+static
+void spsc_write_generic( spsc_channel_t* spsc,
+                         unsigned int*   buffer,
+                         unsigned int    items,
+                         unsigned int    sleep )
+{
+    unsigned int  depth  = spsc->depth;
+    unsigned int  width  = spsc->width;
+    unsigned int  nwords = width * items;   // remaining words
+    unsigned int  ptw    = spsc->ptw;       // only modified by this task
+    unsigned int  ptr    = spsc->ptr_copy;  // local copy of the read index
+    unsigned int  spaces;                   // number of empty slots (words)
+    unsigned int  n;                        // number of words in a transfer
+
+    while ( nwords )
+    {
+        spaces = depth - spsc_words( spsc, ptw, ptr );
+
+        // refresh the local copy of the read index if required
+        if ( spaces < nwords )
+        {
+            ptr            = *(volatile unsigned int*)&spsc->ptr;
+            spsc->ptr_copy = ptr;
+            spaces         = depth - spsc_words( spsc, ptw, ptr );
+        }
+
+        if ( spaces < width )   // channel full : wait and retry
+        {
+            if ( sleep ) spin_then_sleep( &spsc->ptr, ptr, &spsc->full_waiters );
+            continue;
+        }
+
+        // transfer as many items as possible
+        if ( spaces >= nwords ) n = nwords;
+        else                    n = (spaces / width) * width;
+
+        spsc_copy_in( spsc, ptw, buffer, n );
+
+        // the data must be visible before the write index
+        asm volatile ("sync" ::: "memory");
+
+        ptw       = spsc_advance( spsc, ptw, n );
+        spsc->ptw = ptw;
+
+        asm volatile ("sync" ::: "memory");
+
+        if ( spsc->empty_waiters ) giet_futex_wake( &spsc->ptw, 0xFFFFFFFF );
+
+#if GIET_DEBUG_USER_SPSC
+giet_tty_printf("\n[SPSC DEBUG] writes %d words in fifo %x : ptw = %d\n",
+                n, (unsigned int)spsc, ptw );
+#endif
+
+        buffer = buffer + n;
+        nwords = nwords - n;
+    }
+} // end spsc_write_generic()
+
+//////////////////////////////////////////
+void spsc_write( spsc_channel_t* spsc,
+                 unsigned int*   buffer,
+                 unsigned int    items )
+{
+    spsc_write_generic( spsc, buffer, items, 0 );
+}
+
+////////////////////////////////////////////////
+void spsc_write_sleep( spsc_channel_t* spsc,
+                       unsigned int*   buffer,
+                       unsigned int    items )
+{
+    spsc_write_generic( spsc, buffer, items, 1 );
+}
+
+//////////////////////////////////////////////////
+static
+void spsc_read_generic( spsc_channel_t* spsc,
+                        unsigned int*   buffer,
+                        unsigned int    items,
+                        unsigned int    sleep )
+{
+    unsigned int  width  = spsc->width;
+    unsigned int  nwords = width * items;   // remaining words
+    unsigned int  ptr    = spsc->ptr;       // only modified by this task
+    unsigned int  ptw    = spsc->ptw_copy;  // local copy of the write index
+    unsigned int  sts;                      // number of full slots (words)
+    unsigned int  n;                        // number of words in a transfer
+
+    while ( nwords )
+    {
+        sts = spsc_words( spsc, ptw, ptr );
+
+        // refresh the local copy of the write index if required
+        if ( sts < nwords )
+        {
+            ptw            = *(volatile unsigned int*)&spsc->ptw;
+            spsc->ptw_copy = ptw;
+            sts            = spsc_words( spsc, ptw, ptr );
+        }
+
+        if ( sts < width )   // channel empty : wait and retry
+        {
+            if ( sleep ) spin_then_sleep( &spsc->ptw, ptw, &spsc->empty_waiters );
+            continue;
+        }
+
+        // transfer as many items as possible
+        if ( sts >= nwords ) n = nwords;
+        else                 n = (sts / width) * width;
+
+        // the write index must be read before the data
+        asm volatile ("sync" ::: "memory");
+
+        spsc_copy_out( spsc, ptr, buffer, n );
+
+        // the data must be read before the slots are released
+        asm volatile ("sync" ::: "memory");
+
+        ptr       = spsc_advance( spsc, ptr, n );
+        spsc->ptr = ptr;
+
+        asm volatile ("sync" ::: "memory");
+
+        if ( spsc->full_waiters ) giet_futex_wake( &spsc->ptr, 0xFFFFFFFF );
+
+#if GIET_DEBUG_USER_SPSC
+giet_tty_printf("\n[SPSC DEBUG] read %d words in fifo %x : ptr = %d\n",
+                n, (unsigned int)spsc, ptr );
+#endif
+
+        buffer = buffer + n;
+        nwords = nwords - n;
+    }
+} // end spsc_read_generic()
+
+/////////////////////////////////////////
+void spsc_read( spsc_channel_t* spsc,
+                unsigned int*   buffer,
+                unsigned int    items )
+{
+    spsc_read_generic( spsc, buffer, items, 0 );
+}
+
+///////////////////////////////////////////////
+void spsc_read_sleep( spsc_channel_t* spsc,
+                      unsigned int*   buffer,
+                      unsigned int    items )
+{
+    spsc_read_generic( spsc, buffer, items, 1 );
+}
+
+// Local Variables:
+// tab-width: 4
+// c-basic-offset: 4
+// c-file-offsets:((innamespace . 0)(inline-open . 0))
+// indent-tabs-mode: nil
+// End:
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=4:softtabstop=4
+
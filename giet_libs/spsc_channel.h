@@ -0,0 +1,106 @@
+//////////////////////////////////////////////////////////////////////////////////
+// File     : spsc_channel.h
+// Date     : 01/10/2015
+// Author   : alain greiner
+// Copyright (c) UPMC-LIP6
+///////////////////////////////////////////////////////////////////////////////////
+// The spsc_channel.c and spsc_channel.h files are part of the GIET-VM
+// nano-kernel. This middleware implements a user level Single-Writer /
+// Single-Reader communication channel, that can replace a MWMR channel
+// when the channel has exactly one producer task and one consumer task.
+//
+// As for the MWMR channel, a transaction transfers an integer number of
+// items, and an item is an integer number of unsigned int (32 bits words).
+// The channel does not use any lock:
+// - the "ptw" write index is only modified by the producer,
+// - the "ptr" read index is only modified by the consumer.
+// These indexes are word counters modulo (2 * depth), to distinguish a full
+// channel from an empty channel without division. Each index is stored in a
+// separated cache line, together with a private copy of the other index, that
+// is only refreshed when the channel looks full (producer) or empty (consumer).
+// The read-only parameters are stored in a third cache line, and the
+// descriptor must be aligned on a cache line boundary.
+// The data are moved with memcpy(), in at most two contiguous spans.
+//
+// Both the spsc_read() and spsc_write() functions are blocking functions.
+// The spsc_read_sleep() and spsc_write_sleep() variants poll the channel
+// GIET_USER_SPIN_MAX times, and then deschedule the calling task on a futex.
+//
+// The channel descriptor and the data buffer can be defined in the
+// application code, and initialised with spsc_init(), as a MWMR channel.
+// They can also be defined in the application mapping (.py file), as a
+// BUFFER vseg: the descriptor is stored at the vseg base, the data buffer
+// uses the rest of the vseg, and the channel is initialised by one task
+// with spsc_vseg_init(). The other task gets the channel with spsc_vseg_get().
+///////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _SPSC_CHANNEL_H_
+#define _SPSC_CHANNEL_H_
+
+///////////////////////////////////////////////////////////////////////////////////
+//  SPSC channel structure (three cache lines)
+///////////////////////////////////////////////////////////////////////////////////
+
+typedef struct spsc_channel_s
+{
+    // producer cache line
+    unsigned int   ptw;            // write index (words)
+    unsigned int   ptr_copy;       // producer copy of the read index
+    unsigned int   empty_waiters;  // number of consumers blocked on ptw
+    unsigned int   padding_w[13];  // for 64 bytes alignment
+
+    // consumer cache line
+    unsigned int   ptr;            // read index (words)
+    unsigned int   ptw_copy;       // consumer copy of the write index
+    unsigned int   full_waiters;   // number of producers blocked on ptr
+    unsigned int   padding_r[13];  // for 64 bytes alignment
+
+    // read-only cache line
+    unsigned int   depth;          // max number of words in the channel
+    unsigned int   width;          // number of words in an item
+    unsigned int*  data;           // circular buffer base address
+    unsigned int   padding[13];    // for 64 bytes alignment
+} spsc_channel_t;
+
+//////////////////////////////////////////////////////////////////////////////
+//  SPSC access functions
+//////////////////////////////////////////////////////////////////////////////
+
+extern void spsc_init( spsc_channel_t* spsc,
+                       unsigned int*   buffer,    // data buffer base address
+                       unsigned int    width,     // number of words per item
+                       unsigned int    nitems );  // max number of items
+
+extern spsc_channel_t* spsc_vseg_init( char*         vspace_name,
+                                       char*         vseg_name,
+                                       unsigned int  width );
+
+extern spsc_channel_t* spsc_vseg_get( char*  vspace_name,
+                                      char*  vseg_name );
+
+extern void spsc_read( spsc_channel_t* spsc,
+                       unsigned int*   buffer,
+                       unsigned int    items );
+
+extern void spsc_write( spsc_channel_t* spsc,
+                        unsigned int*   buffer,
+                        unsigned int    items );
+
+extern void spsc_read_sleep( spsc_channel_t* spsc,
+                             unsigned int*   buffer,
+                             unsigned int    items );
+
+extern void spsc_write_sleep( spsc_channel_t* spsc,
+                              unsigned int*   buffer,
+                              unsigned int    items );
+
+#endif
+
+// Local Variables:
+// tab-width: 4
+// c-basic-offset: 4
+// c-file-offsets:((innamespace . 0)(inline-open . 0))
+// indent-tabs-mode: nil
+// End:
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=4:softtabstop=4
+
@@ -101,6 +101,103 @@ void giet_tasks_status()
               0, 0, 0, 0 );
 }
 
+///////////////////////////////////////////////////
+int giet_tasks_stats( giet_task_stats_t* buffer,
+                      unsigned int       first,
+                      unsigned int       count )
+{
+    return sys_call( SYSCALL_TASKS_STATS,
+                     (unsigned int)buffer,
+                     first,
+                     count,
+                     0 );
+}
+
+///////////////////////////////////////////////////
+int giet_locks_stats( giet_lock_stats_t* buffer,
+                      unsigned int       count )
+{
+    return sys_call( SYSCALL_LOCKS_STATS,
+                     (unsigned int)buffer,
+                     count,
+                     0, 0 );
+}
+
+/////////////////////////////////////////
+int giet_futex_wait( unsigned int* addr,
+                     unsigned int  value )
+{
+    return sys_call( SYSCALL_FUTEX_WAIT,
+                     (unsigned int)addr,
+                     value,
+                     0, 0 );
+}
+
+/////////////////////////////////////////
+int giet_futex_wake( unsigned int* addr,
+                     unsigned int  count )
+{
+    return sys_call( SYSCALL_FUTEX_WAKE,
+                     (unsigned int)addr,
+                     count,
+                     0, 0 );
+}
+
+//////////////////////////////////////////////////////////////////////////////
+///////////////////// Pthread related  system calls //////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// This function is the first function executed by a pthread: the kernel
+// passes the <entry> function and its argument in registers $4 and $5.
+//////////////////////////////////////////////////////////////////////////////
+static void giet_pthread_start( void* (*entry)(void*),
+                                void*  arg )
+{
+    giet_pthread_exit( entry( arg ) );
+}
+
+/////////////////////////////////////////////////
+int giet_pthread_create( unsigned int* trdid,
+                         unsigned int  x,
+                         unsigned int  y,
+                         unsigned int  p,
+                         void*         (*entry)(void*),
+                         void*         arg )
+{
+    int ret = sys_call( SYSCALL_PTHREAD_CREATE,
+                        (x << 24) | (y << 16) | p,
+                        (unsigned int)&giet_pthread_start,
+                        (unsigned int)entry,
+                        (unsigned int)arg );
+
+    if ( ret < 0 ) return -1;
+
+    *trdid = (unsigned int)ret;
+    return 0;
+}
+
+///////////////////////////////////////
+void giet_pthread_exit( void* retval )
+{
+    sys_call( SYSCALL_PTHREAD_EXIT,
+              (unsigned int)retval,
+              0, 0, 0 );
+
+    // only reached if the calling task is not a pthread
+    giet_exit( "giet_pthread_exit() called by a static task" );
+}
+
+////////////////////////////////////////////
+int giet_pthread_join( unsigned int  trdid,
+                       void**        retval )
+{
+    return sys_call( SYSCALL_PTHREAD_JOIN,
+                     trdid,
+                     (unsigned int)retval,
+                     0, 0 );
+}
+
 //////////////////////////////////////////////////////////////////////////////
 ///////////////////// Applications  system calls /////////////////////////////
 //////////////////////////////////////////////////////////////////////////////
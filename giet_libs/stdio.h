@@ -23,7 +23,7 @@
 #define SYSCALL_TTY_READ             0x03
 #define SYSCALL_TTY_ALLOC            0x04
 #define SYSCALL_TASKS_STATUS         0x05
-//                                   0x06
+#define SYSCALL_PTHREAD_JOIN         0x06
 #define SYSCALL_HEAP_INFO            0x07
 #define SYSCALL_LOCAL_TASK_ID        0x08
 #define SYSCALL_GLOBAL_TASK_ID       0x09
@@ -47,9 +47,9 @@
 #define SYSCALL_VOBJ_GET_VBASE       0x1A
 #define SYSCALL_VOBJ_GET_LENGTH      0x1B
 #define SYSCALL_GET_XY               0x1C
-//                                   0x1D
-//                                   0x1E
-//                                   0x1F
+#define SYSCALL_FUTEX_WAIT           0x1D
+#define SYSCALL_FUTEX_WAKE           0x1E
+#define SYSCALL_PTHREAD_CREATE       0x1F
 
 #define SYSCALL_FAT_OPEN             0x20
 #define SYSCALL_FAT_READ             0x21
@@ -63,7 +63,7 @@
 #define SYSCALL_FAT_OPENDIR          0x29
 #define SYSCALL_FAT_CLOSEDIR         0x2A
 #define SYSCALL_FAT_READDIR          0x2B
-//                                   0x2C
+#define SYSCALL_PTHREAD_EXIT         0x2C
 //                                   0x2D
 //                                   0x2E
 //                                   0x2F
@@ -74,8 +74,8 @@
 #define SYSCALL_NIC_STOP             0x33
 #define SYSCALL_NIC_STATS            0x34
 #define SYSCALL_NIC_CLEAR            0x35
-//                                   0x36
-//                                   0x37
+#define SYSCALL_TASKS_STATS          0x36
+#define SYSCALL_LOCKS_STATS          0x37
 //                                   0x38
 //                                   0x39
 //                                   0x3A
@@ -169,6 +169,70 @@ extern void giet_context_switch();
 
 extern void giet_tasks_status();
 
+// this structure is used by the giet_tasks_stats() system call
+// to return the accounting informations of one task.
+typedef struct giet_task_stats_s
+{
+    char          vspace[32];      // vspace name
+    char          name[32];        // task name
+    unsigned int  x;               // cluster x coordinate
+    unsigned int  y;               // cluster y coordinate
+    unsigned int  p;               // processor local index
+    unsigned int  norun;           // NORUN bit-vector (runable if zero)
+    unsigned int  running;         // non zero if task is running
+    unsigned int  run;             // cumulated execution time (cycles)
+    unsigned int  switches;        // number of times the task was descheduled
+    unsigned int  preempts;        // number of times the task was preempted
+    unsigned int  ioc_wait;        // cumulated time blocked on IOC (cycles)
+    unsigned int  cop_wait;        // cumulated time blocked on COPROC (cycles)
+} giet_task_stats_t;
+
+extern int giet_tasks_stats( giet_task_stats_t* buffer,
+                             unsigned int       first,
+                             unsigned int       count );
+
+// this structure is used by the giet_locks_stats() system call
+// to return the contention statistics of one kernel lock.
+typedef struct giet_lock_stats_s
+{
+    char          name[32];        // lock name
+    unsigned int  vaddr;           // lock statistics virtual address
+    unsigned int  acquires;        // number of acquisitions
+    unsigned int  contended;       // number of contended acquisitions
+    unsigned int  wait;            // cumulated waiting time (cycles)
+    unsigned int  max_hold;        // max holding time (cycles)
+} giet_lock_stats_t;
+
+extern int giet_locks_stats( giet_lock_stats_t* buffer,
+                             unsigned int       count );
+
+extern int giet_futex_wait( unsigned int* addr,
+                            unsigned int  value );
+
+extern int giet_futex_wake( unsigned int* addr,
+                            unsigned int  count );
+
+//////////////////////////////////////////////////////////////////////////
+//               Pthread related system calls
+//////////////////////////////////////////////////////////////////////////
+// A pthread is executed by a task slot declared as "dynamic" in the
+// mapping, and placed on processor [x,y,p]. The <entry> function can
+// return, or call giet_pthread_exit(). The returned value is obtained
+// by giet_pthread_join(), that must be called once for each pthread, 
+// to make the slot available for another giet_pthread_create().
+
+extern int giet_pthread_create( unsigned int* trdid,
+                                unsigned int  x,
+                                unsigned int  y,
+                                unsigned int  p,
+                                void*         (*entry)(void*),
+                                void*         arg );
+
+extern void giet_pthread_exit( void* retval );
+
+extern int giet_pthread_join( unsigned int  trdid,
+                              void**        retval );
+
 //////////////////////////////////////////////////////////////////////////
 //               Application related system calls
 //////////////////////////////////////////////////////////////////////////
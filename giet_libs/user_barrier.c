@@ -6,6 +6,7 @@
 ///////////////////////////////////////////////////////////////////////////////////
 
 #include "user_barrier.h"
+#include "user_lock.h"
 #include "malloc.h"
 #include "stdio.h"
 #include "giet_config.h"
@@ -18,15 +19,18 @@
 void barrier_init( giet_barrier_t* barrier, 
                    unsigned int    ntasks ) 
 {
-    barrier->arity  = ntasks;
-    barrier->count  = ntasks;
-    barrier->sense  = 0;
+    barrier->arity   = ntasks;
+    barrier->count   = ntasks;
+    barrier->sense   = 0;
+    barrier->waiters = 0;
 
     asm volatile ("sync" ::: "memory");
 }
 
-////////////////////////////////////////////
-void barrier_wait( giet_barrier_t* barrier ) 
+///////////////////////////////////////////////////
+static
+void barrier_wait_generic( giet_barrier_t* barrier,
+                           unsigned int    sleep ) 
 {
 
 #if GIET_DEBUG_USER_BARRIER
@@ -50,11 +54,11 @@ giet_tty_printf("\n[DEBUG USER BARRIER] proc[%d,%d,%d] enters barrier_wait()\n",
     volatile unsigned int  count    = 0;  // avoid a warning
 
     asm volatile( "addu   $2,     %1,        $0      \n"
-                  "barrier_llsc:                     \n"
+                  "1234:                             \n"
                   "ll     $8,     0($2)              \n"
                   "addi   $9,     $8,        -1      \n"
                   "sc     $9,     0($2)              \n"
-                  "beqz   $9,     barrier_llsc       \n"
+                  "beqz   $9,     1234b              \n"
                   "addu   %0,     $8,        $0      \n"
                   : "=r" (count)
                   : "r" (pcount)
@@ -66,6 +70,14 @@ giet_tty_printf("\n[DEBUG USER BARRIER] proc[%d,%d,%d] enters barrier_wait()\n",
     {
         barrier->count = barrier->arity;
         barrier->sense = expected;
+
+        // wake up the tasks blocked on the sense flag if any
+        asm volatile ("sync" ::: "memory");
+        if ( barrier->waiters ) giet_futex_wake( &barrier->sense, 0xFFFFFFFF );
+    }
+    else if ( sleep ) // other tasks polling, then blocked on the sense flag
+    {
+        spin_then_sleep( &barrier->sense, 1 - expected, &barrier->waiters );
     }
     else              // other tasks busy waiting the sense flag
     {
@@ -73,9 +85,9 @@ giet_tty_printf("\n[DEBUG USER BARRIER] proc[%d,%d,%d] enters barrier_wait()\n",
         // input: pointer on the sens flag (psense)
         // input: expected sense value (expected)
         unsigned int* psense  = (unsigned int *)&barrier->sense;
-        asm volatile ( "barrier_sense:                   \n"
+        asm volatile ( "5678:                            \n"
                        "lw    $3,   0(%0)                \n"
-                       "bne   $3,   %1,    barrier_sense \n"
+                       "bne   $3,   %1,    5678b         \n"
                        :
                        : "r"(psense), "r"(expected)
                        : "$3" );
@@ -88,6 +100,18 @@ giet_tty_printf("\n[DEBUG USER BARRIER] proc[%d,%d,%d] exit barrier_wait()\n",
                 x, y, p );
 #endif
 
+}  // end barrier_wait_generic()
+
+////////////////////////////////////////////
+void barrier_wait( giet_barrier_t* barrier ) 
+{
+    barrier_wait_generic( barrier, 0 );
+}
+
+//////////////////////////////////////////////////
+void barrier_wait_sleep( giet_barrier_t* barrier ) 
+{
+    barrier_wait_generic( barrier, 1 );
 }
 
 ///////////////////////////////////////////////////////////////////////////////////
@@ -117,8 +141,12 @@ void sqt_barrier_build( giet_sqt_barrier_t*  barrier,
         node->arity    = ntasks;   
         node->count    = ntasks;   
         node->sense    = 0;   
+        node->waiters  = 0;   
         node->level    = 0;   
         node->parent   = parent;
+        node->value    = 0;
+        node->result   = 0;
+        node->lock     = 0;
         node->child[0] = NULL;
         node->child[1] = NULL;
         node->child[2] = NULL;
@@ -170,8 +198,12 @@ giet_tty_printf("\n[DEBUG USER BARRIER] initialize sqt_node[%d][%d][%d] : arity
         node->arity    = arity;  
         node->count    = arity;
         node->sense    = 0;
+        node->waiters  = 0;
         node->level    = level;
         node->parent   = parent;
+        node->value    = 0;
+        node->result   = 0;
+        node->lock     = 0;
 
 #if GIET_DEBUG_USER_BARRIER
 giet_tty_printf("\n[DEBUG USER BARRIER] initialize sqt_node[%d][%d][%d] : arity = %d\n"
@@ -210,6 +242,11 @@ void sqt_barrier_init( giet_sqt_barrier_t*  barrier,
     if ( x_size > 16 ) giet_exit("SQT BARRIER ERROR : x_size too large");
     if ( y_size > 16 ) giet_exit("SQT BARRIER ERROR : y_size too large");
     if ( ntasks > 8  ) giet_exit("SQT BARRIER ERROR : ntasks too large");
+
+    barrier->type   = SQT_BARRIER_QUAD;
+    barrier->entry  = NULL;
+    barrier->y_size = y_size;
+    barrier->ntasks = ntasks;
     
     // compute SQT levels
     unsigned int levels; 
@@ -269,11 +306,174 @@ giet_tty_printf("\n[DEBUG USER BARRIER] SQT node[%d][%d][%d] : vaddr = %x\n",
 
 }  // end sqt_barrier_init
 
+///////////////////////////////////////////////////////////////////////////////////
+// This function builds the combining tree used by the SQT_BARRIER_TREE variant,
+// from bottom to root. The tasks are ranked in (x,y,lpid) order, and each group
+// of "fanin" consecutive children (tasks or nodes) is attached to one node,
+// allocated in the cluster containing the first task covered by this node.
+// The child[] pointers are not used by this variant.
+///////////////////////////////////////////////////////////////////////////////////
+static
+void sqt_barrier_tree_build( giet_sqt_barrier_t*  barrier,
+                             unsigned int         ntotal,
+                             unsigned int         fanin )
+{
+    sqt_node_t**  childs  = NULL;     // nodes of the level below (NULL for tasks)
+    unsigned int  nchilds = ntotal;   // number of children at current level
+    unsigned int  stride  = 1;        // number of tasks covered by one child
+    unsigned int  level   = 0;
+    unsigned int  nnodes;             // number of nodes at current level
+    unsigned int  n;
+    unsigned int  i;
+
+    while ( 1 )
+    {
+        nnodes = (nchilds + fanin - 1) / fanin;
+
+        sqt_node_t** nodes = malloc( nnodes * sizeof(sqt_node_t*) );
+
+        for ( n = 0 ; n < nnodes ; n++ )
+        {
+            unsigned int first   = n * fanin;
+            unsigned int arity   = ((nchilds - first) < fanin) ? (nchilds - first) : fanin;
+            unsigned int cluster = (first * stride) / barrier->ntasks;
+
+            sqt_node_t*  node = remote_malloc( sizeof(sqt_node_t),
+                                               cluster / barrier->y_size,
+                                               cluster % barrier->y_size );
+            node->arity    = arity;
+            node->count    = arity;
+            node->sense    = 0;
+            node->waiters  = 0;
+            node->level    = level;
+            node->parent   = NULL;
+            node->value    = 0;
+            node->result   = 0;
+            node->lock     = 0;
+            node->child[0] = NULL;
+            node->child[1] = NULL;
+            node->child[2] = NULL;
+            node->child[3] = NULL;
+
+            for ( i = 0 ; i < arity ; i++ )
+            {
+                if ( childs == NULL ) barrier->entry[first + i] = node;
+                else                  childs[first + i]->parent = node;
+            }
+
+            nodes[n] = node;
+
+#if GIET_DEBUG_USER_BARRIER
+giet_tty_printf("\n[DEBUG USER BARRIER] tree node[%d][%d] : vaddr = %x / arity = %d\n",
+                level, n, (unsigned int)node, arity );
+#endif
+        }
 
- 
-///////////////////////////////////////
+        if ( childs != NULL ) free( childs );
+
+        if ( nnodes == 1 )   // root reached
+        {
+            free( nodes );
+            return;
+        }
+
+        childs  = nodes;
+        nchilds = nnodes;
+        stride  = stride * fanin;
+        level++;
+    }
+}  // end sqt_barrier_tree_build()
+
+///////////////////////////////////////////////////////////////////////////////////
+// This function builds the per task nodes used by the SQT_BARRIER_DISSEMINATION
+// variant: each node is allocated in the cluster containing the task, and
+// registers the partner node for each round: (rank + 2**round) % ntotal.
+///////////////////////////////////////////////////////////////////////////////////
 static
-void sqt_barrier_decrement( sqt_node_t* node )
+void sqt_barrier_dis_build( giet_sqt_barrier_t*  barrier,
+                            unsigned int         ntotal )
+{
+    unsigned int  rounds = 0;
+    unsigned int  rank;
+    unsigned int  r;
+
+    while ( (1 << rounds) < ntotal ) rounds++;
+
+    // allocate all nodes before linking them
+    for ( rank = 0 ; rank < ntotal ; rank++ )
+    {
+        unsigned int cluster = rank / barrier->ntasks;
+
+        barrier->entry[rank] = remote_malloc( sizeof(sqt_dis_node_t),
+                                              cluster / barrier->y_size,
+                                              cluster % barrier->y_size );
+    }
+
+    for ( rank = 0 ; rank < ntotal ; rank++ )
+    {
+        sqt_dis_node_t* node = barrier->entry[rank];
+
+        for ( r = 0 ; r < SQT_BARRIER_ROUNDS_MAX ; r++ )
+        {
+            node->flag[0][r] = 0;
+            node->flag[1][r] = 0;
+            if ( r < rounds ) node->partner[r] = barrier->entry[(rank + (1 << r)) % ntotal];
+            else              node->partner[r] = NULL;
+        }
+        node->rounds  = rounds;
+        node->parity  = 0;
+        node->sense   = 1;
+        node->waiters = 0;
+
+#if GIET_DEBUG_USER_BARRIER
+giet_tty_printf("\n[DEBUG USER BARRIER] dissemination node[%d] : vaddr = %x / rounds = %d\n",
+                rank, (unsigned int)node, rounds );
+#endif
+    }
+}  // end sqt_barrier_dis_build()
+
+/////////////////////////////////////////////////////////
+void sqt_barrier_init_type( giet_sqt_barrier_t*  barrier,
+                            unsigned int         x_size,    // number of clusters in a row
+                            unsigned int         y_size,    // number of clusters in a col
+                            unsigned int         ntasks,    // tasks per clusters
+                            unsigned int         type,      // barrier algorithm
+                            unsigned int         fanin )    // tree fan-in (TREE only)
+{
+    if ( type == SQT_BARRIER_QUAD ) 
+    {
+        sqt_barrier_init( barrier, x_size, y_size, ntasks );
+        return;
+    }
+
+    // check parameters
+    if ( x_size > 16 ) giet_exit("SQT BARRIER ERROR : x_size too large");
+    if ( y_size > 16 ) giet_exit("SQT BARRIER ERROR : y_size too large");
+    if ( ntasks > 8  ) giet_exit("SQT BARRIER ERROR : ntasks too large");
+    if ( (type != SQT_BARRIER_TREE) && (type != SQT_BARRIER_DISSEMINATION) )
+        giet_exit("SQT BARRIER ERROR : illegal barrier type");
+    if ( (type == SQT_BARRIER_TREE) && (fanin < 2) ) 
+        giet_exit("SQT BARRIER ERROR : fanin must be larger than 1");
+
+    unsigned int ntotal = x_size * y_size * ntasks;
+
+    barrier->type   = type;
+    barrier->y_size = y_size;
+    barrier->ntasks = ntasks;
+    barrier->entry  = remote_malloc( ntotal * sizeof(void*), 0, 0 );
+
+    if ( type == SQT_BARRIER_TREE ) sqt_barrier_tree_build( barrier, ntotal, fanin );
+    else                            sqt_barrier_dis_build( barrier, ntotal );
+
+    asm volatile ("sync" ::: "memory");
+
+}  // end sqt_barrier_init_type()
+
+
+///////////////////////////////////////////////////
+static
+void sqt_barrier_decrement( sqt_node_t*  node,
+                            unsigned int sleep )
 {
     // This recursive function decrements the distributed "count" variables,
     // traversing the SQT from bottom to root.
@@ -317,13 +517,17 @@ giet_tty_printf("\n[DEBUG USER BARRIER] P[%d,%d,%d] decrement SQT barrier node %
     {
         // decrement the parent node if the current node is not the root
         if ( node->parent != NULL )      {
-            sqt_barrier_decrement( node->parent );
+            sqt_barrier_decrement( node->parent, sleep );
         }
 
         // reset the current node
         node->sense = expected;
         node->count = node->arity;
 
+        // wake up the tasks blocked on the sense flag if any
+        asm volatile ("sync" ::: "memory");
+        if ( node->waiters ) giet_futex_wake( &node->sense, 0xFFFFFFFF );
+
 #if GIET_DEBUG_USER_BARRIER
 giet_tty_printf("\n[DEBUG USER BARRIER] P[%d,%d,%d] reset SQT barrier node %x :\n"
                 " level = %d / arity = %d / sense = %d / count = %d\n",
@@ -332,7 +536,12 @@ giet_tty_printf("\n[DEBUG USER BARRIER] P[%d,%d,%d] reset SQT barrier node %x :\
 #endif
         return;
     }
-    else                 // not the last task
+    else if ( sleep )    // not the last task / blocking
+    {
+        spin_then_sleep( &node->sense, 1 - expected, &node->waiters );
+        return;
+    }
+    else                 // not the last task / busy waiting
     {
         // poll sense flag
         // input: pointer on the sens flag (psense)
@@ -348,8 +557,57 @@ giet_tty_printf("\n[DEBUG USER BARRIER] P[%d,%d,%d] reset SQT barrier node %x :\
     }
 } // end sqt_decrement()
     
-////////////////////////////////////////////////////
-void sqt_barrier_wait( giet_sqt_barrier_t* barrier )
+///////////////////////////////////////////////////
+static
+void sqt_barrier_dis_wait( sqt_dis_node_t*  node,
+                           unsigned int     sleep )
+{
+    // In each round, the calling task signals its partner, writing the flag
+    // in the partner local memory, and waits the signal from the task
+    // (rank - 2**round) on its own local flag. The parity selects between
+    // two sets of flags, and the sense is toggled every two episodes, 
+    // so that the flags never need to be reset.
+
+    unsigned int  parity = node->parity;
+    unsigned int  sense  = node->sense;
+    unsigned int  r;
+
+    for ( r = 0 ; r < node->rounds ; r++ )
+    {
+        sqt_dis_node_t* partner = node->partner[r];
+
+        // signal partner, and wake it up if blocked
+        partner->flag[parity][r] = sense;
+        asm volatile ("sync" ::: "memory");
+        if ( partner->waiters ) giet_futex_wake( &partner->flag[parity][r], 0xFFFFFFFF );
+
+        if ( sleep )    // polling, then blocked on the local flag
+        {
+            spin_then_sleep( &node->flag[parity][r], 1 - sense, &node->waiters );
+        }
+        else            // busy waiting on the local flag
+        {
+            // input: pointer on the local flag (pflag)
+            // input: expected flag value (sense)
+            unsigned int* pflag = &node->flag[parity][r];
+            asm volatile ( "5678:                            \n"
+                           "lw    $3,   0(%0)                \n"
+                           "bne   $3,   %1,    5678b         \n"
+                           :
+                           : "r"(pflag), "r"(sense)
+                           : "$3" );
+        }
+    }
+
+    if ( parity == 1 ) node->sense = 1 - sense;
+    node->parity = 1 - parity;
+
+}  // end sqt_barrier_dis_wait()
+    
+/////////////////////////////////////////////////////////
+static
+void sqt_barrier_wait_generic( giet_sqt_barrier_t* barrier,
+                               unsigned int        sleep )
 {
     // compute cluster coordinates for the calling task
     unsigned int    x;
@@ -361,12 +619,183 @@ giet_tty_printf("[DEBUG SQT USER BARRIER] proc[%d,%d,%d] enters sqt_barrier_wait
                 x, y, lpid, barrier, barrier->node[x][y][0] );
 #endif
 
-    // recursively decrement count from bottom to root
-    sqt_barrier_decrement( barrier->node[x][y][0] );
+    if ( barrier->type == SQT_BARRIER_QUAD )
+    {
+        // recursively decrement count from bottom to root
+        sqt_barrier_decrement( barrier->node[x][y][0], sleep );
+    }
+    else
+    {
+        if ( lpid >= barrier->ntasks ) 
+            giet_exit("SQT BARRIER ERROR : calling processor not in barrier");
+
+        unsigned int rank = (((x * barrier->y_size) + y) * barrier->ntasks) + lpid;
+
+        if ( barrier->type == SQT_BARRIER_TREE ) 
+            sqt_barrier_decrement( barrier->entry[rank], sleep );
+        else
+            sqt_barrier_dis_wait( barrier->entry[rank], sleep );
+    }
+
+    asm volatile ("sync" ::: "memory");
+
+}  // end sqt_barrier_wait_generic()
+
+////////////////////////////////////////////////////
+void sqt_barrier_wait( giet_sqt_barrier_t* barrier )
+{
+    sqt_barrier_wait_generic( barrier, 0 );
+}
+
+//////////////////////////////////////////////////////////
+void sqt_barrier_wait_sleep( giet_sqt_barrier_t* barrier )
+{
+    sqt_barrier_wait_generic( barrier, 1 );
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+//      SQT allreduce access functions
+///////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////
+static
+unsigned long long sqt_reduce_op( unsigned long long a,
+                                  unsigned long long b,
+                                  unsigned int       op )
+{
+    if      ( op == SQT_REDUCE_MIN ) return (a < b) ? a : b;
+    else if ( op == SQT_REDUCE_MAX ) return (a > b) ? a : b;
+    else                             return a + b;
+}
+
+///////////////////////////////////////////////////
+static
+unsigned long long sqt_reduce_up( sqt_node_t*         node,
+                                  unsigned long long  value,
+                                  unsigned int        op )
+{
+    // This recursive function combines the value in the node, traversing 
+    // the SQT from bottom to root. The partial value and the count are
+    // updated under the node lock (64 bits values cannot be updated with
+    // LL/SC). The last arrived task carries the node partial value to the
+    // parent node, registers the result returned by the parent, and resets
+    // the node before toggling the sense flag. The other tasks wait the sense
+    // flag, and return the registered result.
+
+    // compute expected sense value 
+    unsigned int expected;
+    
+    if ( node->sense == 0) expected = 1;
+    else                   expected = 0;
+
+    // take the node lock
+    // - input : lock address (plock)
+    unsigned int* plock = &node->lock;
+
+    asm volatile( "1:                                \n"
+                  "ll     $8,     0(%0)              \n"
+                  "bnez   $8,     1b                 \n"
+                  "li     $9,     1                  \n"
+                  "sc     $9,     0(%0)              \n"
+                  "beqz   $9,     1b                 \n"
+                  :
+                  : "r" (plock)
+                  : "$8", "$9", "memory" );
+
+    // combine value and decrement count
+    if ( node->count == node->arity ) node->value = value;
+    else node->value = sqt_reduce_op( node->value, value, op );
+
+    unsigned int count = node->count;
+    node->count = count - 1;
+
+    // release the node lock
+    asm volatile ("sync" ::: "memory");
+    node->lock = 0;
+
+    if ( count == 1 )    // last task  
+    {
+        unsigned long long result;
+
+        // combine in the parent node if the current node is not the root
+        if ( node->parent != NULL ) result = sqt_reduce_up( node->parent, node->value, op );
+        else                        result = node->value;
+
+        // register result and reset the current node
+        node->result = result;
+        node->count  = node->arity;
+        asm volatile ("sync" ::: "memory");
+        node->sense  = expected;
+
+        // wake up the tasks blocked on the sense flag if any
+        asm volatile ("sync" ::: "memory");
+        if ( node->waiters ) giet_futex_wake( &node->sense, 0xFFFFFFFF );
+
+        return result;
+    }
+    else                 // not the last task / busy waiting
+    {
+        // poll sense flag
+        // input: pointer on the sens flag (psense)
+        // input: expected sense value (expected)
+        unsigned int* psense  = (unsigned int *)&node->sense;
+        asm volatile ( "5678:                            \n"
+                       "lw    $3,   0(%0)                \n"
+                       "bne   $3,   %1,    5678b         \n"
+                       :
+                       : "r"(psense), "r"(expected)
+                       : "$3", "memory" );
+
+        return node->result;
+    }
+} // end sqt_reduce_up()
+
+////////////////////////////////////////////////////////////////////
+unsigned long long sqt_allreduce64( giet_sqt_barrier_t*  barrier,
+                                    unsigned long long   value,
+                                    unsigned int         op )
+{
+    unsigned int        x;
+    unsigned int        y;
+    unsigned int        lpid;
+    sqt_node_t*         node;
+    unsigned long long  result;
+
+    giet_proc_xyp( &x, &y, &lpid );
+
+    if ( barrier->type == SQT_BARRIER_QUAD ) 
+    {
+        node = barrier->node[x][y][0];
+    }
+    else if ( barrier->type == SQT_BARRIER_TREE )
+    {
+        if ( lpid >= barrier->ntasks ) 
+            giet_exit("SQT BARRIER ERROR : calling processor not in barrier");
+
+        node = barrier->entry[(((x * barrier->y_size) + y) * barrier->ntasks) + lpid];
+    }
+    else
+    {
+        giet_exit("SQT BARRIER ERROR : allreduce not supported by this barrier type");
+        return 0;
+    }
+
+    result = sqt_reduce_up( node, value, op );
 
     asm volatile ("sync" ::: "memory");
 
-}  // end sqt_barrier_wait()
+    return result;
+
+}  // end sqt_allreduce64()
+
+/////////////////////////////////////////////////////////
+unsigned int sqt_allreduce( giet_sqt_barrier_t*  barrier,
+                            unsigned int         value,
+                            unsigned int         op )
+{
+    return (unsigned int)sqt_allreduce64( barrier, (unsigned long long)value, op );
+}
+
 
 
 // Local Variables:
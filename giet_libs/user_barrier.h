@@ -20,8 +20,34 @@
 //    - The number of involved tasks in a cluster is the same in all clusters.
 //    - The involved clusters form a mesh[x_size * y_size]
 //    - The lower left involved cluster is cluster(0,0)  
+//    The sqt_barrier_init_type() function selects at initialisation time an
+//    alternative algorithm behind the same giet_sqt_barrier_t API:
+//    - SQT_BARRIER_QUAD : the default Synchro-Quad-Tree (one node per cluster
+//      and per level, fan-in of 4 between levels).
+//    - SQT_BARRIER_TREE : a combining tree, whose fan-in is defined by the
+//      "fanin" argument. The tasks are ranked in (x,y,lpid) order, and each
+//      group of "fanin" consecutive tasks (or nodes) shares one node, that is
+//      allocated in the cluster containing the first task of the group.
+//    - SQT_BARRIER_DISSEMINATION : a dissemination barrier (no combining):
+//      in each of the log2(N) rounds, each task writes a flag in the local
+//      memory of its partner (rank + 2**round), and polls a flag in its own
+//      local memory.
+//    For the TREE and DISSEMINATION variants, the calling task must run on a
+//    processor lpid < ntasks, and the table of per task entry nodes is
+//    allocated in the heap of cluster(0,0).
+//
+// The sqt_allreduce() and sqt_allreduce64() functions are fused barrier and
+// reduction operations on unsigned 32 or 64 bits values (SQT_REDUCE_SUM, 
+// SQT_REDUCE_MIN or SQT_REDUCE_MAX): the values are combined in the SQT nodes
+// on the way up, and the result is broadcast to all tasks on the way down.
+// They can be used with the QUAD and TREE variants, on the same barrier
+// as sqt_barrier_wait().
 //
 // Neither the barrier_init(), nor the barrier_wait() function require a syscall.
+// The barrier_wait_sleep() and sqt_barrier_wait_sleep() variants poll the
+// sense flag GIET_USER_SPIN_MAX times, and then deschedule the calling task 
+// on a futex, to release the processor when the barrier is not reached.
+// The busy waiting and blocking variants can be mixed on the same barrier.
 // For both types of barriers, the barrier initialisation should be done by
 // one single task.
 ///////////////////////////////////////////////////////////////////////////////////
@@ -38,6 +64,7 @@ typedef struct giet_barrier_s
     unsigned int sense;      // barrier state (toggle)
     unsigned int arity;      // total number of expected tasks
     unsigned int count;      // number of not arrived tasks
+    unsigned int waiters;    // number of tasks blocked on a futex
 } giet_barrier_t;
 
 ///////////////////////////////////////////////////
@@ -47,6 +74,9 @@ extern void barrier_init( giet_barrier_t* barrier,
 ////////////////////////////////////////////////////
 extern void barrier_wait( giet_barrier_t* barrier );
 
+//////////////////////////////////////////////////////////
+extern void barrier_wait_sleep( giet_barrier_t* barrier );
+
 //////////////////////////////////////////////////////////////////////////////////
 // SQT barrier structures and access functions
 //////////////////////////////////////////////////////////////////////////////////
@@ -56,15 +86,40 @@ typedef struct sqt_node_s
     unsigned int       arity;        // number of expected tasks
     unsigned int       count;        // number of not arrived tasks
     unsigned int       sense;        // barrier state (toggle)
+    unsigned int       waiters;      // number of tasks blocked on a futex
     unsigned int       level;        // hierarchical level (0 is bottom)
     struct sqt_node_s* parent;       // pointer on parent node (NULL for root)
     struct sqt_node_s* child[4];     // pointer on children node (NULL for bottom)
-    unsigned int       padding[7];   // for 64 bytes alignment
+    unsigned long long value;        // partial reduction value (allreduce)
+    unsigned long long result;       // final reduction value (allreduce)
+    unsigned int       lock;         // partial value lock (allreduce)
+    unsigned int       padding[1];   // for 64 bytes alignment
 } sqt_node_t;
 
+#define SQT_BARRIER_QUAD            0
+#define SQT_BARRIER_TREE            1
+#define SQT_BARRIER_DISSEMINATION   2
+
+#define SQT_BARRIER_ROUNDS_MAX      12      // log2(16 * 16 * 8) rounded up
+
+typedef struct sqt_dis_node_s
+{
+    unsigned int           flag[2][SQT_BARRIER_ROUNDS_MAX];    // [parity][round] 
+    struct sqt_dis_node_s* partner[SQT_BARRIER_ROUNDS_MAX];    // partner per round
+    unsigned int           rounds;       // number of rounds
+    unsigned int           parity;       // current flags set (private)
+    unsigned int           sense;        // current flag value (private)
+    unsigned int           waiters;      // number of tasks blocked on a futex
+    unsigned int           padding[24];  // for 64 bytes alignment
+} sqt_dis_node_t;
+
 typedef struct giet_sqt_barrier_s 
 {
-    sqt_node_t*     node[16][16][5];    // array of pointers on SQT nodes 
+    sqt_node_t*     node[16][16][5];    // array of pointers on SQT nodes (QUAD)
+    void**          entry;              // per task entry node (TREE / DISSEMINATION)
+    unsigned int    type;               // barrier algorithm
+    unsigned int    y_size;             // number of clusters in a column
+    unsigned int    ntasks;             // number of tasks per cluster
 } giet_sqt_barrier_t;
 
 ///////////////////////////////////////////////////////////
@@ -73,9 +128,34 @@ extern void sqt_barrier_init( giet_sqt_barrier_t*  barrier,
                               unsigned int         y_size,
                               unsigned int         ntasks );   
 
+////////////////////////////////////////////////////////////////
+extern void sqt_barrier_init_type( giet_sqt_barrier_t*  barrier,
+                                   unsigned int         x_size,
+                                   unsigned int         y_size,
+                                   unsigned int         ntasks,
+                                   unsigned int         type,
+                                   unsigned int         fanin );   
+
 /////////////////////////////////////////////////////////////
 extern void sqt_barrier_wait( giet_sqt_barrier_t*  barrier );
 
+///////////////////////////////////////////////////////////////////
+extern void sqt_barrier_wait_sleep( giet_sqt_barrier_t*  barrier );
+
+#define SQT_REDUCE_SUM              0
+#define SQT_REDUCE_MIN              1
+#define SQT_REDUCE_MAX              2
+
+////////////////////////////////////////////////////////////////
+extern unsigned int sqt_allreduce( giet_sqt_barrier_t*  barrier,
+                                   unsigned int         value,
+                                   unsigned int         op );
+
+//////////////////////////////////////////////////////////////////////////
+extern unsigned long long sqt_allreduce64( giet_sqt_barrier_t*  barrier,
+                                           unsigned long long   value,
+                                           unsigned int         op );
+
 
 #endif
 
@@ -0,0 +1,65 @@
+//////////////////////////////////////////////////////////////////////////////////
+// File     : user_cond.c
+// Date     : 01/10/2015
+// Author   : alain greiner
+// Copyright (c) UPMC-LIP6
+///////////////////////////////////////////////////////////////////////////////////
+// The user_cond.c and user_cond.h files are part of the GIET-VM nano-kernel.
+///////////////////////////////////////////////////////////////////////////////////
+
+#include "user_cond.h"
+#include "user_lock.h"
+#include "giet_config.h"
+#include "stdio.h"
+
+/////////////////////////////////////
+void cond_init( user_cond_t* cond )
+{
+    cond->seq     = 0;
+    cond->waiters = 0;
+
+    asm volatile ("sync" ::: "memory");
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// The sequence number is read before releasing the lock, so that a signal
+// sent between the lock release and the blocking is not lost.
+//////////////////////////////////////////////////////////////////////////////////
+void cond_wait( user_cond_t* cond,
+                user_lock_t* lock )
+{
+    unsigned int seq = *(volatile unsigned int*)&cond->seq;
+
+    lock_release( lock );
+
+    spin_then_sleep( &cond->seq, seq, &cond->waiters );
+
+    lock_acquire_sleep( lock );
+}
+
+///////////////////////////////////////
+void cond_signal( user_cond_t* cond )
+{
+    atomic_increment( &cond->seq, 1 );
+
+    asm volatile ("sync" ::: "memory");
+    if ( cond->waiters ) giet_futex_wake( &cond->seq, 1 );
+}
+
+//////////////////////////////////////////
+void cond_broadcast( user_cond_t* cond )
+{
+    atomic_increment( &cond->seq, 1 );
+
+    asm volatile ("sync" ::: "memory");
+    if ( cond->waiters ) giet_futex_wake( &cond->seq, 0xFFFFFFFF );
+}
+
+// Local Variables:
+// tab-width: 4
+// c-basic-offset: 4
+// c-file-offsets:((innamespace . 0)(inline-open . 0))
+// indent-tabs-mode: nil
+// End:
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=4:softtabstop=4
+
@@ -0,0 +1,59 @@
+//////////////////////////////////////////////////////////////////////////////////
+// File     : user_cond.h
+// Date     : 01/10/2015
+// Author   : alain greiner
+// Copyright (c) UPMC-LIP6
+///////////////////////////////////////////////////////////////////////////////////
+// The user_cond.c and user_cond.h files are part of the GIET-VM nano-kernel.
+// This user-level library provides condition variables, associated to a
+// user_lock_t protecting the shared state:
+// - cond_wait() releases the lock, blocks the calling task until the condition
+//   is signaled, and takes the lock again before returning.
+// - cond_signal() wakes up one blocked task, cond_broadcast() wakes up all
+//   blocked tasks. They can be called with or without the lock.
+// The implementation uses a sequence number, modified by each signal: a waiting
+// task polls this number GIET_USER_SPIN_MAX times, and then deschedules on
+// a futex (or yields the processor if the GIET_USER_FUTEX parameter is zero).
+// As a signal can wake up several polling tasks, cond_wait() must be called
+// in a loop re-evaluating the predicate.
+///////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _USER_COND_H_
+#define _USER_COND_H_
+
+#include "user_lock.h"
+
+///////////////////////////////////////////////////////////////////////////////////
+//  condition variable structure
+///////////////////////////////////////////////////////////////////////////////////
+
+typedef struct user_cond_s 
+{
+    unsigned int seq;            // incremented by each signal / broadcast
+    unsigned int waiters;        // number of tasks blocked on a futex
+    unsigned int padding[14];    // for 64 bytes alignment
+} user_cond_t;
+
+///////////////////////////////////////////////////////////////////////////////////
+//  access functions
+///////////////////////////////////////////////////////////////////////////////////
+
+extern void cond_init( user_cond_t* cond );
+
+extern void cond_wait( user_cond_t* cond,
+                       user_lock_t* lock );
+
+extern void cond_signal( user_cond_t* cond );
+
+extern void cond_broadcast( user_cond_t* cond );
+
+#endif
+
+// Local Variables:
+// tab-width: 4
+// c-basic-offset: 4
+// c-file-offsets:((innamespace . 0)(inline-open . 0))
+// indent-tabs-mode: nil
+// End:
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=4:softtabstop=4
+
@@ -11,6 +11,34 @@
 #include "giet_config.h"
 #include "stdio.h"
 
+#if GIET_LOCK_PROFILING
+
+//////////////////////////////////////////////////////////////////////////////////
+//      Registered locks for profiling
+//////////////////////////////////////////////////////////////////////////////////
+
+unsigned int  lock_stats_count = 0;
+
+user_lock_t*  lock_stats_table[GIET_LOCK_STATS_MAX];
+
+//////////////////////////////////////////////////////////////////////////////////
+// This function is called by the lock owner just after the acquisition.
+// <start> is the date of the acquisition request.
+//////////////////////////////////////////////////////////////////////////////////
+static void lock_stats_acquired( user_lock_t*  lock,
+                                 unsigned int  start,
+                                 unsigned int  contended )
+{
+    unsigned int date = giet_proctime();
+
+    lock->stats.acquires++;
+    if ( contended ) lock->stats.contended++;
+    lock->stats.wait = lock->stats.wait + (date - start);
+    lock->stats.date = date;
+}
+
+#endif
+
 //////////////////////////////////////////////////////////////////////////////////
 // This function uses LL/SC to make an atomic increment. 
 //////////////////////////////////////////////////////////////////////////////////
@@ -35,14 +63,128 @@ unsigned int atomic_increment( unsigned int*  ptr,
     return value;
 }
 
+//////////////////////////////////////////////////////////////////////////////////
+// This function uses LL/SC to make an atomic compare and swap. 
+// It returns 1 if the word pointed by <ptr> was equal to <old>, and has been
+// replaced by <new>. It returns 0 otherwise.
+//////////////////////////////////////////////////////////////////////////////////
+unsigned int atomic_cas( void*         ptr,
+                         unsigned int  old,
+                         unsigned int  new )
+{
+    unsigned int success;
+
+    asm volatile (
+        "move %0,    $0                \n"   /* success <= 0             */
+        "1:                            \n"
+        "ll   $10,   0(%1)             \n"   /* $10 <= *ptr              */
+        "bne  $10,   %2,     2f        \n"   /* failure if *ptr != old   */
+        "move $11,   %3                \n"   /* $11 <= new               */
+        "sc   $11,   0(%1)             \n"   /* M[ptr] <= new            */
+        "beqz $11,   1b                \n"   /* retry if failure         */
+        "li   %0,    1                 \n"   /* success <= 1             */
+        "2:                            \n"
+        : "=&r" (success)
+        : "r" (ptr), "r" (old), "r" (new)
+        : "$10", "$11", "memory" );
+
+    return success;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// This blocking function returns when the word pointed by <ptr> is no longer
+// equal to <value>. It polls the word GIET_USER_SPIN_MAX times, and then 
+// deschedules the calling task on a futex. The <waiters> counter is 
+// incremented while the task is blocked, to let the writer know that it 
+// must call giet_futex_wake() after modifying the word.
+// When the GIET_USER_FUTEX parameter is zero, the calling task yields the
+// processor (giet_context_switch()) until the word is modified.
+///////////////////////////////////////////////////////////////////////////////////
+void spin_then_sleep( unsigned int* ptr,
+                      unsigned int  value,
+                      unsigned int* waiters )
+{
+    volatile unsigned int* word = ptr;
+    unsigned int           iter;
+
+    // polling phase
+    for ( iter = 0 ; iter < GIET_USER_SPIN_MAX ; iter++ )
+    {
+        if ( *word != value ) return;
+    }
+
+#if GIET_USER_FUTEX
+
+    // blocking phase
+    atomic_increment( waiters, 1 );
+    asm volatile( "sync" );
+
+    while ( *word == value ) giet_futex_wait( ptr, value );
+
+    atomic_increment( waiters, 0xFFFFFFFF );
+
+#else
+
+    // yielding phase (the waiters counter is not used)
+    while ( *word == value ) giet_context_switch();
+
+#endif
+}
+
+#if GIET_LOCK_BACKOFF
+
+///////////////////////////////////////////////////////////////////////////////////
+// This function polls the lock current index until it is equal to <ticket>,
+// with a proportional backoff between two polls. The number of hops to the 
+// lock cluster is only computed when the lock is not immediately granted.
+///////////////////////////////////////////////////////////////////////////////////
+static void lock_ticket_wait( user_lock_t*  lock,
+                              unsigned int  ticket )
+{
+    volatile unsigned int* current = &lock->current;
+    unsigned int           value;
+    unsigned int           hops = 0xFFFFFFFF;     // not yet computed
+    unsigned int           delay;
+
+    while ( (value = *current) != ticket )
+    {
+        if ( hops == 0xFFFFFFFF )
+        {
+            unsigned int x;
+            unsigned int y;
+            unsigned int lpid;
+            giet_proc_xyp( &x, &y, &lpid );
+
+            hops = ((x > lock->x) ? (x - lock->x) : (lock->x - x)) + 
+                   ((y > lock->y) ? (y - lock->y) : (lock->y - y));
+        }
+
+        delay = (ticket - value - 1) * GIET_LOCK_BACKOFF_BASE * (hops + 1);
+        if ( delay > GIET_LOCK_BACKOFF_MAX ) delay = GIET_LOCK_BACKOFF_MAX;
+
+        while ( delay-- ) asm volatile ("nop");
+    }
+}
+
+#endif
+
 ///////////////////////////////////////////////////////////////////////////////////
 // This blocking function returns only when the lock has been taken.
 ///////////////////////////////////////////////////////////////////////////////////
 void lock_acquire( user_lock_t* lock ) 
 {
+
+#if GIET_LOCK_PROFILING
+    unsigned int start = giet_proctime();
+#endif
+
     // get next free slot index from user_lock
     unsigned int ticket = atomic_increment( &lock->free, 1 );
 
+#if GIET_LOCK_PROFILING
+    unsigned int contended = ( *(volatile unsigned int*)&lock->current != ticket );
+#endif
+
 #if GIET_DEBUG_USER_LOCK
 unsigned int    x;
 unsigned int    y;
@@ -55,6 +197,9 @@ giet_tty_printf("\n[USER_LOCK DEBUG] P[%d,%d,%d] get ticket = %d"
 #endif
 
     // poll the current slot index
+#if GIET_LOCK_BACKOFF
+    lock_ticket_wait( lock, ticket );
+#else
     asm volatile("1793:                       \n"
                  "lw   $10,  0(%0)            \n"
                  "move $11,  %1               \n"
@@ -62,6 +207,11 @@ giet_tty_printf("\n[USER_LOCK DEBUG] P[%d,%d,%d] get ticket = %d"
                  :
                  : "r"(lock), "r"(ticket)
                  : "$10", "$11" );
+#endif
+
+#if GIET_LOCK_PROFILING
+    lock_stats_acquired( lock, start, contended );
+#endif
                
 #if GIET_DEBUG_USER_LOCK
 giet_tty_printf("\n[USER_LOCK DEBUG] P[%d,%d,%d] get lock %x"
@@ -72,15 +222,77 @@ giet_tty_printf("\n[USER_LOCK DEBUG] P[%d,%d,%d] get lock %x"
 
 }
 
+///////////////////////////////////////////////////////////////////////////////////
+// This blocking function returns only when the lock has been taken.
+// The calling task is descheduled when the lock is not granted after
+// GIET_USER_SPIN_MAX polling iterations.
+///////////////////////////////////////////////////////////////////////////////////
+void lock_acquire_sleep( user_lock_t* lock ) 
+{
+    volatile unsigned int* current = &lock->current;
+    unsigned int           value;
+
+#if GIET_LOCK_PROFILING
+    unsigned int start = giet_proctime();
+#endif
+
+    // get next free slot index from user_lock
+    unsigned int ticket = atomic_increment( &lock->free, 1 );
+
+#if GIET_LOCK_PROFILING
+    unsigned int contended = ( *current != ticket );
+#endif
+
+#if GIET_DEBUG_USER_LOCK
+unsigned int    x;
+unsigned int    y;
+unsigned int    lpid;
+giet_proc_xyp( &x, &y, &lpid );
+giet_tty_printf("\n[USER_LOCK DEBUG] P[%d,%d,%d] get ticket = %d"
+                " for lock %x at cycle %d (current = %d / free = %d)\n",
+                x, y, lpid, ticket, 
+                (unsigned int)lock, giet_proctime(), lock->current, lock->free );
+#endif
+
+    // wait on the current slot index 
+    while ( (value = *current) != ticket ) 
+    {
+        spin_then_sleep( &lock->current, value, &lock->waiters );
+    }
+
+#if GIET_LOCK_PROFILING
+    lock_stats_acquired( lock, start, contended );
+#endif
+
+#if GIET_DEBUG_USER_LOCK
+giet_tty_printf("\n[USER_LOCK DEBUG] P[%d,%d,%d] get lock %x"
+                " at cycle %d (current = %d / free = %d)\n",
+                x, y, lpid, (unsigned int)lock, 
+                giet_proctime(), lock->current, lock->free );
+#endif
+
+}
+
 //////////////////////////////////////////////////////////////////////////////
-// This function releases the lock.
+// This function releases the lock, and wakes up the blocked tasks if any
+// (they must all be woken up, as only one of them owns the next ticket).
 //////////////////////////////////////////////////////////////////////////////
 void lock_release( user_lock_t* lock ) 
 {
+
+#if GIET_LOCK_PROFILING
+    unsigned int hold = giet_proctime() - lock->stats.date;
+    if ( hold > lock->stats.max_hold ) lock->stats.max_hold = hold;
+#endif
+
     asm volatile( "sync" );
 
     lock->current = lock->current + 1;
 
+    asm volatile( "sync" );
+
+    if ( lock->waiters ) giet_futex_wake( &lock->current, 0xFFFFFFFF );
+
 #if GIET_DEBUG_USER_LOCK
 unsigned int    x;
 unsigned int    y;
@@ -101,6 +313,40 @@ void lock_init( user_lock_t* lock )
 {
     lock->current = 0;
     lock->free    = 0;
+    lock->waiters = 0;
+    lock->x       = 0;
+    lock->y       = 0;
+
+#if GIET_LOCK_BACKOFF
+    giet_get_xy( lock, &lock->x, &lock->y );
+#endif
+
+#if GIET_LOCK_PROFILING
+    unsigned int i;
+
+    lock->stats.acquires  = 0;
+    lock->stats.contended = 0;
+    lock->stats.wait      = 0;
+    lock->stats.max_hold  = 0;
+    lock->stats.date      = 0;
+
+    // register the lock if not already registered : the slot is claimed
+    // with an atomic increment, and the registration is dropped when
+    // the table is full (lock_stats_count can be larger than the table)
+    unsigned int nlocks = lock_stats_count;
+
+    if ( nlocks > GIET_LOCK_STATS_MAX ) nlocks = GIET_LOCK_STATS_MAX;
+
+    for ( i = 0 ; i < nlocks ; i++ )
+    {
+        if ( lock_stats_table[i] == lock ) break;
+    }
+    if ( i == nlocks )
+    {
+        i = atomic_increment( &lock_stats_count, 1 );
+        if ( i < GIET_LOCK_STATS_MAX ) lock_stats_table[i] = lock;
+    }
+#endif
 
 #if GIET_DEBUG_USER_LOCK
 unsigned int    x;
@@ -115,6 +361,247 @@ giet_tty_printf("\n[USER_LOCK DEBUG] P[%d,%d,%d] init lock %x"
 
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// This function displays the statistics of the <count> registered locks
+// with the largest cumulated waiting time, in decreasing order.
+//////////////////////////////////////////////////////////////////////////////
+void lock_stats_print( unsigned int count )
+{
+
+#if GIET_LOCK_PROFILING
+    unsigned char selected[GIET_LOCK_STATS_MAX];
+    unsigned int  nlocks = lock_stats_count;
+    unsigned int  n;
+    unsigned int  i;
+
+    if ( nlocks > GIET_LOCK_STATS_MAX ) nlocks = GIET_LOCK_STATS_MAX;
+    if ( count  > nlocks )              count  = nlocks;
+
+    // a slot claimed by a concurrent registration can be not yet written
+    for ( i = 0 ; i < nlocks ; i++ ) selected[i] = (lock_stats_table[i] == NULL);
+
+    for ( n = 0 ; n < count ; n++ )
+    {
+        // select the not yet selected lock with the largest waiting time
+        unsigned int max   = 0;
+        unsigned int found = 0;
+
+        for ( i = 0 ; i < nlocks ; i++ )
+        {
+            if ( (selected[i] == 0) && 
+                 ((found == 0) || (lock_stats_table[i]->stats.wait > max)) )
+            {
+                max   = lock_stats_table[i]->stats.wait;
+                found = i + 1;
+            }
+        }
+
+        if ( found == 0 ) break;
+
+        user_lock_t* lock = lock_stats_table[found - 1];
+        selected[found - 1] = 1;
+
+        giet_tty_printf(" - lock %x : acquires = %d / contended = %d"
+                        " / wait = %d / max_hold = %d\n",
+                        (unsigned int)lock, lock->stats.acquires, 
+                        lock->stats.contended, lock->stats.wait, 
+                        lock->stats.max_hold );
+    }
+#else
+    giet_tty_printf(" - locks profiling not enabled\n");
+#endif
+
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+//      MCS queue lock
+// In the lock, the "tail" field is NULL when the lock is free, points on the 
+// lock itself when the lock is taken without waiting task, and points on the
+// last queued node otherwise. The "next" field points on the first waiting
+// node. In a queue node, the "tail" field is MCS_WAITING until the lock is
+// granted to the waiting task, and the "next" field points on the next node.
+//////////////////////////////////////////////////////////////////////////////////
+
+#define MCS_WAITING    ((mcs_lock_t*)1)
+
+//////////////////////////////////////////////////////////////////////////////////
+// This generic function implements both mcs_lock_acquire() and 
+// mcs_lock_acquire_sleep(). The queue node is allocated in the stack of the
+// calling task, and is not used anymore when the lock has been granted:
+// the next waiting node is registered in the lock itself.
+//////////////////////////////////////////////////////////////////////////////////
+static void mcs_lock_acquire_generic( mcs_lock_t*  lock,
+                                      unsigned int sleep )
+{
+    mcs_lock_t* volatile* ptail = (mcs_lock_t* volatile*)&lock->tail;
+    mcs_lock_t*           prev;
+    mcs_lock_t*           succ;
+    mcs_lock_t            node;
+
+    while ( 1 )
+    {
+        prev = *ptail;
+
+        if ( prev == NULL )    // lock free => try to take it without queue node
+        {
+            if ( atomic_cas( &lock->tail, 0, (unsigned int)lock ) ) break;
+        }
+        else                   // lock taken => try to register in queue
+        {
+            node.tail    = MCS_WAITING;
+            node.next    = NULL;
+            node.waiters = 0;
+
+            if ( atomic_cas( &lock->tail, (unsigned int)prev, (unsigned int)&node ) )
+            {
+                // link the node to the previous one
+                ((mcs_lock_t* volatile)prev)->next = &node;
+
+                // wait on the private queue node
+                if ( sleep )
+                {
+                    while ( *(mcs_lock_t* volatile*)&node.tail == MCS_WAITING )
+                    {
+                        spin_then_sleep( (unsigned int*)&node.tail,
+                                         (unsigned int)MCS_WAITING,
+                                         &node.waiters );
+                    }
+                }
+                else
+                {
+                    while ( *(mcs_lock_t* volatile*)&node.tail == MCS_WAITING ) 
+                    { 
+                        asm volatile ("nop");
+                    }
+                }
+
+                // lock granted : register the next node in the lock
+                succ = *(mcs_lock_t* volatile*)&node.next;
+                if ( succ == NULL )
+                {
+                    lock->next = NULL;
+
+                    // try to make the lock point on itself, or wait
+                    // the next node if a task has been registered 
+                    if ( atomic_cas( &lock->tail, (unsigned int)&node, 
+                                     (unsigned int)lock ) == 0 )
+                    {
+                        while ( (succ = *(mcs_lock_t* volatile*)&node.next) == NULL ) 
+                        {
+                            asm volatile ("nop");
+                        }
+                        lock->next = succ;
+                    }
+                }
+                else
+                {
+                    lock->next = succ;
+                }
+                break;
+            }
+        }
+    }
+
+    asm volatile( "sync" ::: "memory" );
+
+#if GIET_DEBUG_USER_LOCK
+unsigned int    x;
+unsigned int    y;
+unsigned int    lpid;
+giet_proc_xyp( &x, &y, &lpid );
+giet_tty_printf("\n[USER_LOCK DEBUG] P[%d,%d,%d] get MCS lock %x at cycle %d\n",
+                x, y, lpid, (unsigned int)lock, giet_proctime() );
+#endif
+
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// This blocking function returns only when the lock has been taken.
+///////////////////////////////////////////////////////////////////////////////////
+void mcs_lock_acquire( mcs_lock_t* lock )
+{
+    mcs_lock_acquire_generic( lock , 0 );
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// This blocking function returns only when the lock has been taken.
+// The calling task is descheduled when the lock is not granted after
+// GIET_USER_SPIN_MAX polling iterations.
+///////////////////////////////////////////////////////////////////////////////////
+void mcs_lock_acquire_sleep( mcs_lock_t* lock )
+{
+    mcs_lock_acquire_generic( lock , 1 );
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// This function releases the lock. If there is a waiting task, it grants
+// the lock to this task by writing in its queue node, and wakes it up if
+// it is blocked on a futex. The node can be deallocated as soon as it is
+// written, and the "waiters" field can therefore be read too late:
+// the futex wake-up is then spurious, but harmless.
+//////////////////////////////////////////////////////////////////////////////
+void mcs_lock_release( mcs_lock_t* lock )
+{
+    mcs_lock_t* succ = *(mcs_lock_t* volatile*)&lock->next;
+
+    asm volatile( "sync" ::: "memory" );
+
+    if ( succ == NULL )
+    {
+        // no waiting task => release the lock
+        if ( atomic_cas( &lock->tail, (unsigned int)lock, 0 ) ) 
+        {
+#if GIET_DEBUG_USER_LOCK
+unsigned int    x;
+unsigned int    y;
+unsigned int    lpid;
+giet_proc_xyp( &x, &y, &lpid );
+giet_tty_printf("\n[USER_LOCK DEBUG] P[%d,%d,%d] release MCS lock %x at cycle %d\n",
+                x, y, lpid, (unsigned int)lock, giet_proctime() );
+#endif
+            return;
+        }
+
+        // a task is registering => wait its node
+        while ( (succ = *(mcs_lock_t* volatile*)&lock->next) == NULL ) 
+        {
+            asm volatile ("nop");
+        }
+    }
+
+    // grant the lock to the first waiting task
+    *(mcs_lock_t* volatile*)&succ->tail = NULL;
+
+    asm volatile( "sync" ::: "memory" );
+
+    if ( *(volatile unsigned int*)&succ->waiters ) 
+    {
+        giet_futex_wake( (unsigned int*)&succ->tail, 1 );
+    }
+
+#if GIET_DEBUG_USER_LOCK
+unsigned int    x;
+unsigned int    y;
+unsigned int    lpid;
+giet_proc_xyp( &x, &y, &lpid );
+giet_tty_printf("\n[USER_LOCK DEBUG] P[%d,%d,%d] release MCS lock %x at cycle %d\n",
+                x, y, lpid, (unsigned int)lock, giet_proctime() );
+#endif
+
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// This function initializes the MCS lock.
+//////////////////////////////////////////////////////////////////////////////
+void mcs_lock_init( mcs_lock_t* lock )
+{
+    lock->tail    = NULL;
+    lock->next    = NULL;
+    lock->waiters = 0;
+
+    asm volatile( "sync" ::: "memory" );
+}
+
 
 // Local Variables:
 // tab-width: 4
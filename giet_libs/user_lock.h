@@ -5,22 +5,76 @@
 // Copyright (c) UPMC-LIP6
 ///////////////////////////////////////////////////////////////////////////////////
 // The file_lock.c and file_lock.h files are part of the GIET-VM nano-kernel.
+// The lock_acquire() function polls the lock until it is granted. When the
+// GIET_LOCK_BACKOFF parameter is non zero, the delay between two polls is
+// proportional to the number of tickets before the task ticket, and to the
+// number of hops between the task cluster and the lock cluster.
+// The lock_acquire_sleep() function polls the lock GIET_USER_SPIN_MAX times,
+// and deschedules the calling task on a futex (giet_futex_wait() syscall)
+// when the lock is still not granted. The lock_release() function wakes up
+// the blocked tasks if any. Both functions can be used on the same lock.
+// If the GIET_USER_FUTEX parameter is zero, the blocking functions yield the
+// processor (giet_context_switch() syscall) instead of using the futexes.
+//
+// When the GIET_LOCK_PROFILING parameter is non zero, each user_lock_t records
+// contention statistics (acquisitions, contended acquisitions, cumulated
+// waiting time and max holding time, using the giet_proctime() syscall),
+// and is registered by lock_init(). The lock_stats_print() function displays
+// the locks with the largest waiting time. The lock address can be found in
+// the appli.elf.txt file. This instrumentation is compiled out when 
+// GIET_LOCK_PROFILING is zero.
+//
+// The mcs_lock_t is a queue lock (MCS lock, in the K42 variant that does not
+// require a queue node in the lock owner): each waiting task polls a private
+// queue node allocated in its own stack, and the release only writes in the
+// node of the next waiting task. Contrary to the ticket lock, the waiting 
+// tasks do not poll a single (generally remote) word, and a release does
+// not invalidate all the L1 copies of this word.
+//
+// The cfg_lock_t type and the cfg_lock_*() functions are mapped on the ticket
+// lock or on the MCS lock, depending on the GIET_USER_MCS_LOCK parameter.
+// They are used by the mwmr channels and the work-stealing deques, and can
+// be used by the applications.
 ///////////////////////////////////////////////////////////////////////////////////
 
 #ifndef _GIET_FILE_LOCK_H_
 #define _GIET_FILE_LOCK_H_
 
+#include "giet_config.h"
+
 ///////////////////////////////////////////////////////////////////////////////////
 //  lock structure
 ///////////////////////////////////////////////////////////////////////////////////
 
+typedef struct user_lock_stats_s
+{
+    unsigned int acquires;       // number of acquisitions
+    unsigned int contended;      // number of contended acquisitions
+    unsigned int wait;           // cumulated waiting time (cycles)
+    unsigned int max_hold;       // max holding time (cycles)
+    unsigned int date;           // date of the last acquisition (cycles)
+    unsigned int unused;
+} user_lock_stats_t;
+
 typedef struct user_lock_s 
 {
-    unsigned int current;        // current slot index
-    unsigned int free;           // next free slot index
-    unsigned int padding[14];    // for 64 bytes alignment
+    unsigned int      current;   // current slot index
+    unsigned int      free;      // next free slot index
+    unsigned int      waiters;   // number of tasks blocked on a futex
+    user_lock_stats_t stats;     // contention statistics (GIET_LOCK_PROFILING)
+    unsigned int      x;         // x coordinate of cluster containing the lock
+    unsigned int      y;         // y coordinate of cluster containing the lock
+    unsigned int      padding[5];    // for 64 bytes alignment
 } user_lock_t;
 
+typedef struct mcs_lock_s
+{
+    struct mcs_lock_s* tail;     // lock : last queued node / node : waiting flag
+    struct mcs_lock_s* next;     // lock : first waiting node / node : next node
+    unsigned int       waiters;  // node : number of tasks blocked on a futex
+    unsigned int       padding[13];  // for 64 bytes alignment
+} mcs_lock_t;
+
 ///////////////////////////////////////////////////////////////////////////////////
 //  access functions
 ///////////////////////////////////////////////////////////////////////////////////
@@ -28,12 +82,56 @@ typedef struct user_lock_s
 extern unsigned int atomic_increment( unsigned int* ptr,
                                       unsigned int  increment );
 
+extern unsigned int atomic_cas( void*         ptr,
+                                unsigned int  old,
+                                unsigned int  new );
+
+extern void spin_then_sleep( unsigned int* ptr,
+                             unsigned int  value,
+                             unsigned int* waiters );
+
 extern void lock_acquire( user_lock_t * lock );
 
+extern void lock_acquire_sleep( user_lock_t * lock );
+
 extern void lock_release( user_lock_t * lock );
 
 extern void lock_init( user_lock_t * lock );
 
+extern void lock_stats_print( unsigned int count );
+
+extern void mcs_lock_acquire( mcs_lock_t * lock );
+
+extern void mcs_lock_acquire_sleep( mcs_lock_t * lock );
+
+extern void mcs_lock_release( mcs_lock_t * lock );
+
+extern void mcs_lock_init( mcs_lock_t * lock );
+
+///////////////////////////////////////////////////////////////////////////////////
+//  configurable lock 
+///////////////////////////////////////////////////////////////////////////////////
+
+#if GIET_USER_MCS_LOCK
+
+typedef mcs_lock_t   cfg_lock_t;
+
+#define cfg_lock_acquire( lock )        mcs_lock_acquire( lock )
+#define cfg_lock_acquire_sleep( lock )  mcs_lock_acquire_sleep( lock )
+#define cfg_lock_release( lock )        mcs_lock_release( lock )
+#define cfg_lock_init( lock )           mcs_lock_init( lock )
+
+#else
+
+typedef user_lock_t  cfg_lock_t;
+
+#define cfg_lock_acquire( lock )        lock_acquire( lock )
+#define cfg_lock_acquire_sleep( lock )  lock_acquire_sleep( lock )
+#define cfg_lock_release( lock )        lock_release( lock )
+#define cfg_lock_init( lock )           lock_init( lock )
+
+#endif
+
 #endif
 
 // Local Variables:
@@ -0,0 +1,261 @@
+//////////////////////////////////////////////////////////////////////////////////
+// File     : user_rwlock.c
+// Date     : 01/10/2015
+// Author   : alain greiner
+// Copyright (c) UPMC-LIP6
+///////////////////////////////////////////////////////////////////////////////////
+
+#include "user_rwlock.h"
+#include "user_sqt_lock.h"
+#include "user_lock.h"
+#include "malloc.h"
+#include "stdio.h"
+#include "giet_config.h"
+
+///////////////////////////////////////////////////////////////////////////////////
+// This recursive function initialises the node identified by the (x,y,level)
+// arguments, and all nodes in the sub-tree.
+///////////////////////////////////////////////////////////////////////////////////
+static void rwlock_build( rwlock_t*    lock,
+                          unsigned int x,         // node X coordinate
+                          unsigned int y,         // node Y coordinate
+                          unsigned int level,     // node level
+                          unsigned int xmax,      // SQT X size
+                          unsigned int ymax )     // SQT Y size
+{
+    rwlock_node_t* node = lock->node[x][y][level];
+    unsigned int   cx[4];
+    unsigned int   cy[4];
+    unsigned int   i;
+
+    node->readers = 0;
+    node->writer  = 0;
+    node->level   = level;
+
+    if ( level == 0 )        // terminal case
+    {
+        for ( i = 0 ; i < 4 ; i++ ) node->child[i] = NULL;
+        return;
+    }
+
+    // the child0 coordinates are equal to the parent coordinates
+    // other childs coordinates are incremented depending on the level value
+    cx[0] = x;
+    cy[0] = y;
+    cx[1] = x + (1 << (level-1));
+    cy[1] = y;
+    cx[2] = x;
+    cy[2] = y + (1 << (level-1));
+    cx[3] = x + (1 << (level-1));
+    cy[3] = y + (1 << (level-1));
+
+    for ( i = 0 ; i < 4 ; i++ )
+    {
+        if ( (cx[i] < xmax) && (cy[i] < ymax) ) 
+        {
+            node->child[i] = lock->node[cx[i]][cy[i]][level-1];
+            rwlock_build( lock, cx[i], cy[i], level-1, xmax, ymax );
+        }
+        else
+        {
+            node->child[i] = NULL;
+        }
+    }
+}  // end rwlock_build()
+
+///////////////////////////////////////////////////////////////////////////////////
+// This recursive function sets the writer flag in all nodes of the sub-tree,
+// from top to bottom.
+///////////////////////////////////////////////////////////////////////////////////
+static void rwlock_set_writer( rwlock_node_t* node,
+                               unsigned int   value )
+{
+    unsigned int i;
+
+    node->writer = value;
+
+    for ( i = 0 ; i < 4 ; i++ )
+    {
+        if ( node->child[i] != NULL ) rwlock_set_writer( node->child[i], value );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// This recursive function returns when all readers counters in the sub-tree
+// are zero, from bottom to top.
+///////////////////////////////////////////////////////////////////////////////////
+static void rwlock_drain( rwlock_node_t* node )
+{
+    unsigned int i;
+
+    if ( node->level == 0 )
+    {
+        while ( *(volatile unsigned int*)&node->readers != 0 ) asm volatile( "nop" );
+        return;
+    }
+
+    for ( i = 0 ; i < 4 ; i++ )
+    {
+        if ( node->child[i] != NULL ) rwlock_drain( node->child[i] );
+    }
+}
+
+//////////////////////////////////////////
+void rwlock_init( rwlock_t*    lock,
+                  unsigned int x_size,     // number of clusters in a row
+                  unsigned int y_size,     // number of clusters in a col
+                  unsigned int ntasks )    // tasks per clusters
+{
+    // check parameters
+    if ( x_size > 16 ) giet_exit("RWLOCK ERROR : x_size too large");
+    if ( y_size > 16 ) giet_exit("RWLOCK ERROR : y_size too large");
+
+    // initialise writers lock
+    sqt_lock_init( &lock->wlock, x_size, y_size, ntasks );
+
+    // compute SQT levels
+    unsigned int z = (x_size > y_size) ? x_size : y_size;
+    unsigned int levels = (z < 2) ? 1 : (z < 3) ? 2 : (z < 5) ? 3 : (z < 9) ? 4 : 5;
+
+    unsigned int x;
+    unsigned int y;
+    unsigned int l;
+
+    // allocate the nodes in the clusters heaps
+    for ( x = 0 ; x < x_size ; x++ )
+    {
+        for ( y = 0 ; y < y_size ; y++ )
+        {
+            for ( l = 0 ; l < levels ; l++ )
+            {
+                unsigned int mask = (1 << l) - 1;
+
+                if ( ((x & mask) == 0) && ((y & mask) == 0) )
+                {
+                    lock->node[x][y][l] = remote_malloc( sizeof(rwlock_node_t), x, y );
+
+#if GIET_DEBUG_USER_LOCK
+giet_tty_printf("\n[DEBUG USER RWLOCK] allocates node[%d,%d,%d] : vaddr = %x\n",
+                x , y , l , (unsigned int)lock->node[x][y][l] );
+#endif
+                }
+            }
+        }
+    }
+
+    lock->levels = levels;
+
+    // recursively initialise all nodes from root to bottom
+    rwlock_build( lock, 0, 0, levels-1, x_size, y_size );
+
+    asm volatile ("sync" ::: "memory");
+
+}  // end rwlock_init()
+
+//////////////////////////////////////////////
+void rwlock_read_acquire( rwlock_t* lock )
+{
+    unsigned int x;
+    unsigned int y;
+    unsigned int p;
+    giet_proc_xyp( &x, &y, &p );
+
+    rwlock_node_t*         node    = lock->node[x][y][0];
+    volatile unsigned int* pwriter = &node->writer;
+
+    while ( 1 )
+    {
+        // wait until no writer is active
+        while ( *pwriter ) asm volatile( "nop" );
+
+        // register as reader
+        atomic_increment( &node->readers, 1 );
+        asm volatile( "sync" ::: "memory" );
+
+        // check that no writer has been registered meanwhile
+        if ( *pwriter == 0 ) break;
+
+        // give way to the writer
+        atomic_increment( &node->readers, 0xFFFFFFFF );
+    }
+
+#if GIET_DEBUG_USER_LOCK
+giet_tty_printf("\n[DEBUG USER RWLOCK] P[%d,%d,%d] get read lock %x at cycle %d\n",
+                x , y , p , (unsigned int)lock , giet_proctime() );
+#endif
+}
+
+//////////////////////////////////////////////
+void rwlock_read_release( rwlock_t* lock )
+{
+    unsigned int x;
+    unsigned int y;
+    unsigned int p;
+    giet_proc_xyp( &x, &y, &p );
+
+    asm volatile( "sync" ::: "memory" );
+
+    atomic_increment( &lock->node[x][y][0]->readers, 0xFFFFFFFF );
+
+#if GIET_DEBUG_USER_LOCK
+giet_tty_printf("\n[DEBUG USER RWLOCK] P[%d,%d,%d] release read lock %x at cycle %d\n",
+                x , y , p , (unsigned int)lock , giet_proctime() );
+#endif
+}
+
+//////////////////////////////////////////////
+void rwlock_write_acquire( rwlock_t* lock )
+{
+    rwlock_node_t* root = lock->node[0][0][lock->levels - 1];
+
+    // exclusive access between writers
+    sqt_lock_acquire( &lock->wlock );
+
+    // block new readers in all clusters
+    rwlock_set_writer( root, 1 );
+    asm volatile( "sync" ::: "memory" );
+
+    // wait until the active readers leave
+    rwlock_drain( root );
+
+#if GIET_DEBUG_USER_LOCK
+unsigned int x;
+unsigned int y;
+unsigned int p;
+giet_proc_xyp( &x, &y, &p );
+giet_tty_printf("\n[DEBUG USER RWLOCK] P[%d,%d,%d] get write lock %x at cycle %d\n",
+                x , y , p , (unsigned int)lock , giet_proctime() );
+#endif
+}
+
+//////////////////////////////////////////////
+void rwlock_write_release( rwlock_t* lock )
+{
+    rwlock_node_t* root = lock->node[0][0][lock->levels - 1];
+
+    asm volatile( "sync" ::: "memory" );
+
+    // unblock readers in all clusters
+    rwlock_set_writer( root, 0 );
+
+    // release writers lock
+    sqt_lock_release( &lock->wlock );
+
+#if GIET_DEBUG_USER_LOCK
+unsigned int x;
+unsigned int y;
+unsigned int p;
+giet_proc_xyp( &x, &y, &p );
+giet_tty_printf("\n[DEBUG USER RWLOCK] P[%d,%d,%d] release write lock %x at cycle %d\n",
+                x , y , p , (unsigned int)lock , giet_proctime() );
+#endif
+}
+
+// Local Variables:
+// tab-width: 4
+// c-basic-offset: 4
+// c-file-offsets:((innamespace . 0)(inline-open . 0))
+// indent-tabs-mode: nil
+// End:
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=4:softtabstop=4
+
@@ -0,0 +1,78 @@
+//////////////////////////////////////////////////////////////////////////////////
+// File     : user_rwlock.h
+// Date     : 01/10/2015
+// Author   : alain greiner
+// Copyright (c) UPMC-LIP6
+///////////////////////////////////////////////////////////////////////////////////
+// The user_rwlock.c and user_rwlock.h files are part of the GIET-VM nano-kernel.
+// This user-level library implements a distributed readers/writers lock, 
+// for read-mostly shared structures.
+//
+// Each cluster contains a reader node, allocated in the cluster heap, that
+// contains a readers counter and a writer flag: a reader only accesses the
+// node of its own cluster, and the read-side cost does not depend on the 
+// number of clusters.
+// The writers are serialised by a SQT lock. The reader nodes are organised
+// as a quad-tree (as the SQT lock), and a writer drains the readers 
+// hierarchically: it sets the writer flag in all nodes from top to bottom, 
+// and waits until all readers counters are zero from bottom to top.
+// A reader finding the writer flag set in its node waits until the writer
+// releases the lock: the writers cannot be starved by the readers.
+//
+// The lock must be initialised by one single task with rwlock_init().
+// The heaps must have been initialised (heap_init()) in all clusters.
+///////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _USER_RWLOCK_H_
+#define _USER_RWLOCK_H_
+
+#include "hard_config.h"
+#include "user_sqt_lock.h"
+
+///////////////////////////////////////////////////////////////////////////////////
+//  readers/writers lock structures
+///////////////////////////////////////////////////////////////////////////////////
+
+typedef struct rwlock_node_s
+{
+    unsigned int          readers;     // number of readers (level 0 only)
+    unsigned int          writer;      // non zero when a writer is active
+    unsigned int          level;       // hierarchical level (0 is bottom)
+    struct rwlock_node_s* child[4];    // children nodes
+    unsigned int          padding[9];  // for 64 bytes alignment
+} rwlock_node_t;
+
+typedef struct rwlock_s
+{
+    sqt_lock_t            wlock;                      // writers lock
+    rwlock_node_t*        node[X_SIZE][Y_SIZE][5];    // pointers on nodes
+    unsigned int          levels;                     // number of levels
+} rwlock_t;
+
+///////////////////////////////////////////////////////////////////////////////////
+//  access functions
+///////////////////////////////////////////////////////////////////////////////////
+
+extern void rwlock_init( rwlock_t*    lock,
+                         unsigned int x_size,
+                         unsigned int y_size,
+                         unsigned int ntasks );
+
+extern void rwlock_read_acquire( rwlock_t* lock );
+
+extern void rwlock_read_release( rwlock_t* lock );
+
+extern void rwlock_write_acquire( rwlock_t* lock );
+
+extern void rwlock_write_release( rwlock_t* lock );
+
+#endif
+
+// Local Variables:
+// tab-width: 4
+// c-basic-offset: 4
+// c-file-offsets:((innamespace . 0)(inline-open . 0))
+// indent-tabs-mode: nil
+// End:
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=4:softtabstop=4
+
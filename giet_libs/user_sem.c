@@ -0,0 +1,70 @@
+//////////////////////////////////////////////////////////////////////////////////
+// File     : user_sem.c
+// Date     : 01/10/2015
+// Author   : alain greiner
+// Copyright (c) UPMC-LIP6
+///////////////////////////////////////////////////////////////////////////////////
+// The user_sem.c and user_sem.h files are part of the GIET-VM nano-kernel.
+///////////////////////////////////////////////////////////////////////////////////
+
+#include "user_sem.h"
+#include "user_lock.h"
+#include "giet_config.h"
+#include "stdio.h"
+
+///////////////////////////////////
+void sem_init( user_sem_t*  sem,
+               unsigned int value )
+{
+    sem->count   = value;
+    sem->waiters = 0;
+
+    asm volatile ("sync" ::: "memory");
+}
+
+///////////////////////////////////////////////
+unsigned int sem_trywait( user_sem_t* sem )
+{
+    volatile unsigned int* pcount = &sem->count;
+    unsigned int           count;
+
+    while ( (count = *pcount) != 0 )
+    {
+        if ( atomic_cas( &sem->count, count, count - 1 ) ) return 1;
+    }
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// A task woken up by sem_post() can find the counter null, if another task
+// took the token in the meantime: it then blocks again.
+//////////////////////////////////////////////////////////////////////////////////
+void sem_wait( user_sem_t* sem )
+{
+    while ( sem_trywait( sem ) == 0 )
+    {
+        spin_then_sleep( &sem->count, 0, &sem->waiters );
+    }
+
+    asm volatile ("sync" ::: "memory");
+}
+
+////////////////////////////////
+void sem_post( user_sem_t* sem )
+{
+    asm volatile ("sync" ::: "memory");
+
+    atomic_increment( &sem->count, 1 );
+
+    asm volatile ("sync" ::: "memory");
+    if ( sem->waiters ) giet_futex_wake( &sem->count, 1 );
+}
+
+// Local Variables:
+// tab-width: 4
+// c-basic-offset: 4
+// c-file-offsets:((innamespace . 0)(inline-open . 0))
+// indent-tabs-mode: nil
+// End:
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=4:softtabstop=4
+
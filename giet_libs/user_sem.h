@@ -0,0 +1,54 @@
+//////////////////////////////////////////////////////////////////////////////////
+// File     : user_sem.h
+// Date     : 01/10/2015
+// Author   : alain greiner
+// Copyright (c) UPMC-LIP6
+///////////////////////////////////////////////////////////////////////////////////
+// The user_sem.c and user_sem.h files are part of the GIET-VM nano-kernel.
+// This user-level library provides counting semaphores:
+// - sem_wait() takes one token, and blocks the calling task while the
+//   semaphore is zero: it polls the counter GIET_USER_SPIN_MAX times, and then
+//   deschedules on a futex (or yields the processor if the GIET_USER_FUTEX
+//   parameter is zero).
+// - sem_trywait() takes one token if available, and returns 0 otherwise.
+// - sem_post() releases one token, and wakes up one blocked task if any.
+// The counter is modified with LL/SC atomic instructions, and no lock is used.
+///////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _USER_SEM_H_
+#define _USER_SEM_H_
+
+///////////////////////////////////////////////////////////////////////////////////
+//  semaphore structure
+///////////////////////////////////////////////////////////////////////////////////
+
+typedef struct user_sem_s 
+{
+    unsigned int count;          // number of available tokens
+    unsigned int waiters;        // number of tasks blocked on a futex
+    unsigned int padding[14];    // for 64 bytes alignment
+} user_sem_t;
+
+///////////////////////////////////////////////////////////////////////////////////
+//  access functions
+///////////////////////////////////////////////////////////////////////////////////
+
+extern void sem_init( user_sem_t*  sem,
+                      unsigned int value );
+
+extern void sem_wait( user_sem_t* sem );
+
+extern unsigned int sem_trywait( user_sem_t* sem );
+
+extern void sem_post( user_sem_t* sem );
+
+#endif
+
+// Local Variables:
+// tab-width: 4
+// c-basic-offset: 4
+// c-file-offsets:((innamespace . 0)(inline-open . 0))
+// indent-tabs-mode: nil
+// End:
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=4:softtabstop=4
+
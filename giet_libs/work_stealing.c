@@ -0,0 +1,296 @@
+//////////////////////////////////////////////////////////////////////////////////
+// File     : work_stealing.c
+// Date     : 01/10/2015
+// Author   : alain greiner
+// Copyright (c) UPMC-LIP6
+///////////////////////////////////////////////////////////////////////////////////
+
+#include "work_stealing.h"
+#include "user_lock.h"
+#include "malloc.h"
+#include "stdio.h"
+#include "giet_config.h"
+
+///////////////////////////////////////////////////////////////////////////////////
+//      Deque access functions
+// The head and tail fields are free running indexes: the number of jobs
+// in the deque is (tail - head), and the slot index is (index % depth).
+// The lock is only taken when the deque is not empty.
+///////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////
+static unsigned int ws_push( ws_deque_t* dq,
+                             ws_job_t*   job )
+{
+    cfg_lock_acquire( &dq->lock );
+
+    if ( (dq->tail - dq->head) == dq->depth )   // full
+    {
+        cfg_lock_release( &dq->lock );
+        return 0;
+    }
+
+    dq->jobs[dq->tail % dq->depth] = *job;
+    dq->tail = dq->tail + 1;
+
+    cfg_lock_release( &dq->lock );
+    return 1;
+}
+
+/////////////////////////////////////////////
+static unsigned int ws_pop( ws_deque_t* dq,
+                            ws_job_t*   job )
+{
+    unsigned int found = 0;
+
+    if ( *(volatile unsigned int*)&dq->tail ==
+         *(volatile unsigned int*)&dq->head ) return 0;
+
+    cfg_lock_acquire( &dq->lock );
+
+    if ( dq->tail != dq->head )
+    {
+        dq->tail = dq->tail - 1;
+        *job     = dq->jobs[dq->tail % dq->depth];
+        found    = 1;
+    }
+
+    cfg_lock_release( &dq->lock );
+    return found;
+}
+
+///////////////////////////////////////////////
+static unsigned int ws_steal( ws_deque_t* dq,
+                              ws_job_t*   job )
+{
+    unsigned int found = 0;
+
+    if ( *(volatile unsigned int*)&dq->tail ==
+         *(volatile unsigned int*)&dq->head ) return 0;
+
+    cfg_lock_acquire( &dq->lock );
+
+    if ( dq->tail != dq->head )
+    {
+        *job     = dq->jobs[dq->head % dq->depth];
+        dq->head = dq->head + 1;
+        found    = 1;
+    }
+
+    cfg_lock_release( &dq->lock );
+    return found;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// This function scans the other workers to steal one job: it tries first
+// the workers in the same cluster, and then the workers in the remote
+// clusters, starting from a pseudo-random cluster and a pseudo-random
+// processor in each remote cluster. It returns 1 if a job has been stolen.
+///////////////////////////////////////////////////////////////////////////////////
+static unsigned int ws_find( ws_deque_t* self,
+                             ws_job_t*   job )
+{
+    ws_runtime_t* rt        = self->rt;
+    unsigned int  nprocs    = rt->nprocs;
+    unsigned int  nclusters = rt->x_size * rt->y_size;
+    unsigned int  local     = (self->x * rt->y_size) + self->y;
+    unsigned int  n;
+    unsigned int  c;
+    unsigned int  p;
+
+    // same cluster victims
+    for ( n = 1 ; n < nprocs ; n++ )
+    {
+        p = (self->p + n) % nprocs;
+        if ( ws_steal( rt->deque[self->x][self->y][p], job ) ) return 1;
+    }
+
+    if ( nclusters == 1 ) return 0;
+
+    // update pseudo-random generator
+    self->seed = (self->seed * 1103515245) + 12345;
+
+    // remote clusters victims
+    unsigned int first = (self->seed >> 16) % (nclusters - 1);
+    for ( c = 0 ; c < (nclusters - 1) ; c++ )
+    {
+        unsigned int cluster = (local + 1 + ((first + c) % (nclusters - 1))) % nclusters;
+        unsigned int cx      = cluster / rt->y_size;
+        unsigned int cy      = cluster % rt->y_size;
+        unsigned int start   = (self->seed >> 8) % nprocs;
+
+        for ( n = 0 ; n < nprocs ; n++ )
+        {
+            p = (start + n) % nprocs;
+            if ( ws_steal( rt->deque[cx][cy][p], job ) ) return 1;
+        }
+    }
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// This function executes one job, and signals its completion to the job group.
+///////////////////////////////////////////////////////////////////////////////////
+static void ws_execute( ws_deque_t* self,
+                        ws_job_t*   job )
+{
+    job->func( self, job->arg );
+
+    // make the job results visible before completion
+    asm volatile ("sync" ::: "memory");
+
+    atomic_increment( &job->group->pending, 0xFFFFFFFF );
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+//      Runtime access functions
+///////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////
+void ws_init( ws_runtime_t* rt,
+              unsigned int  x_size,    // number of clusters in a row
+              unsigned int  y_size,    // number of clusters in a column
+              unsigned int  nprocs,    // number of workers per cluster
+              unsigned int  depth )    // max number of jobs per worker
+{
+    unsigned int x;
+    unsigned int y;
+    unsigned int p;
+
+    // check parameters
+    if ( x_size > X_SIZE )       giet_exit("WS ERROR : x_size too large");
+    if ( y_size > Y_SIZE )       giet_exit("WS ERROR : y_size too large");
+    if ( nprocs > NB_PROCS_MAX ) giet_exit("WS ERROR : nprocs too large");
+    if ( depth == 0 )            giet_exit("WS ERROR : depth cannot be zero");
+
+    rt->x_size = x_size;
+    rt->y_size = y_size;
+    rt->nprocs = nprocs;
+    rt->stop   = 0;
+
+    // allocates the workers in the local heaps
+    for ( x = 0 ; x < x_size ; x++ )
+    {
+        for ( y = 0 ; y < y_size ; y++ )
+        {
+            for ( p = 0 ; p < nprocs ; p++ )
+            {
+                ws_deque_t* dq = remote_malloc( sizeof(ws_deque_t), x, y );
+
+                dq->jobs  = remote_malloc( depth * sizeof(ws_job_t), x, y );
+                dq->head  = 0;
+                dq->tail  = 0;
+                dq->depth = depth;
+                dq->rt    = rt;
+                dq->x     = x;
+                dq->y     = y;
+                dq->p     = p;
+                dq->seed  = (((x * y_size) + y) * nprocs) + p;
+                cfg_lock_init( &dq->lock );
+
+                rt->deque[x][y][p] = dq;
+
+#if GIET_DEBUG_USER_WS
+giet_tty_printf("\n[DEBUG USER WS] worker[%d][%d][%d] : vaddr = %x / jobs = %x\n",
+                x, y, p, (unsigned int)dq, (unsigned int)dq->jobs );
+#endif
+            }
+        }
+    }
+
+    asm volatile ("sync" ::: "memory");
+
+}  // end ws_init()
+
+////////////////////////////////////////
+ws_deque_t* ws_self( ws_runtime_t* rt )
+{
+    unsigned int x;
+    unsigned int y;
+    unsigned int p;
+
+    giet_proc_xyp( &x, &y, &p );
+
+    if ( (x >= rt->x_size) || (y >= rt->y_size) || (p >= rt->nprocs) )
+    {
+        giet_exit("WS ERROR : calling processor not in runtime");
+    }
+
+    return rt->deque[x][y][p];
+}
+
+///////////////////////////////
+void ws_run( ws_runtime_t* rt )
+{
+    ws_deque_t*            self = ws_self( rt );
+    volatile unsigned int* stop = &rt->stop;
+    ws_job_t               job;
+
+    while ( *stop == 0 )
+    {
+        if ( ws_pop( self, &job ) || ws_find( self, &job ) )
+        {
+            ws_execute( self, &job );
+        }
+    }
+}
+
+////////////////////////////////
+void ws_stop( ws_runtime_t* rt )
+{
+    asm volatile ("sync" ::: "memory");
+
+    rt->stop = 1;
+}
+
+/////////////////////////////////////////
+void ws_group_init( ws_group_t* group )
+{
+    group->pending = 0;
+}
+
+///////////////////////////////////
+void ws_spawn( ws_deque_t*  self,
+               ws_group_t*  group,
+               ws_func_t*   func,
+               void*        arg )
+{
+    ws_job_t job;
+
+    job.func  = func;
+    job.arg   = arg;
+    job.group = group;
+
+    atomic_increment( &group->pending, 1 );
+
+    // the job is executed by the calling worker if the deque is full
+    if ( ws_push( self, &job ) == 0 ) ws_execute( self, &job );
+}
+
+//////////////////////////////////
+void ws_sync( ws_deque_t*  self,
+              ws_group_t*  group )
+{
+    volatile unsigned int* pending = &group->pending;
+    ws_job_t               job;
+
+    while ( *pending != 0 )
+    {
+        if ( ws_pop( self, &job ) || ws_find( self, &job ) )
+        {
+            ws_execute( self, &job );
+        }
+    }
+
+    // make the results of the stolen jobs visible
+    asm volatile ("sync" ::: "memory");
+}
+
+// Local Variables:
+// tab-width: 4
+// c-basic-offset: 4
+// c-file-offsets:((innamespace . 0)(inline-open . 0))
+// indent-tabs-mode: nil
+// End:
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=4:softtabstop=4
+
@@ -0,0 +1,121 @@
+//////////////////////////////////////////////////////////////////////////////////
+// File     : work_stealing.h
+// Date     : 01/10/2015
+// Author   : alain greiner
+// Copyright (c) UPMC-LIP6
+///////////////////////////////////////////////////////////////////////////////////
+// The work_stealing.c and work_stealing.h files are part of the GIET-VM
+// nano-kernel. This user-level library provides a work-stealing runtime
+// for fork-join parallel applications, on top of the static mapping
+// (one task per processor).
+//
+// Each processor owns a "worker" (ws_deque_t), that is a double-ended queue
+// of pending jobs, allocated in the heap of the cluster containing the
+// processor. A job is a function and an argument, and belongs to a job
+// group (ws_group_t), that counts the number of pending jobs in the group:
+// - ws_spawn() pushes a job on the tail of the calling worker deque.
+// - ws_sync() executes jobs until all jobs of a group are completed: it pops
+//   jobs from the tail of the calling worker deque (LIFO order), and steals
+//   jobs from the head of the other workers deques (FIFO order) when empty.
+// A thief tries first the victims in the same cluster, and then the victims
+// in the remote clusters, starting from a pseudo-random cluster.
+// Each deque is protected by a ticket lock, or a MCS lock if the 
+// GIET_USER_MCS_LOCK parameter is non zero.
+// A job function receives the pointer on the executing worker, that must be
+// used to spawn nested jobs.
+//
+// The runtime must be initialised by one single task with ws_init().
+// Then, one "root" task gets its worker with ws_self(), and spawns the jobs,
+// while all other tasks call ws_run(), that steals and executes jobs until
+// the root task calls ws_stop().
+// The heaps must have been initialised (heap_init()) in all clusters.
+///////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WORK_STEALING_H_
+#define _WORK_STEALING_H_
+
+#include "hard_config.h"
+#include "user_lock.h"
+
+struct ws_deque_s;
+struct ws_group_s;
+
+///////////////////////////////////////////////////////////////////////////////////
+//  job, group, worker and runtime structures
+///////////////////////////////////////////////////////////////////////////////////
+
+typedef void (ws_func_t)( struct ws_deque_s* self, void* arg );
+
+typedef struct ws_job_s
+{
+    ws_func_t*          func;         // job function
+    void*               arg;          // job function argument
+    struct ws_group_s*  group;        // job group
+    unsigned int        padding;      // for 16 bytes alignment
+} ws_job_t;
+
+typedef struct ws_group_s
+{
+    unsigned int        pending;      // number of not completed jobs
+} ws_group_t;
+
+typedef struct ws_deque_s
+{
+    cfg_lock_t          lock;         // exclusive access lock
+    unsigned int        head;         // index of the oldest job (steal side)
+    unsigned int        tail;         // index of the first free slot (owner side)
+    unsigned int        depth;        // max number of jobs in the deque
+    ws_job_t*           jobs;         // circular buffer of jobs
+    struct ws_runtime_s* rt;          // pointer on the runtime
+    unsigned int        x;            // cluster x coordinate
+    unsigned int        y;            // cluster y coordinate
+    unsigned int        p;            // processor local index
+    unsigned int        seed;         // pseudo-random generator state
+    unsigned int        padding[7];   // for 64 bytes alignment
+} ws_deque_t;
+
+typedef struct ws_runtime_s
+{
+    ws_deque_t*         deque[X_SIZE][Y_SIZE][NB_PROCS_MAX]; // pointers on workers
+    unsigned int        x_size;       // number of clusters in a row
+    unsigned int        y_size;       // number of clusters in a column
+    unsigned int        nprocs;       // number of workers per cluster
+    unsigned int        stop;         // non zero when ws_stop() has been called
+} ws_runtime_t;
+
+///////////////////////////////////////////////////////////////////////////////////
+//  access functions
+///////////////////////////////////////////////////////////////////////////////////
+
+extern void ws_init( ws_runtime_t* rt,
+                     unsigned int  x_size,
+                     unsigned int  y_size,
+                     unsigned int  nprocs,
+                     unsigned int  depth );
+
+extern ws_deque_t* ws_self( ws_runtime_t* rt );
+
+extern void ws_run( ws_runtime_t* rt );
+
+extern void ws_stop( ws_runtime_t* rt );
+
+extern void ws_group_init( ws_group_t* group );
+
+extern void ws_spawn( ws_deque_t*  self,
+                      ws_group_t*  group,
+                      ws_func_t*   func,
+                      void*        arg );
+
+extern void ws_sync( ws_deque_t*  self,
+                     ws_group_t*  group );
+
+#endif
+
+// Local Variables:
+// tab-width: 4
+// c-basic-offset: 4
+// c-file-offsets:((innamespace . 0)(inline-open . 0))
+// indent-tabs-mode: nil
+// End:
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=4:softtabstop=4
+
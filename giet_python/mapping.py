@@ -415,13 +415,17 @@ class Mapping( object ):
                  lpid,                  # destination processor local index
                  stackname,             # name of vseg containing stack
                  heapname,              # name of vseg containing heap
-                 startid ):             # index in start_vector
+                 startid,               # index in start_vector
+                 priority = 0,          # scheduling priority level (0 is lowest)
+                 dynamic  = False ):    # slot reserved for giet_pthread_create()
 
         assert (x < self.x_size) and (y < self.y_size)
         assert lpid < self.nprocs
+        assert (priority >= 0) and (priority < 4)
 
         # add one task into mapping
-        task = Task( name, trdid, x, y, lpid, stackname, heapname, startid )
+        task = Task( name, trdid, x, y, lpid, stackname, heapname, startid, 
+                     priority, dynamic )
         vspace.tasks.append( task )
         task.index = self.total_tasks
         self.total_tasks += 1
@@ -2007,7 +2011,9 @@ class Task( object ):
                   p,
                   stackname,
                   heapname,
-                  startid ):
+                  startid,
+                  priority,
+                  dynamic ):
 
         self.index     = 0             # global index value set by addTask()
         self.name      = name          # tsk name
@@ -2018,6 +2024,8 @@ class Task( object ):
         self.stackname = stackname     # name of vseg containing the stack
         self.heapname  = heapname      # name of vseg containing the heap
         self.startid   = startid       # index in start_vector
+        self.priority  = priority      # scheduling priority level
+        self.dynamic   = dynamic       # slot reserved for giet_pthread_create()
         return
 
     ######################################
@@ -2032,6 +2040,9 @@ class Task( object ):
         s += ' stackname="%s"'             % self.stackname
         s += ' heapname="%s"'              % self.heapname
         s += ' startid="%d"'               % self.startid
+        s += ' priority="%d"'              % self.priority
+        if ( self.dynamic ):
+            s += ' dynamic="1"'
         s += ' />\n'
 
         return s
@@ -2087,6 +2098,8 @@ class Task( object ):
         byte_stream += mapping.int2bytes(4, vseg_heap_id)  # heap vseg local index
         byte_stream += mapping.int2bytes(4, self.startid)  # index in start vector
         byte_stream += mapping.int2bytes(4 ,0)             # ltid (dynamically computed)
+        byte_stream += mapping.int2bytes(4, self.priority) # scheduling priority level
+        byte_stream += mapping.int2bytes(4, int(self.dynamic)) # reserved pthread slot
 
         if ( verbose ):
             print 'clusterid  = %d' %  cluster_id
@@ -2095,6 +2108,8 @@ class Task( object ):
             print 'stackid    = %d' %  vseg_stack_id
             print 'heapid     = %d' %  vseg_heap_id
             print 'startid    = %d' %  self.startid
+            print 'priority   = %d' %  self.priority
+            print 'dynamic    = %d' %  int(self.dynamic)
 
         return byte_stream
 
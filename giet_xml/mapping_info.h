@@ -230,6 +230,8 @@ typedef struct __attribute__((packed))  mapping_task_s
     unsigned int    heap_vseg_id;    // global index for vseg containing heap
     unsigned int    startid;         // index in start_vector 
     unsigned int    ltid;            // task index in scheduler (dynamically defined)
+    unsigned int    priority;        // scheduling priority level (0 is the lowest)
+    unsigned int    dynamic;         // slot reserved for giet_pthread_create()
 } mapping_task_t;
 
 
@@ -361,6 +361,9 @@ void buildXml(mapping_header_t * header, FILE * fpout)
             if (heap_vseg_id != -1) 
             fprintf(fpout, " heapname=\"%s\"", vseg[heap_vseg_id].name);
             fprintf(fpout, " startid = \"%d\"", task[task_id].startid);
+            fprintf(fpout, " priority = \"%d\"", task[task_id].priority);
+            if (task[task_id].dynamic) 
+            fprintf(fpout, " dynamic = \"1\"");
             fprintf(fpout, " />\n");
         }
         fprintf(fpout, "        </vspace>\n\n");
@@ -454,6 +454,34 @@ printf("      startid   = %x\n", value);
         exit(1);
     }
 
+    ////////// get priority attribute (optional)
+    value = getIntValue(reader, "priority", &ok);
+#if XML_PARSER_DEBUG
+printf("      priority  = %d\n", value );
+#endif
+    if ( ok ) 
+    {
+        if ( value >= 4 )
+        {
+            printf("[XML ERROR] illegal <priority> attribute for task (%d,%d)\n", 
+                    vspace_index, task_loc_index);
+            exit(1);
+        }
+        task[task_index]->priority = value;
+    }
+    else 
+    {
+        task[task_index]->priority = 0;
+    }
+
+    ////////// get dynamic attribute (optional)
+    value = getIntValue(reader, "dynamic", &ok);
+#if XML_PARSER_DEBUG
+printf("      dynamic   = %d\n", value );
+#endif
+    if ( ok ) task[task_index]->dynamic = (value != 0);
+    else      task[task_index]->dynamic = 0;
+
     task_index++;
     task_loc_index++;
 } // end taskNode()